@@ -0,0 +1,217 @@
+/*
+ * Stolen and adapted from https://gist.github.com/tonious/1377667
+ */
+
+#include "chained_hashtable.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <string.h>
+#include "slab.h"
+
+static SlabAllocator tableCells = SLAB_ALLOCATOR("chained hashtable", sizeof(chained_hashtable_t));
+static SlabAllocator pairCells = SLAB_ALLOCATOR("chained pair", sizeof(chained_entry_t));
+
+static int chained_ht_hash(chained_hashtable_t*, char*);
+static chained_entry_t* chained_ht_newpair(char*, void*);
+static void chained_ht_link(chained_hashtable_t*, chained_entry_t*);
+
+/* Create a new hashtable. */
+chained_hashtable_t* chained_ht_create(int size) {
+
+    chained_hashtable_t* hashtable = NULL;
+    int i;
+
+    if (size < 1) return NULL;
+
+    /* Allocate the table itself. */
+    hashtable = slab_allocate(&tableCells);
+
+    /* Allocate pointers to the head nodes. */
+    if ((hashtable->table = malloc(sizeof(chained_entry_t*) * size)) == NULL) {
+        return NULL;
+    }
+    for ( i = 0 ; i < size ; i++ ) {
+        hashtable->table[i] = NULL;
+    }
+
+    hashtable->size = size;
+    hashtable->bulk = NULL;
+    hashtable->bulkCount = 0;
+
+    return hashtable;
+}
+
+/* Create a hashtable holding `count` pairs, sized for exactly that many. The pairs are allocated in one block and the
+ * keys are not copied, so they have to be distinct and outlive the table, like string literals do. */
+chained_hashtable_t* chained_ht_create_bulk(int count, char** keys, void** values) {
+    chained_hashtable_t* hashtable = NULL;
+    chained_entry_t* pairs = NULL;
+    int i;
+
+    if ((hashtable = chained_ht_create(count > 0 ? count : 1)) == NULL) {
+        return NULL;
+    }
+
+    if (count == 0) return hashtable;
+
+    if ((pairs = malloc(sizeof(chained_entry_t) * count)) == NULL) {
+        return NULL;
+    }
+    for ( i = 0 ; i < count ; i++ ) {
+        pairs[i].key = keys[i];
+        pairs[i].value = values[i];
+        chained_ht_link(hashtable, &pairs[i]);
+    }
+    hashtable->bulk = pairs;
+    hashtable->bulkCount = count;
+
+    return hashtable;
+}
+
+/* Insert a value into a hash table at the key. */
+void chained_ht_set(chained_hashtable_t* hashtable, char* key, void* value) {
+    int bin = 0;
+    chained_entry_t* newpair = NULL;
+    chained_entry_t* next = NULL;
+    chained_entry_t* last = NULL;
+
+    bin = chained_ht_hash(hashtable, key);
+
+    next = hashtable->table[bin];
+
+    while (next != NULL && next->key != NULL && strcmp(key, next->key) > 0) {
+        last = next;
+        next = next->next;
+    }
+
+    /* There's already a pair. */
+    if (next != NULL && next->key != NULL && strcmp(key, next->key) == 0) {
+
+        /* The table does not own its values, they may be shared with other tables. */
+        next->value = value;
+
+        /* Nope, could't find it.  Time to grow a pair. */
+    } else {
+        newpair = chained_ht_newpair(key, value);
+
+        /* We're at the start of the linked list in this bin. */
+        if (next == hashtable->table[bin]) {
+            newpair->next = next;
+            hashtable->table[bin] = newpair;
+
+            /* We're at the end of the linked list in this bin. */
+        } else if (next == NULL) {
+            last->next = newpair;
+
+            /* We're in the middle of the list. */
+        } else {
+            newpair->next = next;
+            last->next = newpair;
+        }
+    }
+}
+
+/* Retrieve a key-value pair from a hash table. */
+void* chained_ht_get(chained_hashtable_t* hashtable, char* key) {
+    int bin = 0;
+    chained_entry_t* pair;
+
+    bin = chained_ht_hash(hashtable, key);
+
+    /* Step through the bin, looking for our value. */
+    pair = hashtable->table[bin];
+    while (pair != NULL && pair->key != NULL && strcmp(key, pair->key) > 0) {
+        pair = pair->next;
+    }
+
+    /* Did we actually find anything? */
+    if (pair == NULL || pair->key == NULL || strcmp(key, pair->key) != 0) {
+        return NULL;
+    } else {
+        return pair->value;
+    }
+}
+
+/* Clear every value but keep the pairs, so setting the same keys again does not allocate. */
+void chained_ht_reset(chained_hashtable_t* hashtable) {
+    int i;
+    chained_entry_t* pair;
+
+    for ( i = 0 ; i < hashtable->size ; i++ ) {
+        for ( pair = hashtable->table[i] ; pair != NULL ; pair = pair->next ) {
+            pair->value = NULL;
+        }
+    }
+}
+
+/* Free the table, its pairs and the keys it copied. The values are not owned by the table. */
+void chained_ht_destroy(chained_hashtable_t* hashtable) {
+    int i;
+    chained_entry_t* pair;
+    chained_entry_t* next;
+
+    for ( i = 0 ; i < hashtable->size ; i++ ) {
+        for ( pair = hashtable->table[i] ; pair != NULL ; pair = next ) {
+            next = pair->next;
+            if ( pair < hashtable->bulk || pair >= hashtable->bulk + hashtable->bulkCount ) {
+                free(pair->key);
+                slab_free(&pairCells, pair);
+            }
+        }
+    }
+    free(hashtable->bulk);
+    free(hashtable->table);
+    slab_free(&tableCells, hashtable);
+}
+
+/* Hash a string for a particular hash table. */
+static int chained_ht_hash(chained_hashtable_t* hashtable, char* key) {
+    unsigned long int hashval = 0;
+    int i = 0;
+
+    /* Convert our string to an integer */
+    while (hashval < ULONG_MAX && i < strlen(key)) {
+        hashval = hashval << 8;
+        hashval += key[i];
+        i++;
+    }
+
+    return hashval % hashtable->size;
+}
+
+/* Link a pair whose key is not in the table yet into its bin, keeping the bin sorted. */
+static void chained_ht_link(chained_hashtable_t* hashtable, chained_entry_t* pair) {
+    int bin = chained_ht_hash(hashtable, pair->key);
+    chained_entry_t* next = hashtable->table[bin];
+    chained_entry_t* last = NULL;
+
+    while (next != NULL && next->key != NULL && strcmp(pair->key, next->key) > 0) {
+        last = next;
+        next = next->next;
+    }
+
+    pair->next = next;
+    if (last == NULL) {
+        hashtable->table[bin] = pair;
+    } else {
+        last->next = pair;
+    }
+}
+
+/* Create a key-value pair. */
+static chained_entry_t* chained_ht_newpair(char* key, void* value) {
+    chained_entry_t* newpair;
+
+    newpair = slab_allocate(&pairCells);
+
+    if ((newpair->key = strdup(key)) == NULL) {
+        return NULL;
+    }
+
+    newpair->value = value;
+    newpair->next = NULL;
+
+    return newpair;
+}
\ No newline at end of file
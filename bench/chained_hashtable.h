@@ -0,0 +1,31 @@
+#ifndef CHAINED_HASHTABLE_H
+#define CHAINED_HASHTABLE_H
+/*
+ * The chained hashtable src/hashtable.c used to be, kept to benchmark the current one against, see bench/hashtable.c.
+ * Stolen and adapted from https://gist.github.com/tonious/1377667
+ */
+
+typedef struct chained_hashtable_s chained_hashtable_t;
+typedef struct chained_entry_s chained_entry_t;
+
+chained_hashtable_t* chained_ht_create(int);
+chained_hashtable_t* chained_ht_create_bulk(int, char**, void**);
+void chained_ht_set(chained_hashtable_t*, char*, void*);
+void* chained_ht_get(chained_hashtable_t*, char*);
+void chained_ht_reset(chained_hashtable_t*);
+void chained_ht_destroy(chained_hashtable_t*);
+
+struct chained_entry_s {
+    char* key;
+    void* value;
+    chained_entry_t* next;
+};
+
+struct chained_hashtable_s {
+    int size;
+    chained_entry_t** table;
+    chained_entry_t* bulk; /* the pairs of chained_ht_create_bulk(), with borrowed keys */
+    int bulkCount;
+};
+
+#endif
\ No newline at end of file
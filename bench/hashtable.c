@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "atom.h"
+#include "chained_hashtable.h"
+#include "hashtable.h"
+
+/*
+ * Compares src/hashtable.c with the chained table it replaced, on the access patterns of the runtime: a few variables
+ * of a scope looked up over and over, objects with more and more properties, and short-lived tables.
+ *
+ *     make bench-hashtable
+ */
+
+#define KEY_COUNT 4096
+
+static char* keys[KEY_COUNT];
+static volatile void* sink;
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static void report(char* name, int size, long operations, double chained, double openAddressing) {
+    printf("%-10s %5i keys  chained %8.2f ns/op  open addressing %8.2f ns/op  %6.2fx\n",
+        name, size, chained * 1e9 / operations, openAddressing * 1e9 / operations, chained / openAddressing);
+}
+
+// Sets `size` keys once, then gets all of them `rounds` times.
+static void lookups(int size, int rounds) {
+    long operations = (long) size * rounds;
+    double start = now();
+    chained_hashtable_t* chained = chained_ht_create(1);
+    for ( int i = 0 ; i < size ; i++ ) {
+        chained_ht_set(chained, keys[i], keys[i]);
+    }
+    for ( int round = 0 ; round < rounds ; round++ ) {
+        for ( int i = 0 ; i < size ; i++ ) {
+            sink = chained_ht_get(chained, keys[i]);
+        }
+    }
+    chained_ht_destroy(chained);
+    double chainedTime = now() - start;
+
+    start = now();
+    hashtable_t* hashtable = ht_create(1);
+    for ( int i = 0 ; i < size ; i++ ) {
+        ht_set(hashtable, keys[i], keys[i]);
+    }
+    for ( int round = 0 ; round < rounds ; round++ ) {
+        for ( int i = 0 ; i < size ; i++ ) {
+            sink = ht_get(hashtable, keys[i]);
+        }
+    }
+    ht_destroy(hashtable);
+    report("lookup", size, operations, chainedTime, now() - start);
+}
+
+// Creates a table, sets `size` keys and destroys it again, `rounds` times.
+static void churn(int size, int rounds) {
+    long operations = (long) size * rounds;
+    double start = now();
+    for ( int round = 0 ; round < rounds ; round++ ) {
+        chained_hashtable_t* chained = chained_ht_create(1);
+        for ( int i = 0 ; i < size ; i++ ) {
+            chained_ht_set(chained, keys[i], keys[i]);
+        }
+        chained_ht_destroy(chained);
+    }
+    double chainedTime = now() - start;
+
+    start = now();
+    for ( int round = 0 ; round < rounds ; round++ ) {
+        hashtable_t* hashtable = ht_create(1);
+        for ( int i = 0 ; i < size ; i++ ) {
+            ht_set(hashtable, keys[i], keys[i]);
+        }
+        ht_destroy(hashtable);
+    }
+    report("churn", size, operations, chainedTime, now() - start);
+}
+
+int main() {
+    // the runtime only ever looks up atoms, which the chained table compares as plain strings
+    char key[16];
+    for ( int i = 0 ; i < KEY_COUNT ; i++ ) {
+        sprintf(key, "key%i", i);
+        keys[i] = atom_intern(key);
+    }
+    int sizes[] = { 4, 16, 64, 256, 1024, 4096 };
+    for ( int i = 0 ; i < sizeof(sizes) / sizeof(int) ; i++ ) {
+        lookups(sizes[i], 4000000 / sizes[i] / ( sizes[i] > 256 ? sizes[i] / 64 : 1 ));
+    }
+    for ( int i = 0 ; i < 3 ; i++ ) {
+        churn(sizes[i], 400000 / sizes[i]);
+    }
+    return 0;
+}
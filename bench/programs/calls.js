@@ -0,0 +1,18 @@
+// operations: 15000000
+// Calls functions of no, one and four parameters, like call in bench/runtime.c.
+function none() {
+    return 1;
+}
+function one(a) {
+    return a;
+}
+function four(a, b, c, d) {
+    return a + d;
+}
+var sum = 0;
+var i = 0;
+while (i < 5000000) {
+    sum = sum + none() + one(i) + four(i, 1, 2, 3);
+    i = i + 1;
+}
+console.log(sum);
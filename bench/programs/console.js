@@ -0,0 +1,7 @@
+// operations: 5000000
+// Logs a string and two numbers per line, like console.log in bench/runtime.c.
+var i = 0;
+while (i < 5000000) {
+    console.log('line', i, i / 4);
+    i = i + 1;
+}
@@ -0,0 +1,13 @@
+// operations: 20000000
+// Gets and assigns the properties of a small object, like getProperty and setProperty in bench/runtime.c. Prototypes
+// are left out, node does not look properties up through a `prototype` property.
+var point = {x: 1, y: 2, z: 3, w: 4};
+var sum = 0;
+var i = 0;
+while (i < 5000000) {
+    sum = sum + point.x + point.w;
+    point.y = i;
+    point.z = sum;
+    i = i + 1;
+}
+console.log(sum, point.y);
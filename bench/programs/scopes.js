@@ -0,0 +1,21 @@
+// operations: 5000000
+// Reads and assigns variables of a function from inside nested loops, whose bodies are scopes of their own, like
+// getVariable in bench/runtime.c.
+function run() {
+    var total = 0;
+    var a = 0;
+    while (a < 50) {
+        var b = 0;
+        while (b < 100) {
+            var c = 0;
+            while (c < 1000) {
+                total = total + a + b;
+                c = c + 1;
+            }
+            b = b + 1;
+        }
+        a = a + 1;
+    }
+    return total;
+}
+console.log(run());
@@ -0,0 +1,9 @@
+// operations: 5000000
+// Builds a short string in every iteration, like new_string in bench/runtime.c.
+var last = '';
+var i = 0;
+while (i < 5000000) {
+    last = 'item ' + i;
+    i = i + 1;
+}
+console.log(last);
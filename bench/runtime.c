@@ -0,0 +1,241 @@
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include "runtime.h"
+
+/*
+ * Exercises the runtime directly, without generated code around it: property lookups on objects of different sizes
+ * and prototype chains of different depths, calls of different arities, variables found deep in the scope chain,
+ * allocating values and writing to the console. Prints one JSON object per benchmark, with the time and the cells the
+ * collector allocated per operation, so runs before and after a change can be compared.
+ *
+ *     make bench-runtime
+ *
+ * runs this and bench/runtime.sh, which times the equivalent programs in bench/programs, transpiled and under node.
+ */
+
+static Scope* global;
+static volatile Variable sink;
+static char first = 1;
+
+typedef struct Measurement Measurement;
+
+struct Measurement {
+    double start;
+    GcStats stats;
+};
+
+static double now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+static Measurement begin() {
+    Measurement measurement = { now(), gc_stats() };
+    return measurement;
+}
+
+static void report(char* name, int parameter, long operations, Measurement measurement) {
+    double elapsed = now() - measurement.start;
+    GcStats stats = gc_stats();
+    printf("%s\n  { \"name\": \"%s\", \"parameter\": %i, \"operations\": %ld, \"ns_per_op\": %.3f, \"allocations_per_op\": %.3f, \"bytes_per_op\": %.3f }",
+        first ? "[" : ",",
+        name,
+        parameter,
+        operations,
+        elapsed * 1e9 / operations,
+        (double) ( stats.allocations - measurement.stats.allocations ) / operations,
+        (double) ( stats.allocatedBytes - measurement.stats.allocatedBytes ) / operations);
+    first = 0;
+}
+
+static char* key(int i) {
+    char name[16];
+    sprintf(name, "p%i", i);
+    return atom_intern(name);
+}
+
+// Gets every property of an object with `size` of them, which is a dictionary past SHAPE_MAX_SLOTS.
+static void getProperty(int size, long operations) {
+    Object* object = new_Object();
+    native_addRoot((Variable) (uintptr_t) object);
+    char* keys[64];
+    for ( int i = 0 ; i < size ; i++ ) {
+        keys[i] = key(i);
+        object->setProperty(object, keys[i], new_number(i));
+    }
+    size_t frame = gc_frame();
+    Measurement measurement = begin();
+    for ( long i = 0 ; i < operations ; i++ ) {
+        sink = object->getProperty(object, keys[i % size]);
+        if ( ( i & 1023 ) == 0 ) {
+            gc_safepoint(global, frame);
+        }
+    }
+    report("getProperty", size, operations, measurement);
+}
+
+// Assigns every property of an object with `size` of them again.
+static void setProperty(int size, long operations) {
+    Object* object = new_Object();
+    native_addRoot((Variable) (uintptr_t) object);
+    char* keys[64];
+    for ( int i = 0 ; i < size ; i++ ) {
+        keys[i] = key(i);
+        object->setProperty(object, keys[i], new_number(i));
+    }
+    Measurement measurement = begin();
+    for ( long i = 0 ; i < operations ; i++ ) {
+        sink = object->setProperty(object, keys[i % size], new_number(i));
+    }
+    report("setProperty", size, operations, measurement);
+}
+
+// Gets a property found at the end of `depth` prototypes.
+static void getPrototypeProperty(int depth, long operations) {
+    Object* object = new_Object();
+    native_addRoot((Variable) (uintptr_t) object);
+    object->setProperty(object, key(0), new_number(0));
+    for ( int i = 0 ; i < depth ; i++ ) {
+        Object* child = new_Object();
+        native_addRoot((Variable) (uintptr_t) child);
+        child->setProperty(child, ATOM("prototype"), (Variable) (uintptr_t) object);
+        object = child;
+    }
+    char* name = key(0);
+    size_t frame = gc_frame();
+    Measurement measurement = begin();
+    for ( long i = 0 ; i < operations ; i++ ) {
+        sink = object->getProperty(object, name);
+        if ( ( i & 1023 ) == 0 ) {
+            gc_safepoint(global, frame);
+        }
+    }
+    report("getProperty.prototype", depth, operations, measurement);
+}
+
+static Return identity(Scope* scope, int argc, Variable* argv) {
+    Return ret;
+    ret.value = argc > 0 ? argv[0] : new_undefined();
+    return ret;
+}
+
+// Calls a function with `arity` arguments.
+static void call(int arity, long operations) {
+    Variable function = new_function(identity);
+    native_addRoot(function);
+    Object* callee = native_objectValue(function);
+    Variable argv[8];
+    for ( int i = 0 ; i < arity ; i++ ) {
+        argv[i] = new_number(i);
+    }
+    Measurement measurement = begin();
+    for ( long i = 0 ; i < operations ; i++ ) {
+        sink = callee->call(callee, global, arity, argv).value;
+    }
+    report("call", arity, operations, measurement);
+}
+
+// Gets a variable declared `depth` scopes up the chain.
+static void getVariable(int depth, long operations) {
+    Scope* scope = new_PermanentScope(global);
+    char* name = key(0);
+    scope->defineVariable(scope, name);
+    scope->setVariable(scope, name, new_number(0));
+    for ( int i = 1 ; i < depth ; i++ ) {
+        scope = new_PermanentScope(scope);
+        scope->defineVariable(scope, key(i));
+    }
+    size_t frame = gc_frame();
+    Measurement measurement = begin();
+    for ( long i = 0 ; i < operations ; i++ ) {
+        sink = scope->getVariable(scope, name);
+        if ( ( i & 1023 ) == 0 ) {
+            gc_safepoint(global, frame);
+        }
+    }
+    report("getVariable", depth, operations, measurement);
+}
+
+static void newNumber(long operations) {
+    Measurement measurement = begin();
+    for ( long i = 0 ; i < operations ; i++ ) {
+        sink = new_number(i * 0.5);
+    }
+    report("new_number", 0, operations, measurement);
+}
+
+// Allocates strings of `length` characters, and collects them as generated code would.
+static void newString(int length, long operations) {
+    char* chars = (char*) malloc(length + 1);
+    for ( int i = 0 ; i < length ; i++ ) {
+        chars[i] = 'a' + i % 26;
+    }
+    chars[length] = '\0';
+    size_t frame = gc_frame();
+    Measurement measurement = begin();
+    for ( long i = 0 ; i < operations ; i++ ) {
+        sink = new_string(chars);
+        gc_safepoint(global, frame);
+    }
+    report("new_string", length, operations, measurement);
+    free(chars);
+}
+
+// Calls console.log with `arity` arguments, a string and numbers, writing to /dev/null.
+static void consoleLog(int arity, long operations) {
+    int fd = output_stdout.fd;
+    output_flush(&output_stdout);
+    output_stdout.fd = open("/dev/null", O_WRONLY);
+    Object* console = native_toObject(global->getVariable(global, ATOM("console")));
+    Object* log = native_toObject(console->getProperty(console, ATOM("log")));
+    Variable argv[8] = { new_literal(atom_intern("line")) };
+    for ( int i = 1 ; i < arity ; i++ ) {
+        argv[i] = new_number(i * 1.25);
+    }
+    Measurement measurement = begin();
+    for ( long i = 0 ; i < operations ; i++ ) {
+        log->call(log, global, arity, argv);
+    }
+    output_flush(&output_stdout);
+    report("console.log", arity, operations, measurement);
+    close(output_stdout.fd);
+    output_stdout.fd = fd;
+}
+
+int main() {
+    global = new_Scope(NULL);
+    initialize_runtime(global);
+    int sizes[] = { 1, 4, 16, 64 };
+    for ( int i = 0 ; i < 4 ; i++ ) {
+        getProperty(sizes[i], 20000000);
+    }
+    for ( int i = 0 ; i < 4 ; i++ ) {
+        setProperty(sizes[i], 20000000);
+    }
+    int depths[] = { 0, 1, 4, 16 };
+    for ( int i = 0 ; i < 4 ; i++ ) {
+        getPrototypeProperty(depths[i], 10000000);
+    }
+    int arities[] = { 0, 1, 4, 8 };
+    for ( int i = 0 ; i < 4 ; i++ ) {
+        call(arities[i], 20000000);
+    }
+    int scopeDepths[] = { 1, 4, 16, 64 };
+    for ( int i = 0 ; i < 4 ; i++ ) {
+        getVariable(scopeDepths[i], 10000000);
+    }
+    newNumber(100000000);
+    int lengths[] = { 8, 64, 512 };
+    for ( int i = 0 ; i < 3 ; i++ ) {
+        newString(lengths[i], 5000000);
+    }
+    for ( int i = 1 ; i <= 4 ; i *= 2 ) {
+        consoleLog(i, 5000000);
+    }
+    printf("\n]\n");
+    return 0;
+}
@@ -0,0 +1,51 @@
+#!/bin/sh
+#
+# Prints the results of out/bench-runtime and the times of the programs in bench/programs as one JSON object:
+#
+#     { "runtime": [ ... ], "programs": [ ... ] }
+#
+# Every program is transpiled and compiled with -O2, and run under node as well if it is installed. A program states
+# how many operations it does in its first line, `// operations: N`; the allocations of the transpiled program are the
+# ones CJS_GC_STATS reports. Output goes to /dev/null. With -s, make does not echo the commands that rebuild what the
+# benchmark needs either, so that stdout is only the JSON:
+#
+#     make -s bench-runtime > results.json
+
+set -e
+cd "$(dirname "$0")/.."
+
+RUNTIME="src/runtime.c src/gc.c src/slab.c src/hashtable.c src/atom.c src/number.c src/output.c src/stats.c src/snapshot.c src/profile.c"
+
+now() {
+    date +%s%N
+}
+
+perOperation() {
+    awk "BEGIN { printf \"%.3f\", $1 / $2 }"
+}
+
+printf '{\n"runtime": '
+out/bench-runtime
+printf ',\n"programs": ['
+separator=""
+for program in bench/programs/*.js; do
+    name=$(basename "$program" .js)
+    operations=$(sed -n '1s|^// operations: ||p' "$program")
+    out/transpiler --stdin < "$program" > "out/bench-$name.c"
+    gcc -O2 -o "out/bench-$name" -I src "out/bench-$name.c" $RUNTIME -lm
+    start=$(now)
+    stats=$(CJS_GC_STATS=1 "out/bench-$name" 2>&1 > /dev/null | sed -n 's|^gc: \([0-9]*\) cells of \([0-9]*\) bytes allocated.*|\1 \2|p')
+    end=$(now)
+    printf '%s\n  { "name": "%s", "runner": "cjs", "operations": %s, "ns_per_op": %s, "allocations_per_op": %s, "bytes_per_op": %s }' \
+        "$separator" "$name" "$operations" "$(perOperation $((end - start)) "$operations")" \
+        "$(perOperation "${stats% *}" "$operations")" "$(perOperation "${stats#* }" "$operations")"
+    separator=","
+    if command -v node > /dev/null; then
+        start=$(now)
+        node "$program" > /dev/null
+        end=$(now)
+        printf ',\n  { "name": "%s", "runner": "node", "operations": %s, "ns_per_op": %s }' \
+            "$name" "$operations" "$(perOperation $((end - start)) "$operations")"
+    fi
+done
+printf '\n]\n}\n'
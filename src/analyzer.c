@@ -0,0 +1,413 @@
+#include "analyzer.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "snapshot.h"
+
+/*
+ * Reads a heap snapshot and reports the nodes that retain the most memory, with a path from the root to each of them,
+ * and the strings that are stored more than once. What a node retains is what would be freed without it: its own bytes
+ * and those of every node it dominates, i.e. that can only be reached through it. The dominators are computed with the
+ * iterative algorithm of Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+ */
+
+#define REPORT_ROWS 20
+#define PATH_DEPTH  12
+
+typedef struct Node Node;
+typedef struct Edge Edge;
+
+struct Node {
+    uint64_t id;
+    char* kind;
+    size_t bytes;
+    char* label;
+    size_t retained;
+    int dominator;   // -1 until known, or if the node cannot be reached from the root
+    int postorder;
+    int parent;      // in the depth first search from the root, which gives the path that is reported
+    char* parentEdge;
+};
+
+struct Edge {
+    uint64_t from;
+    uint64_t to;
+    char* name;
+    int fromNode;
+    int toNode;
+};
+
+static Node* nodes = NULL;
+static int nodeCount = 0;
+static Edge* edges = NULL;
+static int edgeCount = 0;
+
+// The edges from each node, as ranges of successorEdges, and the nodes with edges to it.
+static int* successorStart = NULL;
+static int* successorEdges = NULL;
+static int* predecessorStart = NULL;
+static int* predecessors = NULL;
+
+static char* valueTypes[] = { "undefined", "null", "boolean", "number" };
+static uint64_t valueCounts[4];
+
+static int compareNodeIds(const void* left, const void* right) {
+    uint64_t a = ( (Node*) left )->id;
+    uint64_t b = ( (Node*) right )->id;
+    return a < b ? -1 : a > b;
+}
+
+static int nodeOf(uint64_t id) {
+    int low = 0;
+    int high = nodeCount - 1;
+    while ( low <= high ) {
+        int middle = ( low + high ) / 2;
+        if ( nodes[middle].id == id ) return middle;
+        if ( nodes[middle].id < id ) {
+            low = middle + 1;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return -1;
+}
+
+static char* copy(char* string) {
+    return string == NULL ? strdup("") : strdup(string);
+}
+
+static bool parse(FILE* file) {
+    char* line = NULL;
+    size_t size = 0;
+    int nodeCapacity = 0;
+    int edgeCapacity = 0;
+    if ( getline(&line, &size, file) < 0 || strncmp(line, SNAPSHOT_HEADER, strlen(SNAPSHOT_HEADER)) != 0 ) {
+        free(line);
+        return false;
+    }
+    while ( getline(&line, &size, file) >= 0 ) {
+        char* state;
+        char* record = strtok_r(line, " \n", &state);
+        char* fields[4];
+        for ( int i = 0 ; i < 4 ; i++ ) {
+            fields[i] = strtok_r(NULL, " \n", &state);
+        }
+        if ( record == NULL || fields[0] == NULL || fields[1] == NULL ) continue;
+        if ( strcmp(record, "node") == 0 ) {
+            if ( nodeCount == nodeCapacity ) {
+                nodeCapacity = nodeCapacity == 0 ? 1024 : nodeCapacity * 2;
+                nodes = (Node*) realloc(nodes, nodeCapacity * sizeof(Node));
+            }
+            Node* node = &nodes[nodeCount++];
+            memset(node, 0, sizeof(Node));
+            node->id = strtoull(fields[0], NULL, 16);
+            node->kind = copy(fields[1]);
+            node->bytes = fields[2] == NULL ? 0 : strtoull(fields[2], NULL, 10);
+            node->label = copy(fields[3]);
+        } else if ( strcmp(record, "edge") == 0 ) {
+            if ( edgeCount == edgeCapacity ) {
+                edgeCapacity = edgeCapacity == 0 ? 1024 : edgeCapacity * 2;
+                edges = (Edge*) realloc(edges, edgeCapacity * sizeof(Edge));
+            }
+            Edge* edge = &edges[edgeCount++];
+            edge->from = strtoull(fields[0], NULL, 16);
+            edge->to = strtoull(fields[1], NULL, 16);
+            edge->name = copy(fields[2]);
+        } else if ( strcmp(record, "value") == 0 ) {
+            for ( int i = 0 ; i < 4 ; i++ ) {
+                if ( strcmp(fields[1], valueTypes[i]) == 0 ) {
+                    valueCounts[i] += 1;
+                }
+            }
+        }
+    }
+    free(line);
+    return true;
+}
+
+// Resolves the ids of the edges, and lists the successors and predecessors of every node.
+static void link() {
+    qsort(nodes, nodeCount, sizeof(Node), compareNodeIds);
+    successorStart = (int*) calloc(nodeCount + 1, sizeof(int));
+    predecessorStart = (int*) calloc(nodeCount + 1, sizeof(int));
+    for ( int i = 0 ; i < edgeCount ; i++ ) {
+        edges[i].fromNode = nodeOf(edges[i].from);
+        edges[i].toNode = nodeOf(edges[i].to);
+        if ( edges[i].fromNode < 0 || edges[i].toNode < 0 ) continue;
+        successorStart[edges[i].fromNode + 1] += 1;
+        predecessorStart[edges[i].toNode + 1] += 1;
+    }
+    for ( int i = 0 ; i < nodeCount ; i++ ) {
+        successorStart[i + 1] += successorStart[i];
+        predecessorStart[i + 1] += predecessorStart[i];
+    }
+    successorEdges = (int*) malloc(( edgeCount + 1 ) * sizeof(int));
+    predecessors = (int*) malloc(( edgeCount + 1 ) * sizeof(int));
+    int* successorFill = (int*) calloc(nodeCount, sizeof(int));
+    int* predecessorFill = (int*) calloc(nodeCount, sizeof(int));
+    for ( int i = 0 ; i < edgeCount ; i++ ) {
+        int from = edges[i].fromNode;
+        int to = edges[i].toNode;
+        if ( from < 0 || to < 0 ) continue;
+        successorEdges[successorStart[from] + successorFill[from]++] = i;
+        predecessors[predecessorStart[to] + predecessorFill[to]++] = from;
+    }
+    free(successorFill);
+    free(predecessorFill);
+}
+
+// Numbers the nodes reachable from the root in postorder, with an explicit stack, and returns them in that order.
+static int* postorder(int root, int* count) {
+    int* order = (int*) malloc(nodeCount * sizeof(int));
+    int* stack = (int*) malloc(nodeCount * sizeof(int));
+    int* next = (int*) calloc(nodeCount, sizeof(int)); // the successor of each node on the stack to look at next
+    char* seen = (char*) calloc(nodeCount, 1);
+    int size = 0;
+    *count = 0;
+    stack[size++] = root;
+    seen[root] = 1;
+    nodes[root].parent = -1;
+    while ( size > 0 ) {
+        int node = stack[size - 1];
+        int i = successorStart[node] + next[node];
+        if ( i < successorStart[node + 1] ) {
+            next[node] += 1;
+            int successor = edges[successorEdges[i]].toNode;
+            if ( !seen[successor] ) {
+                seen[successor] = 1;
+                nodes[successor].parent = node;
+                nodes[successor].parentEdge = edges[successorEdges[i]].name;
+                stack[size++] = successor;
+            }
+            continue;
+        }
+        size -= 1;
+        nodes[node].postorder = *count;
+        order[(*count)++] = node;
+    }
+    free(stack);
+    free(next);
+    free(seen);
+    return order;
+}
+
+static int intersect(int left, int right) {
+    while ( left != right ) {
+        while ( nodes[left].postorder < nodes[right].postorder ) {
+            left = nodes[left].dominator;
+        }
+        while ( nodes[right].postorder < nodes[left].postorder ) {
+            right = nodes[right].dominator;
+        }
+    }
+    return left;
+}
+
+static void dominators(int root, int* order, int count) {
+    for ( int i = 0 ; i < nodeCount ; i++ ) {
+        nodes[i].dominator = -1;
+    }
+    nodes[root].dominator = root;
+    bool changed = true;
+    while ( changed ) {
+        changed = false;
+        // in reverse postorder, leaving out the root
+        for ( int i = count - 2 ; i >= 0 ; i-- ) {
+            int node = order[i];
+            int dominator = -1;
+            for ( int j = predecessorStart[node] ; j < predecessorStart[node + 1] ; j++ ) {
+                int predecessor = predecessors[j];
+                if ( nodes[predecessor].dominator < 0 ) continue;
+                dominator = dominator < 0 ? predecessor : intersect(predecessor, dominator);
+            }
+            if ( dominator != nodes[node].dominator ) {
+                nodes[node].dominator = dominator;
+                changed = true;
+            }
+        }
+    }
+    for ( int i = 0 ; i < nodeCount ; i++ ) {
+        nodes[i].retained = nodes[i].bytes;
+    }
+    // a dominator comes after every node it dominates in postorder
+    for ( int i = 0 ; i < count - 1 ; i++ ) {
+        int node = order[i];
+        nodes[nodes[node].dominator].retained += nodes[node].retained;
+    }
+}
+
+static void printUnescaped(FILE* file, char* chars) {
+    for ( ; *chars != 0 ; chars++ ) {
+        unsigned int c;
+        if ( *chars == '%' && sscanf(chars + 1, "%2x", &c) == 1 ) {
+            fputc(c < ' ' || c >= 0x7F ? '?' : (int) c, file);
+            chars += 2;
+        } else {
+            fputc(*chars, file);
+        }
+    }
+}
+
+// The path the search took to the node: `.name` for properties and variables, `[i]` for elements, `(name)` otherwise.
+static void printPath(FILE* file, int node) {
+    int path[PATH_DEPTH];
+    int depth = 0;
+    for ( ; nodes[node].parent >= 0 && depth < PATH_DEPTH ; node = nodes[node].parent ) {
+        path[depth++] = node;
+    }
+    if ( nodes[node].parent >= 0 ) {
+        fprintf(file, "...");
+    }
+    for ( int i = depth - 1 ; i >= 0 ; i-- ) {
+        char* name = nodes[path[i]].parentEdge;
+        if ( strncmp(name, "e:", 2) == 0 ) {
+            fprintf(file, "[%s]", name + 2);
+        } else if ( strncmp(name, "i:", 2) == 0 ) {
+            fprintf(file, "(%s)", name + 2);
+        } else {
+            fprintf(file, i == depth - 1 ? "" : ".");
+            printUnescaped(file, name + 2);
+        }
+    }
+    fprintf(file, "\n");
+}
+
+static int compareRetained(const void* left, const void* right) {
+    size_t a = nodes[*(int*) left].retained;
+    size_t b = nodes[*(int*) right].retained;
+    return a > b ? -1 : a < b;
+}
+
+static void reportRetainers(FILE* file) {
+    int* ranked = (int*) malloc(nodeCount * sizeof(int));
+    int count = 0;
+    for ( int i = 0 ; i < nodeCount ; i++ ) {
+        if ( nodes[i].dominator >= 0 && nodes[i].parent >= 0 && strcmp(nodes[i].kind, "globals") != 0 ) {
+            ranked[count++] = i;
+        }
+    }
+    qsort(ranked, count, sizeof(int), compareRetained);
+    fprintf(file, "\ntop retainers:\n  %14s %12s  %-8s  path\n", "retained", "self", "kind");
+    for ( int i = 0 ; i < count && i < REPORT_ROWS ; i++ ) {
+        Node* node = &nodes[ranked[i]];
+        fprintf(file, "  %14zu %12zu  %-8s  ", node->retained, node->bytes, node->kind);
+        printPath(file, ranked[i]);
+    }
+    free(ranked);
+}
+
+// Strings with the same length and hash, ordered by their length and hash.
+static int compareStrings(const void* left, const void* right) {
+    return strcmp(nodes[*(int*) left].label, nodes[*(int*) right].label);
+}
+
+typedef struct Duplicate {
+    int node;
+    int copies;
+    size_t wasted;
+} Duplicate;
+
+static int compareWasted(const void* left, const void* right) {
+    size_t a = ( (Duplicate*) left )->wasted;
+    size_t b = ( (Duplicate*) right )->wasted;
+    return a > b ? -1 : a < b;
+}
+
+// The length and hash at the start of a string's label, which make it a duplicate of another.
+static size_t identityLength(char* label) {
+    char* colon = strchr(label, ':');
+    colon = colon == NULL ? NULL : strchr(colon + 1, ':');
+    return colon == NULL ? strlen(label) : (size_t) ( colon - label );
+}
+
+static void reportDuplicates(FILE* file) {
+    int* strings = (int*) malloc(nodeCount * sizeof(int));
+    int count = 0;
+    for ( int i = 0 ; i < nodeCount ; i++ ) {
+        if ( strcmp(nodes[i].kind, "string") == 0 ) {
+            strings[count++] = i;
+        }
+    }
+    qsort(strings, count, sizeof(int), compareStrings);
+    Duplicate* duplicates = (Duplicate*) malloc(( count + 1 ) * sizeof(Duplicate));
+    int duplicateCount = 0;
+    for ( int i = 0 ; i < count ; ) {
+        char* label = nodes[strings[i]].label;
+        size_t length = identityLength(label);
+        int j = i + 1;
+        size_t wasted = 0;
+        for ( ; j < count && identityLength(nodes[strings[j]].label) == length && strncmp(nodes[strings[j]].label, label, length) == 0 ; j++ ) {
+            wasted += nodes[strings[j]].bytes;
+        }
+        if ( j - i > 1 ) {
+            Duplicate duplicate = { strings[i], j - i, wasted };
+            duplicates[duplicateCount++] = duplicate;
+        }
+        i = j;
+    }
+    qsort(duplicates, duplicateCount, sizeof(Duplicate), compareWasted);
+    fprintf(file, "\nduplicate strings:\n  %8s %14s  string\n", "copies", "wasted");
+    for ( int i = 0 ; i < duplicateCount && i < REPORT_ROWS ; i++ ) {
+        char* label = nodes[duplicates[i].node].label;
+        fprintf(file, "  %8d %14zu  ", duplicates[i].copies, duplicates[i].wasted);
+        char* colon = strchr(label, ':');
+        fprintf(file, "length %.*s \"", colon == NULL ? 0 : (int) ( colon - label ), label);
+        printUnescaped(file, label + identityLength(label) + ( label[identityLength(label)] == ':' ));
+        fprintf(file, "\"\n");
+    }
+    free(duplicates);
+    free(strings);
+}
+
+static void reportKinds(FILE* file) {
+    static char* kinds[] = { "object", "array", "function", "string", "rope", "scope" };
+    size_t totalBytes = 0;
+    for ( int i = 0 ; i < nodeCount ; i++ ) {
+        totalBytes += nodes[i].bytes;
+    }
+    fprintf(file, "%d nodes, %zu bytes, %d references\n\n  %-10s %12s %14s\n", nodeCount, totalBytes, edgeCount, "kind", "count", "bytes");
+    for ( int k = 0 ; k < sizeof(kinds) / sizeof(char*) ; k++ ) {
+        size_t count = 0;
+        size_t bytes = 0;
+        for ( int i = 0 ; i < nodeCount ; i++ ) {
+            if ( strcmp(nodes[i].kind, kinds[k]) == 0 ) {
+                count += 1;
+                bytes += nodes[i].bytes;
+            }
+        }
+        fprintf(file, "  %-10s %12zu %14zu\n", kinds[k], count, bytes);
+    }
+    fprintf(file, "\nvalues that are not strings or objects:");
+    for ( int i = 0 ; i < 4 ; i++ ) {
+        fprintf(file, "%s %s %llu", i == 0 ? "" : ",", valueTypes[i], (unsigned long long) valueCounts[i]);
+    }
+    fprintf(file, "\n");
+}
+
+int Analyzer_run(char* path, FILE* output) {
+    FILE* file = fopen(path, "r");
+    if ( file == NULL || !parse(file) ) {
+        fprintf(stderr, "not a heap snapshot: %s\n", path);
+        if ( file != NULL ) {
+            fclose(file);
+        }
+        return 1;
+    }
+    fclose(file);
+    link();
+    int root = nodeOf(0);
+    if ( root < 0 ) {
+        fprintf(stderr, "heap snapshot without a root: %s\n", path);
+        return 1;
+    }
+    int count;
+    int* order = postorder(root, &count);
+    dominators(root, order, count);
+    free(order);
+    reportKinds(output);
+    reportRetainers(output);
+    reportDuplicates(output);
+    return 0;
+}
@@ -0,0 +1,13 @@
+#ifndef ANALYZER_H
+#define ANALYZER_H
+
+#include <stdio.h>
+
+/*
+ * The report of `transpiler --analyze-snapshot <file>` on a heap snapshot, see snapshot.h: the bytes by kind of node,
+ * the nodes that retain the most, with a path to each of them, and the strings held more than once.
+ */
+
+int Analyzer_run(char*, FILE*);
+
+#endif
@@ -6,6 +6,8 @@
 
 static int argumentCount;
 static char** arguments;
+static int valuelessCount = 0;
+static char** valueless = NULL;
 
 void args_init(int argc, char** argv) {
     argumentCount = argc - 1;
@@ -15,6 +17,26 @@ void args_init(int argc, char** argv) {
     }
 }
 
+// Flags that take no value, so that args_varargs() does not skip the argument after them, as in `--instrument file.js`.
+void args_valueless(int vaCount, ...) {
+    va_list va;
+    va_start(va, vaCount);
+    valueless = (char**) realloc(valueless, ( valuelessCount + vaCount ) * sizeof(char*));
+    for ( int i = 0 ; i < vaCount ; i++ ) {
+        valueless[valuelessCount++] = va_arg(va, char*);
+    }
+    va_end(va);
+}
+
+static char isValueless(char* name) {
+    for ( int i = 0 ; i < valuelessCount ; i++ ) {
+        if ( strcmp(name, valueless[i]) == 0 ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 char args_flag(char* name) {
     return args_flagv(1, name);
 }
@@ -48,7 +70,9 @@ int args_varargs(char** varargs) {
     int num = 0;
     for ( int i = 0 ; i < argumentCount ; i++ ) {
         if ( strncmp(arguments[i], "-", 1) == 0 ) {
-            i++;
+            if ( !isValueless(arguments[i]) ) {
+                i++;
+            }
         } else {
             num++;
             if ( varargs != NULL ) {
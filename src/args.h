@@ -2,6 +2,7 @@
 #define ARGS_H
 
 void args_init(int argc, char** argv);
+void args_valueless(int count, ...);
 char args_flag(char* name);
 char args_flagv(int count, ...);
 char* args_value(char* name);
@@ -0,0 +1,70 @@
+#include "atom.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hashtable.h"
+
+// Every atom, in an open addressing table with linear probing that is kept at most half full. Atoms are never freed.
+static Atom** atoms = NULL;
+static size_t capacity = 0;
+static size_t count = 0;
+
+static void insert(Atom* atom) {
+    size_t mask = capacity - 1;
+    size_t i = atom->hash & mask;
+    while ( atoms[i] != NULL ) {
+        i = ( i + 1 ) & mask;
+    }
+    atoms[i] = atom;
+}
+
+static void grow() {
+    Atom** oldAtoms = atoms;
+    size_t oldCapacity = capacity;
+    capacity = capacity == 0 ? 1024 : capacity * 2;
+    if ( ( atoms = (Atom**) calloc(capacity, sizeof(Atom*)) ) == NULL ) {
+        fprintf(stderr, "Out of memory: atom table of %zu slots\n", capacity);
+        exit(1);
+    }
+    for ( size_t i = 0 ; i < oldCapacity ; i++ ) {
+        if ( oldAtoms[i] != NULL ) {
+            insert(oldAtoms[i]);
+        }
+    }
+    free(oldAtoms);
+}
+
+// The atom of a name, which is created the first time the name is interned.
+char* atom_intern(char* name) {
+    return atom_internHashed(name, ht_hash(name));
+}
+
+// The atom of a name whose ht_hash() is `hash`.
+char* atom_internHashed(char* name, uint64_t hash) {
+    if ( capacity > 0 ) {
+        size_t mask = capacity - 1;
+        for ( size_t i = hash & mask ; atoms[i] != NULL ; i = ( i + 1 ) & mask ) {
+            if ( atoms[i]->hash == hash && strcmp(atoms[i]->name, name) == 0 ) {
+                return atoms[i]->name;
+            }
+        }
+    }
+    if ( ( count + 1 ) * 2 > capacity ) {
+        grow();
+    }
+    size_t length = strlen(name);
+    Atom* atom = (Atom*) malloc(sizeof(Atom) + length + 1);
+    atom->hash = hash;
+    memcpy(atom->name, name, length + 1);
+    insert(atom);
+    count += 1;
+    return atom->name;
+}
+
+// Replaces every name of a NULL terminated table with its atom.
+void atom_internAll(char** names) {
+    for ( ; *names != NULL ; names++ ) {
+        *names = atom_intern(*names);
+    }
+}
@@ -0,0 +1,36 @@
+#ifndef ATOM_H
+#define ATOM_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Names of variables and properties are interned: every distinct name is stored once, together with its hash, for as
+ * long as the program runs, and passed around as a pointer to its characters, an atom. Two atoms are the same name
+ * exactly when they are the same pointer, so the hashtables of the runtime, which are all keyed by atoms, neither hash
+ * nor compare strings on a lookup.
+ *
+ * Generated code interns the names it uses at startup, all at once from a table of its own with atom_internAll(), and
+ * then refers to them by their index in that table. Names only known at run time, like the key of `object[key]`, are
+ * interned by atom_intern() where they are used, or by atom_internHashed() when their ht_hash() is known already.
+ * Within the runtime, ATOM("name") interns a literal once per site.
+ */
+
+typedef struct Atom Atom;
+
+struct Atom {
+    uint64_t hash;
+    char name[];
+};
+
+char* atom_intern(char*);
+char* atom_internHashed(char*, uint64_t);
+void atom_internAll(char**);
+
+static inline uint64_t atom_hash(char* atom) {
+    return ( (Atom*) ( atom - offsetof(Atom, name) ) )->hash;
+}
+
+#define ATOM(string) ({ static char* atom = NULL; atom != NULL ? atom : ( atom = atom_intern(string) ); })
+
+#endif
@@ -48,6 +48,12 @@ static void yyerror(char *s) {
     AssignmentExpression_node*    assignmentExpression_node;
     AssignmentOperator_enum       assignmentOperator_enum;
     CallExpression_node*          callExpression_node;
+    BinaryExpression_node*        binaryExpression_node;
+    UnaryExpression_node*         unaryExpression_node;
+    IterationStatement_node*      iterationStatement_node;
+    ObjectLiteral_node*           objectLiteral_node;
+    PropertyAssignment_node*      propertyAssignment_node;
+    ArrayLiteral_node*            arrayLiteral_node;
     ArgumentList_node*            argumentList_node;
     ReturnStatement_node*         returnStatement_node;
     Literal_node*                 literal_node;
@@ -59,6 +65,8 @@ static void yyerror(char *s) {
 
 %token LEXER_ERROR
 
+%token DO
+%token FOR
 %token FALSE_LITERAL
 %token FUNCTION
 %token NULL_LITERAL
@@ -66,7 +74,9 @@ static void yyerror(char *s) {
 %token THIS
 %token TRUE_LITERAL
 %token VAR
+%token WHILE
 
+%token COLON
 %token COMMA
 %token DOT
 %token EQUALS
@@ -78,6 +88,30 @@ static void yyerror(char *s) {
 %token RIGHT_PAREN
 %token SEMICOLON
 
+%token AMPERSAND
+%token AMPERSAND_AMPERSAND
+%token ASTERISK
+%token CARET
+%token EQUALS_EQUALS
+%token EQUALS_EQUALS_EQUALS
+%token EXCLAMATION
+%token EXCLAMATION_EQUALS
+%token EXCLAMATION_EQUALS_EQUALS
+%token GREATER_THAN
+%token GREATER_THAN_EQUALS
+%token LEFT_SHIFT
+%token LESS_THAN
+%token LESS_THAN_EQUALS
+%token MINUS
+%token PERCENT
+%token PIPE
+%token PIPE_PIPE
+%token PLUS
+%token RIGHT_SHIFT
+%token SLASH
+%token TILDE
+%token UNSIGNED_RIGHT_SHIFT
+
 %token <char_array> IDENTIFIER
 %token <double_val> NUMBER_LITERAL
 %token <char_array> STRING_LITERAL
@@ -102,6 +136,16 @@ static void yyerror(char *s) {
 %type <assignmentExpression_node>    AssignmentExpression
 %type <assignmentOperator_enum>      AssignmentOperator
 %type <callExpression_node>          CallExpression
+%type <binaryExpression_node>        BinaryExpression
+%type <unaryExpression_node>         UnaryExpression
+%type <iterationStatement_node>      IterationStatement
+%type <objectLiteral_node>           ObjectLiteral
+%type <expression_node>              EmptyObjectLiteral
+%type <objectLiteral_node>           PropertyNameAndValueList
+%type <propertyAssignment_node>      PropertyAssignment
+%type <literal_node>                 PropertyName
+%type <arrayLiteral_node>            ArrayLiteral
+%type <arrayLiteral_node>            ElementList
 %type <argumentList_node>            ArgumentList
 %type <returnStatement_node>         ReturnStatement
 %type <literal_node>                 Literal
@@ -111,6 +155,17 @@ static void yyerror(char *s) {
 %type <stringLiteral_node>           StringLiteral
 
 %nonassoc ASSIGNMENT_PRECEDENCE
+%left PIPE_PIPE
+%left AMPERSAND_AMPERSAND
+%left PIPE
+%left CARET
+%left AMPERSAND
+%left EQUALS_EQUALS EXCLAMATION_EQUALS EQUALS_EQUALS_EQUALS EXCLAMATION_EQUALS_EQUALS
+%left LESS_THAN GREATER_THAN LESS_THAN_EQUALS GREATER_THAN_EQUALS
+%left LEFT_SHIFT RIGHT_SHIFT UNSIGNED_RIGHT_SHIFT
+%left PLUS MINUS
+%left ASTERISK SLASH PERCENT
+%right UNARY_PRECEDENCE
 %left DOT LEFT_BRACKET LEFT_PAREN
 
 %start Program
@@ -144,7 +199,7 @@ FunctionDeclaration:
     ;
 
 FormalParameterList:
-    Identifier { debug("parsed FormalParameterList"); $$ = createFormalParameterList(); $$->append($$, $1) }
+    Identifier { debug("parsed FormalParameterList"); $$ = createFormalParameterList(); $$->append($$, $1); }
     | FormalParameterList COMMA Identifier { debug("parsed FormalParameterList"); $1->append($1, $3); $$ = $1; }
     ;
 
@@ -157,7 +212,7 @@ Statement:
     | EmptyStatement { debug("parsed Statement"); $$ = createStatement(EMPTY_STATEMENT_TYPE, $1); }
     | ExpressionStatement { debug("parsed Statement"); $$ = createStatement(EXPRESSION_STATEMENT_TYPE, $1); }
 //    | IfStatement { debug("parsed Statement"); }
-//    | IterationStatement { debug("parsed Statement"); }
+    | IterationStatement { debug("parsed Statement"); $$ = createStatement(ITERATION_STATEMENT_TYPE, $1); }
 //    | ContinueStatement { debug("parsed Statement"); }
 //    | BreakStatement { debug("parsed Statement"); }
     | ReturnStatement { debug("parsed Statement"); $$ = createStatement(RETURN_STATEMENT_TYPE, $1); }
@@ -190,6 +245,7 @@ VariableDeclaration:
 
 Initializer:
     EQUALS Expression { debug("parsed Initializer"); $$ = createInitializer($2); }
+    | EQUALS EmptyObjectLiteral { debug("parsed Initializer"); $$ = createInitializer($2); }
     ;
 
 EmptyStatement:
@@ -205,25 +261,26 @@ ExpressionStatement:
 //    | IF LEFT_PAREN Expression RIGHT_PAREN Statement { debug("parsed IfStatement") }
 //    ;
 //
-//IterationStatement:
-//    WHILE LEFT_PAREN Expression RIGHT_PAREN { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN SEMICOLON SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN SEMICOLON SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN SEMICOLON Expression SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN SEMICOLON Expression SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN Expression SEMICOLON SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN Expression SEMICOLON SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN Expression SEMICOLON Expression SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN Expression SEMICOLON Expression SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN VAR VariableDeclarationList SEMICOLON SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN VAR VariableDeclarationList SEMICOLON SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN VAR VariableDeclarationList SEMICOLON Expression SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    | FOR LEFT_PAREN VAR VariableDeclarationList SEMICOLON Expression SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
+IterationStatement:
+    DO Statement WHILE LEFT_PAREN Expression RIGHT_PAREN SEMICOLON { debug("parsed IterationStatement"); $$ = createIterationStatement(DO_WHILE_ITERATION_STATEMENT_TYPE, NULL, NULL, $5, NULL, $2); }
+    | WHILE LEFT_PAREN Expression RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(WHILE_ITERATION_STATEMENT_TYPE, NULL, NULL, $3, NULL, $5); }
+    | FOR LEFT_PAREN SEMICOLON SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, NULL, NULL, NULL, NULL, $6); }
+    | FOR LEFT_PAREN SEMICOLON SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, NULL, NULL, NULL, $5, $7); }
+    | FOR LEFT_PAREN SEMICOLON Expression SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, NULL, NULL, $4, NULL, $7); }
+    | FOR LEFT_PAREN SEMICOLON Expression SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, NULL, NULL, $4, $6, $8); }
+    | FOR LEFT_PAREN Expression SEMICOLON SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, NULL, $3, NULL, NULL, $7); }
+    | FOR LEFT_PAREN Expression SEMICOLON SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, NULL, $3, NULL, $6, $8); }
+    | FOR LEFT_PAREN Expression SEMICOLON Expression SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, NULL, $3, $5, NULL, $8); }
+    | FOR LEFT_PAREN Expression SEMICOLON Expression SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, NULL, $3, $5, $7, $9); }
+    | FOR LEFT_PAREN VAR VariableDeclarationList SEMICOLON SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, $4, NULL, NULL, NULL, $8); }
+    | FOR LEFT_PAREN VAR VariableDeclarationList SEMICOLON SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, $4, NULL, NULL, $7, $9); }
+    | FOR LEFT_PAREN VAR VariableDeclarationList SEMICOLON Expression SEMICOLON RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, $4, NULL, $6, NULL, $9); }
+    | FOR LEFT_PAREN VAR VariableDeclarationList SEMICOLON Expression SEMICOLON Expression RIGHT_PAREN Statement { debug("parsed IterationStatement"); $$ = createIterationStatement(FOR_ITERATION_STATEMENT_TYPE, $4, NULL, $6, $8, $10); }
 //    | FOR LEFT_PAREN LeftHandSideExpression IN Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
 //    | FOR LEFT_PAREN VAR Identifier IN Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
 //    | FOR LEFT_PAREN VAR Identifier Initializer IN Expression RIGHT_PAREN Statement { debug("parsed IterationStatement") }
-//    ;
-//
+    ;
+
 //ContinueStatement:
 //    CONTINUE SEMICOLON { debug("parsed ContinueStatement") }
 //    ;
@@ -235,6 +292,7 @@ ExpressionStatement:
 ReturnStatement:
     RETURN SEMICOLON { debug("parsed ReturnStatement"); $$ = createReturnStatement(NULL); }
     | RETURN Expression SEMICOLON { debug("parsed ReturnStatement"); $$ = createReturnStatement($2); }
+    | RETURN EmptyObjectLiteral SEMICOLON { debug("parsed ReturnStatement"); $$ = createReturnStatement($2); }
     ;
 
 //WithStatement:
@@ -248,9 +306,52 @@ Expression:
     | Identifier { debug("parsed Expression"); $$ = createExpression(IDENTIFIER_EXPRESSION_TYPE, $1); }
     | Literal { debug("parsed Expression"); $$ = createExpression(LITERAL_EXPRESSION_TYPE, $1); }
     | LEFT_PAREN Expression RIGHT_PAREN { debug("parsed Expression"); $$ = $2; }
+    | LEFT_PAREN EmptyObjectLiteral RIGHT_PAREN { debug("parsed Expression"); $$ = $2; }
     | AssignmentExpression { debug("parsed Expression"); $$ = createExpression(ASSIGNMENT_EXPRESSION_TYPE, $1); }
     | MemberExpression { debug("parsed Expression"); $$ = createExpression(MEMBER_EXPRESSION_TYPE, $1); };
     | CallExpression { debug("parsed Expression"); $$ = createExpression(CALL_EXPRESSION_TYPE, $1); }
+    | BinaryExpression { debug("parsed Expression"); $$ = createExpression(BINARY_EXPRESSION_TYPE, $1); }
+    | UnaryExpression { debug("parsed Expression"); $$ = createExpression(UNARY_EXPRESSION_TYPE, $1); }
+    | ObjectLiteral { debug("parsed Expression"); $$ = createExpression(OBJECT_LITERAL_EXPRESSION_TYPE, $1); }
+    | ArrayLiteral { debug("parsed Expression"); $$ = createExpression(ARRAY_LITERAL_EXPRESSION_TYPE, $1); }
+    ;
+
+ArrayLiteral:
+    LEFT_BRACKET RIGHT_BRACKET { debug("parsed ArrayLiteral"); $$ = createArrayLiteral(); }
+    | LEFT_BRACKET ElementList RIGHT_BRACKET { debug("parsed ArrayLiteral"); $$ = $2; }
+    ;
+
+ElementList:
+    Expression { debug("parsed ElementList"); $$ = createArrayLiteral(); $$->append($$, $1); }
+    | EmptyObjectLiteral { debug("parsed ElementList"); $$ = createArrayLiteral(); $$->append($$, $1); }
+    | ElementList COMMA Expression { debug("parsed ElementList"); $1->append($1, $3); $$ = $1; }
+    | ElementList COMMA EmptyObjectLiteral { debug("parsed ElementList"); $1->append($1, $3); $$ = $1; }
+    ;
+
+ObjectLiteral:
+    LEFT_BRACE PropertyNameAndValueList RIGHT_BRACE { debug("parsed ObjectLiteral"); $$ = $2; }
+    ;
+
+// `{}` at the start of a statement is an empty Block, so an empty ObjectLiteral is only an Expression where no
+// statement can start.
+EmptyObjectLiteral:
+    LEFT_BRACE RIGHT_BRACE { debug("parsed ObjectLiteral"); $$ = createExpression(OBJECT_LITERAL_EXPRESSION_TYPE, createObjectLiteral()); }
+    ;
+
+PropertyNameAndValueList:
+    PropertyAssignment { debug("parsed PropertyNameAndValueList"); $$ = createObjectLiteral(); $$->append($$, $1); }
+    | PropertyNameAndValueList COMMA PropertyAssignment { debug("parsed PropertyNameAndValueList"); $1->append($1, $3); $$ = $1; }
+    ;
+
+PropertyAssignment:
+    PropertyName COLON Expression { debug("parsed PropertyAssignment"); $$ = createPropertyAssignment($1, $3); }
+    | PropertyName COLON EmptyObjectLiteral { debug("parsed PropertyAssignment"); $$ = createPropertyAssignment($1, $3); }
+    ;
+
+PropertyName:
+    Identifier { debug("parsed PropertyName"); $$ = createLiteral(STRING_LITERAL_TYPE, createStringLiteral($1->name)); }
+    | StringLiteral { debug("parsed PropertyName"); $$ = createLiteral(STRING_LITERAL_TYPE, $1); }
+    | NumberLiteral { debug("parsed PropertyName"); $$ = createLiteral(NUMBER_LITERAL_TYPE, $1); }
     ;
 
 MemberExpression:
@@ -265,11 +366,45 @@ CallExpression:
 
 ArgumentList:
     Expression { debug("parsed ArgumentList"); $$ = createArgumentList(); $$->append($$, $1); }
+    | EmptyObjectLiteral { debug("parsed ArgumentList"); $$ = createArgumentList(); $$->append($$, $1); }
     | ArgumentList COMMA Expression { debug("parsed ArgumentList"); $1->append($1, $3); $$ = $1; }
+    | ArgumentList COMMA EmptyObjectLiteral { debug("parsed ArgumentList"); $1->append($1, $3); $$ = $1; }
+    ;
+
+BinaryExpression:
+    Expression ASTERISK Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, ASTERISK_BINARY_OPERATOR, $3); }
+    | Expression SLASH Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, SLASH_BINARY_OPERATOR, $3); }
+    | Expression PERCENT Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, PERCENT_BINARY_OPERATOR, $3); }
+    | Expression PLUS Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, PLUS_BINARY_OPERATOR, $3); }
+    | Expression MINUS Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, MINUS_BINARY_OPERATOR, $3); }
+    | Expression LEFT_SHIFT Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, LEFT_SHIFT_BINARY_OPERATOR, $3); }
+    | Expression RIGHT_SHIFT Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, RIGHT_SHIFT_BINARY_OPERATOR, $3); }
+    | Expression UNSIGNED_RIGHT_SHIFT Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, UNSIGNED_RIGHT_SHIFT_BINARY_OPERATOR, $3); }
+    | Expression LESS_THAN Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, LESS_THAN_BINARY_OPERATOR, $3); }
+    | Expression GREATER_THAN Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, GREATER_THAN_BINARY_OPERATOR, $3); }
+    | Expression LESS_THAN_EQUALS Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, LESS_THAN_EQUALS_BINARY_OPERATOR, $3); }
+    | Expression GREATER_THAN_EQUALS Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, GREATER_THAN_EQUALS_BINARY_OPERATOR, $3); }
+    | Expression EQUALS_EQUALS Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, EQUALS_EQUALS_BINARY_OPERATOR, $3); }
+    | Expression EXCLAMATION_EQUALS Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, EXCLAMATION_EQUALS_BINARY_OPERATOR, $3); }
+    | Expression EQUALS_EQUALS_EQUALS Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, EQUALS_EQUALS_EQUALS_BINARY_OPERATOR, $3); }
+    | Expression EXCLAMATION_EQUALS_EQUALS Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, EXCLAMATION_EQUALS_EQUALS_BINARY_OPERATOR, $3); }
+    | Expression AMPERSAND Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, AMPERSAND_BINARY_OPERATOR, $3); }
+    | Expression CARET Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, CARET_BINARY_OPERATOR, $3); }
+    | Expression PIPE Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, PIPE_BINARY_OPERATOR, $3); }
+    | Expression AMPERSAND_AMPERSAND Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, AMPERSAND_AMPERSAND_BINARY_OPERATOR, $3); }
+    | Expression PIPE_PIPE Expression { debug("parsed BinaryExpression"); $$ = createBinaryExpression($1, PIPE_PIPE_BINARY_OPERATOR, $3); }
+    ;
+
+UnaryExpression:
+    PLUS Expression %prec UNARY_PRECEDENCE { debug("parsed UnaryExpression"); $$ = createUnaryExpression(PLUS_UNARY_OPERATOR, $2); }
+    | MINUS Expression %prec UNARY_PRECEDENCE { debug("parsed UnaryExpression"); $$ = createUnaryExpression(MINUS_UNARY_OPERATOR, $2); }
+    | TILDE Expression %prec UNARY_PRECEDENCE { debug("parsed UnaryExpression"); $$ = createUnaryExpression(TILDE_UNARY_OPERATOR, $2); }
+    | EXCLAMATION Expression %prec UNARY_PRECEDENCE { debug("parsed UnaryExpression"); $$ = createUnaryExpression(EXCLAMATION_UNARY_OPERATOR, $2); }
     ;
 
 AssignmentExpression:
     LeftHandSideExpression AssignmentOperator Expression %prec ASSIGNMENT_PRECEDENCE { debug("parsed AssignmentExpression"); $$ = createAssignmentExpression($1, $2, $3); }
+    | LeftHandSideExpression AssignmentOperator EmptyObjectLiteral { debug("parsed AssignmentExpression"); $$ = createAssignmentExpression($1, $2, $3); }
     ;
 
 AssignmentOperator:
@@ -0,0 +1,527 @@
+#include "bytecode.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BYTECODE_MAGIC   "CJSB"
+#define BYTECODE_VERSION 5
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Compiler
+
+static void compileStatement(Bytecode*, BytecodeFunction*, Statement_node*);
+static void compileExpression(Bytecode*, BytecodeFunction*, Expression_node*);
+
+static void unsupported(char* what) {
+    fprintf(stderr, "Unsupported Operation: %s cannot be interpreted\n", what);
+    exit(1);
+}
+
+// How many values an instruction takes off the stack and leaves on it, so the interpreter knows how much stack a
+// function needs. Jumps that keep their operand only do so when they jump; the code they jump over ends with the
+// same number of values on the stack.
+static int stackEffect(Opcode_enum opcode, uint32_t operand) {
+    switch (opcode) {
+        case PUSH_UNDEFINED_OPCODE:
+        case PUSH_NULL_OPCODE:
+        case PUSH_TRUE_OPCODE:
+        case PUSH_FALSE_OPCODE:
+        case PUSH_CONSTANT_OPCODE:
+        case PUSH_FUNCTION_OPCODE:
+        case GET_VARIABLE_OPCODE:
+        case NEW_OBJECT_OPCODE:
+            return 1;
+        case POP_OPCODE:
+        case SET_PROPERTY_OPCODE:
+        case INIT_PROPERTY_OPCODE:
+        case RETURN_OPCODE:
+        case JUMP_IF_FALSE_OPCODE:
+        case JUMP_IF_TRUE_OPCODE:
+        case JUMP_IF_FALSE_OR_POP_OPCODE:
+        case JUMP_IF_TRUE_OR_POP_OPCODE:
+        case GET_PROPERTY_DYNAMIC_OPCODE:
+            return -1;
+        case SET_PROPERTY_DYNAMIC_OPCODE:
+        case INIT_PROPERTY_DYNAMIC_OPCODE:
+            return -2;
+        case CALL_OPCODE:
+            return -(int)operand;
+        case NEW_ARRAY_OPCODE:
+            return 1 - (int)operand;
+        default:
+            if ( opcode >= ADD_OPCODE && opcode < TO_NUMBER_OPCODE ) return -1;
+            return 0;
+    }
+}
+
+static int depth = 0;
+
+static int emit(BytecodeFunction* function, Opcode_enum opcode, uint32_t operand) {
+    if ( operand > BYTECODE_MAX_OPERAND ) unsupported("a program this large");
+    function->code = (uint32_t*) realloc(function->code, ( function->length + 1 ) * sizeof(uint32_t) );
+    function->code[function->length] = BYTECODE_INSTRUCTION(opcode, operand);
+    function->length += 1;
+    depth += stackEffect(opcode, operand);
+    if ( depth > function->stackSize ) function->stackSize = depth;
+    return function->length - 1;
+}
+
+// Points the jump emitted at `instruction` to the next instruction.
+static void patch(BytecodeFunction* function, int instruction) {
+    function->code[instruction] = BYTECODE_INSTRUCTION(BYTECODE_OPCODE(function->code[instruction]), function->length);
+}
+
+static uint32_t addConstant(Bytecode* bytecode, ConstantType_enum type, double number, char* string) {
+    for ( int i = 0 ; i < bytecode->constantCount ; i++ ) {
+        BytecodeConstant* constant = &bytecode->constants[i];
+        if ( constant->type != type ) continue;
+        if ( type == NUMBER_CONSTANT_TYPE ? memcmp(&constant->number, &number, sizeof(double)) == 0 : strcmp(constant->string, string) == 0 ) {
+            return i;
+        }
+    }
+    bytecode->constants = (BytecodeConstant*) realloc(bytecode->constants, ( bytecode->constantCount + 1 ) * sizeof(BytecodeConstant) );
+    bytecode->constants[bytecode->constantCount].type = type;
+    bytecode->constants[bytecode->constantCount].number = number;
+    bytecode->constants[bytecode->constantCount].string = string == NULL ? NULL : strdup(string);
+    bytecode->constantCount += 1;
+    return bytecode->constantCount - 1;
+}
+
+static uint32_t numberConstant(Bytecode* bytecode, double number) {
+    return addConstant(bytecode, NUMBER_CONSTANT_TYPE, number, NULL);
+}
+
+static uint32_t stringConstant(Bytecode* bytecode, char* string) {
+    return addConstant(bytecode, STRING_CONSTANT_TYPE, 0, string);
+}
+
+static BytecodeFunction* addFunction(Bytecode* bytecode) {
+    BytecodeFunction* function = (BytecodeFunction*) calloc(1, sizeof(BytecodeFunction));
+    bytecode->functions = (BytecodeFunction**) realloc(bytecode->functions, ( bytecode->functionCount + 1 ) * sizeof(BytecodeFunction*) );
+    bytecode->functions[bytecode->functionCount] = function;
+    bytecode->functionCount += 1;
+    return function;
+}
+
+static void compileLiteral(Bytecode* bytecode, BytecodeFunction* function, Literal_node* literal) {
+    switch (literal->type) {
+        case NULL_LITERAL_TYPE:
+            emit(function, PUSH_NULL_OPCODE, 0);
+            break;
+        case BOOLEAN_LITERAL_TYPE:
+            emit(function, literal->literalUnion.booleanLiteral->boolean ? PUSH_TRUE_OPCODE : PUSH_FALSE_OPCODE, 0);
+            break;
+        case NUMBER_LITERAL_TYPE:
+            emit(function, PUSH_CONSTANT_OPCODE, numberConstant(bytecode, literal->literalUnion.numberLiteral->number));
+            break;
+        case STRING_LITERAL_TYPE:
+            emit(function, PUSH_CONSTANT_OPCODE, stringConstant(bytecode, literal->literalUnion.stringLiteral->string));
+            break;
+    }
+}
+
+static void compileMemberKey(Bytecode* bytecode, BytecodeFunction* function, MemberExpression_node* memberExpression) {
+    compileExpression(bytecode, function, memberExpression->child.expression);
+}
+
+static void compileBinaryExpression(Bytecode* bytecode, BytecodeFunction* function, BinaryExpression_node* binaryExpression) {
+    compileExpression(bytecode, function, binaryExpression->left);
+    if ( binaryExpression->binaryOperator == AMPERSAND_AMPERSAND_BINARY_OPERATOR || binaryExpression->binaryOperator == PIPE_PIPE_BINARY_OPERATOR ) {
+        int jump = emit(function, binaryExpression->binaryOperator == AMPERSAND_AMPERSAND_BINARY_OPERATOR ? JUMP_IF_FALSE_OR_POP_OPCODE : JUMP_IF_TRUE_OR_POP_OPCODE, 0);
+        compileExpression(bytecode, function, binaryExpression->right);
+        patch(function, jump);
+        return;
+    }
+    compileExpression(bytecode, function, binaryExpression->right);
+    Opcode_enum opcode;
+    switch (binaryExpression->binaryOperator) {
+        case ASTERISK_BINARY_OPERATOR:                  opcode = MULTIPLY_OPCODE; break;
+        case SLASH_BINARY_OPERATOR:                     opcode = DIVIDE_OPCODE; break;
+        case PERCENT_BINARY_OPERATOR:                   opcode = MODULO_OPCODE; break;
+        case PLUS_BINARY_OPERATOR:                      opcode = ADD_OPCODE; break;
+        case MINUS_BINARY_OPERATOR:                     opcode = SUBTRACT_OPCODE; break;
+        case LEFT_SHIFT_BINARY_OPERATOR:                opcode = LEFT_SHIFT_OPCODE; break;
+        case RIGHT_SHIFT_BINARY_OPERATOR:               opcode = RIGHT_SHIFT_OPCODE; break;
+        case UNSIGNED_RIGHT_SHIFT_BINARY_OPERATOR:      opcode = UNSIGNED_RIGHT_SHIFT_OPCODE; break;
+        case LESS_THAN_BINARY_OPERATOR:                 opcode = LESS_THAN_OPCODE; break;
+        case GREATER_THAN_BINARY_OPERATOR:              opcode = GREATER_THAN_OPCODE; break;
+        case LESS_THAN_EQUALS_BINARY_OPERATOR:          opcode = LESS_THAN_EQUALS_OPCODE; break;
+        case GREATER_THAN_EQUALS_BINARY_OPERATOR:       opcode = GREATER_THAN_EQUALS_OPCODE; break;
+        case EQUALS_EQUALS_BINARY_OPERATOR:             opcode = EQUALS_OPCODE; break;
+        case EXCLAMATION_EQUALS_BINARY_OPERATOR:        opcode = NOT_EQUALS_OPCODE; break;
+        case EQUALS_EQUALS_EQUALS_BINARY_OPERATOR:      opcode = STRICT_EQUALS_OPCODE; break;
+        case EXCLAMATION_EQUALS_EQUALS_BINARY_OPERATOR: opcode = STRICT_NOT_EQUALS_OPCODE; break;
+        case AMPERSAND_BINARY_OPERATOR:                 opcode = BITWISE_AND_OPCODE; break;
+        case CARET_BINARY_OPERATOR:                     opcode = BITWISE_XOR_OPCODE; break;
+        case PIPE_BINARY_OPERATOR:                      opcode = BITWISE_OR_OPCODE; break;
+        default:                                        unsupported("this binary operator");
+    }
+    emit(function, opcode, 0);
+}
+
+static void compileUnaryExpression(Bytecode* bytecode, BytecodeFunction* function, UnaryExpression_node* unaryExpression) {
+    compileExpression(bytecode, function, unaryExpression->expression);
+    switch (unaryExpression->unaryOperator) {
+        case PLUS_UNARY_OPERATOR:
+            emit(function, TO_NUMBER_OPCODE, 0);
+            break;
+        case MINUS_UNARY_OPERATOR:
+            emit(function, NEGATE_OPCODE, 0);
+            break;
+        case TILDE_UNARY_OPERATOR:
+            emit(function, BITWISE_NOT_OPCODE, 0);
+            break;
+        case EXCLAMATION_UNARY_OPERATOR:
+            emit(function, NOT_OPCODE, 0);
+            break;
+    }
+}
+
+static void compileAssignmentExpression(Bytecode* bytecode, BytecodeFunction* function, AssignmentExpression_node* assignmentExpression) {
+    LeftHandSideExpression_node* leftHandSideExpression = assignmentExpression->leftHandSideExpression;
+    if ( leftHandSideExpression->type == IDENTIFIER_LEFT_HAND_SIDE_EXPRESSION_TYPE ) {
+        compileExpression(bytecode, function, assignmentExpression->expression);
+        emit(function, SET_VARIABLE_OPCODE, stringConstant(bytecode, leftHandSideExpression->leftHandSideExpressionUnion.identifier->name));
+        return;
+    }
+    MemberExpression_node* memberExpression = leftHandSideExpression->leftHandSideExpressionUnion.memberExpression;
+    compileExpression(bytecode, function, memberExpression->parent);
+    if ( memberExpression->type == DOT_MEMBER_EXPRESSION_TYPE ) {
+        compileExpression(bytecode, function, assignmentExpression->expression);
+        emit(function, SET_PROPERTY_OPCODE, stringConstant(bytecode, memberExpression->child.identifier->name));
+    } else {
+        compileMemberKey(bytecode, function, memberExpression);
+        compileExpression(bytecode, function, assignmentExpression->expression);
+        emit(function, SET_PROPERTY_DYNAMIC_OPCODE, 0);
+    }
+}
+
+static void compileObjectLiteral(Bytecode* bytecode, BytecodeFunction* function, ObjectLiteral_node* objectLiteral) {
+    emit(function, NEW_OBJECT_OPCODE, 0);
+    for ( int i = 0 ; i < objectLiteral->count ; i++ ) {
+        PropertyAssignment_node* propertyAssignment = objectLiteral->propertyAssignments[i];
+        if ( propertyAssignment->propertyName->type == STRING_LITERAL_TYPE ) {
+            compileExpression(bytecode, function, propertyAssignment->expression);
+            emit(function, INIT_PROPERTY_OPCODE, stringConstant(bytecode, propertyAssignment->propertyName->literalUnion.stringLiteral->string));
+        } else {
+            compileLiteral(bytecode, function, propertyAssignment->propertyName);
+            compileExpression(bytecode, function, propertyAssignment->expression);
+            emit(function, INIT_PROPERTY_DYNAMIC_OPCODE, 0);
+        }
+    }
+}
+
+static void compileArrayLiteral(Bytecode* bytecode, BytecodeFunction* function, ArrayLiteral_node* arrayLiteral) {
+    for ( int i = 0 ; i < arrayLiteral->count ; i++ ) {
+        compileExpression(bytecode, function, arrayLiteral->elements[i]);
+    }
+    emit(function, NEW_ARRAY_OPCODE, arrayLiteral->count);
+}
+
+static void compileExpression(Bytecode* bytecode, BytecodeFunction* function, Expression_node* expression) {
+    switch (expression->type) {
+        case THIS_EXPRESSION_TYPE:
+            unsupported("this");
+            break;
+        case IDENTIFIER_EXPRESSION_TYPE:
+            emit(function, GET_VARIABLE_OPCODE, stringConstant(bytecode, expression->expressionUnion.identifier->name));
+            break;
+        case ASSIGNMENT_EXPRESSION_TYPE:
+            compileAssignmentExpression(bytecode, function, expression->expressionUnion.assignmentExpression);
+            break;
+        case LITERAL_EXPRESSION_TYPE:
+            compileLiteral(bytecode, function, expression->expressionUnion.literal);
+            break;
+        case MEMBER_EXPRESSION_TYPE: {
+            MemberExpression_node* memberExpression = expression->expressionUnion.memberExpression;
+            compileExpression(bytecode, function, memberExpression->parent);
+            if ( memberExpression->type == DOT_MEMBER_EXPRESSION_TYPE ) {
+                emit(function, GET_PROPERTY_OPCODE, stringConstant(bytecode, memberExpression->child.identifier->name));
+            } else {
+                compileMemberKey(bytecode, function, memberExpression);
+                emit(function, GET_PROPERTY_DYNAMIC_OPCODE, 0);
+            }
+        } break;
+        case CALL_EXPRESSION_TYPE: {
+            CallExpression_node* callExpression = expression->expressionUnion.callExpression;
+            compileExpression(bytecode, function, callExpression->function);
+            for ( int i = 0 ; i < callExpression->argumentList->count ; i++ ) {
+                compileExpression(bytecode, function, callExpression->argumentList->arguments[i]);
+            }
+            emit(function, CALL_OPCODE, callExpression->argumentList->count);
+        } break;
+        case BINARY_EXPRESSION_TYPE:
+            compileBinaryExpression(bytecode, function, expression->expressionUnion.binaryExpression);
+            break;
+        case UNARY_EXPRESSION_TYPE:
+            compileUnaryExpression(bytecode, function, expression->expressionUnion.unaryExpression);
+            break;
+        case OBJECT_LITERAL_EXPRESSION_TYPE:
+            compileObjectLiteral(bytecode, function, expression->expressionUnion.objectLiteral);
+            break;
+        case ARRAY_LITERAL_EXPRESSION_TYPE:
+            compileArrayLiteral(bytecode, function, expression->expressionUnion.arrayLiteral);
+            break;
+    }
+}
+
+static void compileVariableDeclarationList(Bytecode* bytecode, BytecodeFunction* function, VariableDeclarationList_node* variableDeclarationList) {
+    for ( int i = 0 ; i < variableDeclarationList->count ; i++ ) {
+        VariableDeclaration_node* variableDeclaration = variableDeclarationList->variableDeclarations[i];
+        uint32_t name = stringConstant(bytecode, variableDeclaration->identifier->name);
+        emit(function, DEFINE_VARIABLE_OPCODE, name);
+        if ( variableDeclaration->initializer != NULL ) {
+            compileExpression(bytecode, function, variableDeclaration->initializer->expression);
+            emit(function, SET_VARIABLE_OPCODE, name);
+            emit(function, POP_OPCODE, 0);
+        }
+    }
+}
+
+static void compileStatementList(Bytecode* bytecode, BytecodeFunction* function, StatementList_node* statementList) {
+    for ( int i = 0 ; i < statementList->count ; i++ ) {
+        compileStatement(bytecode, function, statementList->statements[i]);
+    }
+}
+
+// The body of a loop runs in the scope of the loop, a block does not enter one of its own.
+static void compileLoopBody(Bytecode* bytecode, BytecodeFunction* function, Statement_node* statement) {
+    if ( statement->type == BLOCK_STATEMENT_TYPE ) {
+        compileStatementList(bytecode, function, statement->statementUnion.block->statementList);
+    } else {
+        compileStatement(bytecode, function, statement);
+    }
+}
+
+static void compileIterationStatement(Bytecode* bytecode, BytecodeFunction* function, IterationStatement_node* iterationStatement) {
+    if ( iterationStatement->initialVariableDeclarationList != NULL ) {
+        compileVariableDeclarationList(bytecode, function, iterationStatement->initialVariableDeclarationList);
+    }
+    if ( iterationStatement->initialExpression != NULL ) {
+        compileExpression(bytecode, function, iterationStatement->initialExpression);
+        emit(function, POP_OPCODE, 0);
+    }
+    // like generated code, a body that declares variables keeps one scope for the whole loop, see IterationStatement_toCode()
+    Statement_node* statement = iterationStatement->statement;
+    char scope = statement->type == BLOCK_STATEMENT_TYPE && Block_declaresIntoScope(statement->statementUnion.block);
+    if ( scope ) emit(function, ENTER_SCOPE_OPCODE, 0);
+    int start = function->length;
+    if ( iterationStatement->type == DO_WHILE_ITERATION_STATEMENT_TYPE ) {
+        compileLoopBody(bytecode, function, statement);
+        compileExpression(bytecode, function, iterationStatement->condition);
+        emit(function, JUMP_IF_TRUE_OPCODE, start);
+    } else {
+        int exit = -1;
+        if ( iterationStatement->condition != NULL ) {
+            compileExpression(bytecode, function, iterationStatement->condition);
+            exit = emit(function, JUMP_IF_FALSE_OPCODE, 0);
+        }
+        compileLoopBody(bytecode, function, statement);
+        if ( iterationStatement->update != NULL ) {
+            compileExpression(bytecode, function, iterationStatement->update);
+            emit(function, POP_OPCODE, 0);
+        }
+        emit(function, JUMP_OPCODE, start);
+        if ( exit >= 0 ) patch(function, exit);
+    }
+    if ( scope ) emit(function, LEAVE_SCOPE_OPCODE, 0);
+}
+
+static void compileStatement(Bytecode* bytecode, BytecodeFunction* function, Statement_node* statement) {
+    switch (statement->type) {
+        case BLOCK_STATEMENT_TYPE: {
+            Block_node* block = statement->statementUnion.block;
+            char scope = Block_declaresIntoScope(block);
+            if ( scope ) emit(function, ENTER_SCOPE_OPCODE, 0);
+            compileStatementList(bytecode, function, block->statementList);
+            if ( scope ) emit(function, LEAVE_SCOPE_OPCODE, 0);
+        } break;
+        case VARIABLE_STATEMENT_TYPE:
+            compileVariableDeclarationList(bytecode, function, statement->statementUnion.variableStatement->variableDeclarationList);
+            break;
+        case EMPTY_STATEMENT_TYPE:
+            break;
+        case EXPRESSION_STATEMENT_TYPE:
+            compileExpression(bytecode, function, statement->statementUnion.expressionStatement->expression);
+            emit(function, POP_OPCODE, 0);
+            break;
+        case RETURN_STATEMENT_TYPE: {
+            Expression_node* expression = statement->statementUnion.returnStatement->expression;
+            if ( expression == NULL ) {
+                emit(function, PUSH_UNDEFINED_OPCODE, 0);
+            } else {
+                compileExpression(bytecode, function, expression);
+            }
+            emit(function, RETURN_OPCODE, 0);
+        } break;
+        case ITERATION_STATEMENT_TYPE:
+            compileIterationStatement(bytecode, function, statement->statementUnion.iterationStatement);
+            break;
+    }
+}
+
+static uint32_t compileFunctionDeclaration(Bytecode* bytecode, FunctionDeclaration_node* functionDeclaration) {
+    int outerDepth = depth;
+    depth = 0;
+    uint32_t index = bytecode->functionCount;
+    BytecodeFunction* function = addFunction(bytecode);
+    FormalParameterList_node* formalParameterList = functionDeclaration->formalParameterList;
+    function->parameterCount = formalParameterList->count;
+    function->parameters = (uint32_t*) calloc(formalParameterList->count, sizeof(uint32_t));
+    for ( int i = 0 ; i < formalParameterList->count ; i++ ) {
+        function->parameters[i] = stringConstant(bytecode, formalParameterList->parameters[i]->name);
+    }
+    function->referencesArguments = functionDeclaration->referencesArguments;
+    compileStatementList(bytecode, function, functionDeclaration->block->statementList);
+    emit(function, PUSH_UNDEFINED_OPCODE, 0);
+    emit(function, RETURN_OPCODE, 0);
+    depth = outerDepth;
+    return index;
+}
+
+Bytecode* Bytecode_compile(Program_node* program) {
+    Bytecode* bytecode = (Bytecode*) calloc(1, sizeof(Bytecode));
+    BytecodeFunction* main = addFunction(bytecode);
+    depth = 0;
+    // top level functions are bound before any statement runs, like the static ones of generated code
+    for ( int i = 0 ; i < program->sourceElements->count ; i++ ) {
+        SourceElement_node* sourceElement = program->sourceElements->elements[i];
+        if ( sourceElement->type == FUNCTION_DECLARATION_SOURCE_ELEMENT_TYPE ) {
+            FunctionDeclaration_node* functionDeclaration = sourceElement->sourceElementUnion.functionDeclaration;
+            uint32_t name = stringConstant(bytecode, functionDeclaration->identifier->name);
+            uint32_t index = compileFunctionDeclaration(bytecode, functionDeclaration);
+            emit(main, DEFINE_VARIABLE_OPCODE, name);
+            emit(main, PUSH_FUNCTION_OPCODE, index);
+            emit(main, SET_VARIABLE_OPCODE, name);
+            emit(main, POP_OPCODE, 0);
+        }
+    }
+    for ( int i = 0 ; i < program->sourceElements->count ; i++ ) {
+        SourceElement_node* sourceElement = program->sourceElements->elements[i];
+        if ( sourceElement->type == STATEMENT_SOURCE_ELEMENT_TYPE ) {
+            compileStatement(bytecode, main, sourceElement->sourceElementUnion.statement);
+        }
+    }
+    emit(main, PUSH_UNDEFINED_OPCODE, 0);
+    emit(main, RETURN_OPCODE, 0);
+    return bytecode;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Cache files
+//
+// A cache file holds the bytecode of one program in the byte order of the machine that wrote it:
+//
+//     "CJSB" version:u32 sourceHash:u64
+//     constantCount:u32 { type:u8 ( number:f64 | length:u32 bytes ) }
+//     functionCount:u32 { parameterCount:u32 parameters:u32[] referencesArguments:u32 stackSize:u32 length:u32
+//                         code:u32[] }
+//
+// It is only used when the hash of the source it was compiled from matches, otherwise the program is compiled again.
+
+// FNV-1a
+uint64_t Bytecode_hash(char* source, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+    for ( size_t i = 0 ; i < length ; i++ ) {
+        hash ^= (unsigned char) source[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static char writeU32(FILE* file, uint32_t value) {
+    return fwrite(&value, sizeof(value), 1, file) == 1;
+}
+
+static char readU32(FILE* file, uint32_t* value) {
+    return fread(value, sizeof(*value), 1, file) == 1;
+}
+
+char Bytecode_save(Bytecode* bytecode, char* path, uint64_t sourceHash) {
+    FILE* file = fopen(path, "wb");
+    if ( file == NULL ) return 0;
+    char ok = fwrite(BYTECODE_MAGIC, 4, 1, file) == 1
+        && writeU32(file, BYTECODE_VERSION)
+        && fwrite(&sourceHash, sizeof(sourceHash), 1, file) == 1
+        && writeU32(file, bytecode->constantCount);
+    for ( int i = 0 ; ok && i < bytecode->constantCount ; i++ ) {
+        BytecodeConstant* constant = &bytecode->constants[i];
+        uint8_t type = constant->type;
+        ok = fwrite(&type, 1, 1, file) == 1;
+        if ( constant->type == NUMBER_CONSTANT_TYPE ) {
+            ok = ok && fwrite(&constant->number, sizeof(double), 1, file) == 1;
+        } else {
+            uint32_t length = strlen(constant->string);
+            ok = ok && writeU32(file, length) && fwrite(constant->string, 1, length, file) == length;
+        }
+    }
+    ok = ok && writeU32(file, bytecode->functionCount);
+    for ( int i = 0 ; ok && i < bytecode->functionCount ; i++ ) {
+        BytecodeFunction* function = bytecode->functions[i];
+        ok = writeU32(file, function->parameterCount)
+            && fwrite(function->parameters, sizeof(uint32_t), function->parameterCount, file) == function->parameterCount
+            && writeU32(file, function->referencesArguments)
+            && writeU32(file, function->stackSize)
+            && writeU32(file, function->length)
+            && fwrite(function->code, sizeof(uint32_t), function->length, file) == function->length;
+    }
+    ok = fclose(file) == 0 && ok;
+    if ( !ok ) remove(path);
+    return ok;
+}
+
+Bytecode* Bytecode_load(char* path, uint64_t sourceHash) {
+    FILE* file = fopen(path, "rb");
+    if ( file == NULL ) return NULL;
+    char magic[4];
+    uint32_t version, count;
+    uint64_t hash;
+    if ( fread(magic, 4, 1, file) != 1 || memcmp(magic, BYTECODE_MAGIC, 4) != 0
+            || !readU32(file, &version) || version != BYTECODE_VERSION
+            || fread(&hash, sizeof(hash), 1, file) != 1 || hash != sourceHash
+            || !readU32(file, &count) ) {
+        fclose(file);
+        return NULL;
+    }
+    Bytecode* bytecode = (Bytecode*) calloc(1, sizeof(Bytecode));
+    bytecode->constantCount = count;
+    bytecode->constants = (BytecodeConstant*) calloc(count, sizeof(BytecodeConstant));
+    char ok = 1;
+    for ( uint32_t i = 0 ; ok && i < count ; i++ ) {
+        BytecodeConstant* constant = &bytecode->constants[i];
+        uint8_t type;
+        uint32_t length;
+        ok = fread(&type, 1, 1, file) == 1;
+        constant->type = type;
+        if ( type == NUMBER_CONSTANT_TYPE ) {
+            ok = ok && fread(&constant->number, sizeof(double), 1, file) == 1;
+        } else {
+            ok = ok && readU32(file, &length) && ( constant->string = (char*) calloc(length + 1, sizeof(char)) ) != NULL
+                && fread(constant->string, 1, length, file) == length;
+        }
+    }
+    ok = ok && readU32(file, &count);
+    for ( uint32_t i = 0 ; ok && i < count ; i++ ) {
+        BytecodeFunction* function = addFunction(bytecode);
+        uint32_t parameterCount, referencesArguments, stackSize, length;
+        ok = readU32(file, &parameterCount)
+            && ( function->parameters = (uint32_t*) calloc(parameterCount, sizeof(uint32_t)) ) != NULL
+            && fread(function->parameters, sizeof(uint32_t), parameterCount, file) == parameterCount
+            && readU32(file, &referencesArguments)
+            && readU32(file, &stackSize)
+            && readU32(file, &length)
+            && ( function->code = (uint32_t*) calloc(length, sizeof(uint32_t)) ) != NULL
+            && fread(function->code, sizeof(uint32_t), length, file) == length;
+        function->parameterCount = parameterCount;
+        function->referencesArguments = referencesArguments;
+        function->stackSize = stackSize;
+        function->length = length;
+    }
+    fclose(file);
+    if ( !ok || bytecode->functionCount == 0 ) {
+        // a truncated or otherwise broken cache is as good as none, the program is compiled again
+        return NULL;
+    }
+    return bytecode;
+}
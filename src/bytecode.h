@@ -0,0 +1,117 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "node.h"
+
+/*
+ * Bytecode for the interpreter behind `--run`.
+ *
+ * Every function, and the program itself, compiles to an array of 32 bit instructions for a stack machine whose values
+ * are the runtime's `Variable`s. An instruction keeps its opcode in the low 8 bits and an unsigned operand in the upper
+ * 24 bits: a constant index, a function index, a jump target or an argument count, depending on the opcode.
+ */
+
+typedef enum   Opcode_enum                    Opcode_enum;
+typedef enum   ConstantType_enum              ConstantType_enum;
+
+typedef struct Bytecode                       Bytecode;
+typedef struct BytecodeConstant               BytecodeConstant;
+typedef struct BytecodeFunction               BytecodeFunction;
+
+Bytecode* Bytecode_compile(Program_node*);
+Bytecode* Bytecode_load(char*, uint64_t);
+char      Bytecode_save(Bytecode*, char*, uint64_t);
+uint64_t  Bytecode_hash(char*, size_t);
+
+#define BYTECODE_INSTRUCTION(opcode, operand) ( (uint32_t) (opcode) | ( (uint32_t) (operand) << 8 ) )
+#define BYTECODE_OPCODE(instruction)          ( (instruction) & 0xFF )
+#define BYTECODE_OPERAND(instruction)         ( (instruction) >> 8 )
+#define BYTECODE_MAX_OPERAND                  0xFFFFFF
+
+// The stack effect of each opcode is given as `[before -> after]`.
+enum Opcode_enum {
+    PUSH_UNDEFINED_OPCODE,           // [ -> undefined]
+    PUSH_NULL_OPCODE,                // [ -> null]
+    PUSH_TRUE_OPCODE,                // [ -> true]
+    PUSH_FALSE_OPCODE,               // [ -> false]
+    PUSH_CONSTANT_OPCODE,            // [ -> constant]
+    PUSH_FUNCTION_OPCODE,            // [ -> function]
+    POP_OPCODE,                      // [value -> ]
+    DEFINE_VARIABLE_OPCODE,          // [ -> ], operand is the name
+    GET_VARIABLE_OPCODE,             // [ -> value]
+    SET_VARIABLE_OPCODE,             // [value -> value]
+    GET_PROPERTY_OPCODE,             // [object -> value], operand is the name
+    GET_PROPERTY_DYNAMIC_OPCODE,     // [object key -> value]
+    SET_PROPERTY_OPCODE,             // [object value -> value]
+    SET_PROPERTY_DYNAMIC_OPCODE,     // [object key value -> value]
+    NEW_OBJECT_OPCODE,               // [ -> object]
+    INIT_PROPERTY_OPCODE,            // [object value -> object]
+    INIT_PROPERTY_DYNAMIC_OPCODE,    // [object key value -> object]
+    NEW_ARRAY_OPCODE,                // [elements... -> array], operand is the element count
+    CALL_OPCODE,                     // [function arguments... -> value], operand is the argument count
+    RETURN_OPCODE,                   // [value -> ]
+    ENTER_SCOPE_OPCODE,              // [ -> ]
+    LEAVE_SCOPE_OPCODE,              // [ -> ]
+    JUMP_OPCODE,                     // [ -> ], operand is the target
+    JUMP_IF_FALSE_OPCODE,            // [value -> ]
+    JUMP_IF_TRUE_OPCODE,             // [value -> ]
+    JUMP_IF_FALSE_OR_POP_OPCODE,     // [value -> value] if it jumps, [value -> ] if not
+    JUMP_IF_TRUE_OR_POP_OPCODE,      // [value -> value] if it jumps, [value -> ] if not
+    ADD_OPCODE,                      // [left right -> result], and so on for the other binary operators
+    SUBTRACT_OPCODE,
+    MULTIPLY_OPCODE,
+    DIVIDE_OPCODE,
+    MODULO_OPCODE,
+    LEFT_SHIFT_OPCODE,
+    RIGHT_SHIFT_OPCODE,
+    UNSIGNED_RIGHT_SHIFT_OPCODE,
+    LESS_THAN_OPCODE,
+    GREATER_THAN_OPCODE,
+    LESS_THAN_EQUALS_OPCODE,
+    GREATER_THAN_EQUALS_OPCODE,
+    EQUALS_OPCODE,
+    NOT_EQUALS_OPCODE,
+    STRICT_EQUALS_OPCODE,
+    STRICT_NOT_EQUALS_OPCODE,
+    BITWISE_AND_OPCODE,
+    BITWISE_XOR_OPCODE,
+    BITWISE_OR_OPCODE,
+    TO_NUMBER_OPCODE,                // [value -> result], and so on for the other unary operators
+    NEGATE_OPCODE,
+    BITWISE_NOT_OPCODE,
+    NOT_OPCODE,
+    OPCODE_COUNT
+};
+
+enum ConstantType_enum {
+    NUMBER_CONSTANT_TYPE,
+    STRING_CONSTANT_TYPE
+};
+
+struct BytecodeConstant {
+    ConstantType_enum type;
+    double number;
+    char* string;
+};
+
+struct BytecodeFunction {
+    int parameterCount;
+    uint32_t* parameters; // constant indices of the parameter names
+    int referencesArguments; // whether calls materialize `arguments`
+    int stackSize;
+    int length;
+    uint32_t* code;
+    struct PropertyCache** caches; // of the property accesses by instruction, created by the interpreter as it runs them
+};
+
+// functions[0] is the program itself.
+struct Bytecode {
+    int constantCount;
+    BytecodeConstant* constants;
+    int functionCount;
+    BytecodeFunction** functions;
+};
+
+#endif
@@ -0,0 +1,391 @@
+#include "gc.h"
+
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hashtable.h"
+#include "runtime.h"
+#include "slab.h"
+#include "snapshot.h"
+#include "stats.h"
+
+#define GC_DEFAULT_MIN_HEAP (4 << 20)
+#define GC_DEFAULT_GROWTH   2.0
+
+GcHeap gcHeap = { NULL, 0, 0, 0, GC_DEFAULT_MIN_HEAP };
+
+// Cells are carved out of slabs, only strings too long for the largest size class are allocated on their own.
+static SlabAllocator objectCells = SLAB_ALLOCATOR("object", sizeof(GcCell) + sizeof(Object));
+static SlabAllocator scopeCells = SLAB_ALLOCATOR("scope", sizeof(GcCell) + sizeof(Scope));
+static SlabAllocator stringCells[] = {
+    SLAB_ALLOCATOR("string", 32),
+    SLAB_ALLOCATOR("string", 64),
+    SLAB_ALLOCATOR("string", 128),
+    SLAB_ALLOCATOR("string", 256)
+};
+
+static GcCell* cells = NULL;
+static size_t heapBytes = 0;
+
+// The cells of all regions that were entered and not left yet, the innermost region's first. Regions are left in the
+// reverse order they were entered, so leaving one frees a prefix of this list.
+static GcCell* regionCells = NULL;
+static int regionDepth = 0;
+
+// Region cells and static cells are not swept, so the marks a collection leaves on them are cleared separately.
+static GcCell** markedUnsweptCells = NULL;
+static size_t markedUnsweptCellCount = 0;
+static size_t markedUnsweptCellCapacity = 0;
+
+static void** roots = NULL;
+static size_t rootCount = 0;
+
+static GcCell** markStack = NULL;
+static size_t markStackSize = 0;
+static size_t markStackCapacity = 0;
+
+static volatile sig_atomic_t snapshotRequested = 0;
+
+static bool configured = false;
+static size_t minHeap = GC_DEFAULT_MIN_HEAP;
+static double growth = GC_DEFAULT_GROWTH;
+static GcStats stats = { 0, 0, 0, 0, 0, 0, 0, 0 };
+
+static void printStats() {
+    fprintf(stderr, "gc: %llu cells of %llu bytes allocated, %llu collections, %.3f ms total pause, %.3f ms max pause, %llu bytes freed, %llu bytes freed with their call, %llu bytes in heap\n",
+        (unsigned long long) stats.allocations,
+        (unsigned long long) stats.allocatedBytes,
+        (unsigned long long) stats.collections,
+        stats.totalPauseNanoseconds / 1e6,
+        stats.maxPauseNanoseconds / 1e6,
+        (unsigned long long) stats.freedBytes,
+        (unsigned long long) stats.regionFreedBytes,
+        (unsigned long long) heapBytes);
+    slab_printStats(stderr);
+}
+
+static void writeSnapshotOnExit() {
+    snapshot_write(NULL);
+}
+
+// SIGUSR2 asks for a heap snapshot, which the next safepoint writes: it finds the threshold at 0 and collects.
+static void requestSnapshot(int signal) {
+    snapshotRequested = 1;
+    gcHeap.threshold = 0;
+}
+
+static void configure() {
+    configured = true;
+    stats_configure();
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = requestSnapshot;
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGUSR2, &action, NULL);
+    char* value = getenv("CJS_GC_MIN_HEAP");
+    if ( value != NULL && atol(value) > 0 ) {
+        minHeap = atol(value);
+    }
+    value = getenv("CJS_GC_GROWTH");
+    if ( value != NULL && atof(value) >= 1 ) {
+        growth = atof(value);
+    }
+    gcHeap.threshold = minHeap;
+    if ( getenv("CJS_GC_STATS") != NULL ) {
+        atexit(printStats);
+    }
+    if ( getenv("CJS_HEAP_SNAPSHOT_ON_EXIT") != NULL ) {
+        atexit(writeSnapshotOnExit);
+    }
+}
+
+static SlabAllocator* allocatorOf(GcCellType type, size_t size) {
+    switch (type) {
+        case OBJECT_GC_CELL_TYPE:
+            return size <= objectCells.cellSize ? &objectCells : NULL;
+        case SCOPE_GC_CELL_TYPE:
+            return size <= scopeCells.cellSize ? &scopeCells : NULL;
+        case STRING_GC_CELL_TYPE:
+            return slab_sizeClass(stringCells, sizeof(stringCells) / sizeof(SlabAllocator), size);
+    }
+    return NULL;
+}
+
+static StatsKind statsKindOf(GcCellType type) {
+    switch (type) {
+        case OBJECT_GC_CELL_TYPE:
+            return OBJECT_STATS_KIND;
+        case SCOPE_GC_CELL_TYPE:
+            return SCOPE_STATS_KIND;
+        default:
+            return STRING_STATS_KIND;
+    }
+}
+
+static GcCell* newCell(GcCellType type, size_t size) {
+    SlabAllocator* allocator = allocatorOf(type, sizeof(GcCell) + size);
+    GcCell* cell = (GcCell*) ( allocator != NULL ? slab_allocate(allocator) : calloc(1, sizeof(GcCell) + size) );
+    cell->size = sizeof(GcCell) + size;
+    cell->type = type;
+    stats.allocations += 1;
+    stats.allocatedBytes += cell->size;
+    stats_allocate(statsKindOf(type), cell->size);
+    return cell;
+}
+
+static void freeCell(GcCell* cell) {
+    stats_free(statsKindOf((GcCellType) cell->type), cell->size);
+    SlabAllocator* allocator = allocatorOf((GcCellType) cell->type, cell->size);
+    if ( allocator != NULL ) {
+        slab_free(allocator, cell);
+    } else {
+        free(cell);
+    }
+}
+
+void* gc_allocate(GcCellType type, size_t size) {
+    if ( !configured ) {
+        configure();
+    }
+    GcCell* cell = newCell(type, size);
+    cell->next = cells;
+    cells = cell;
+    gcHeap.allocatedBytes += cell->size;
+    heapBytes += cell->size;
+    gc_push(cell + 1);
+    return cell + 1;
+}
+
+// Allocates a cell that cannot outlive the innermost call: it is freed when the call's region is left. Outside of any
+// call, this is the same as gc_allocate().
+void* gc_allocateInRegion(GcCellType type, size_t size) {
+    if ( regionDepth == 0 ) {
+        return gc_allocate(type, size);
+    }
+    GcCell* cell = newCell(type, size);
+    cell->next = regionCells;
+    cell->inRegion = true;
+    regionCells = cell;
+    gc_push(cell + 1);
+    return cell + 1;
+}
+
+GcRegion gc_enterRegion() {
+    GcRegion region = { regionCells, gcHeap.shadowStackSize };
+    regionDepth += 1;
+    return region;
+}
+
+static void destroy(GcCell*);
+
+// Frees every cell allocated in the region, after taking them off the shadow stack. Everything else pushed since the
+// region was entered, like the value the call returns, stays there.
+void gc_leaveRegion(GcRegion region) {
+    size_t size = region.shadowStackSize;
+    for ( size_t i = region.shadowStackSize ; i < gcHeap.shadowStackSize ; i++ ) {
+        if ( !( (GcCell*) gcHeap.shadowStack[i] - 1 )->inRegion ) {
+            gcHeap.shadowStack[size++] = gcHeap.shadowStack[i];
+        }
+    }
+    gcHeap.shadowStackSize = size;
+    while ( regionCells != region.cells ) {
+        GcCell* cell = regionCells;
+        regionCells = cell->next;
+        stats.regionFreedBytes += cell->size;
+        destroy(cell);
+    }
+    regionDepth -= 1;
+}
+
+void gc_addRoot(void* cell) {
+    roots = (void**) realloc(roots, ( rootCount + 1 ) * sizeof(void*) );
+    roots[rootCount] = cell;
+    rootCount += 1;
+}
+
+void** gc_roots(size_t* count) {
+    *count = rootCount;
+    return roots;
+}
+
+void gc_growShadowStack() {
+    gcHeap.shadowStackCapacity = gcHeap.shadowStackCapacity == 0 ? 1024 : gcHeap.shadowStackCapacity * 2;
+    gcHeap.shadowStack = (void**) realloc(gcHeap.shadowStack, gcHeap.shadowStackCapacity * sizeof(void*) );
+}
+
+GcStats gc_stats() {
+    stats.heapBytes = heapBytes;
+    return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Mark
+
+static void mark(void* pointer) {
+    GcCell* cell = (GcCell*) pointer - 1;
+    if ( cell->marked ) return;
+    cell->marked = true;
+    if ( cell->inRegion || cell->isStatic ) {
+        if ( markedUnsweptCellCount == markedUnsweptCellCapacity ) {
+            markedUnsweptCellCapacity = markedUnsweptCellCapacity == 0 ? 256 : markedUnsweptCellCapacity * 2;
+            markedUnsweptCells = (GcCell**) realloc(markedUnsweptCells, markedUnsweptCellCapacity * sizeof(GcCell*) );
+        }
+        markedUnsweptCells[markedUnsweptCellCount++] = cell;
+    }
+    if ( cell->type == STRING_GC_CELL_TYPE && ( (String*) (cell + 1) )->left == NULL ) return;
+    if ( markStackSize == markStackCapacity ) {
+        markStackCapacity = markStackCapacity == 0 ? 256 : markStackCapacity * 2;
+        markStack = (GcCell**) realloc(markStack, markStackCapacity * sizeof(GcCell*) );
+    }
+    markStack[markStackSize++] = cell;
+}
+
+static void markVariable(Variable variable) {
+    switch (native_typeOf(variable)) {
+        case STRING_VARIABLE_TYPE:
+            mark(native_stringValue(variable));
+            break;
+        case OBJECT_VARIABLE_TYPE:
+            mark(native_objectValue(variable));
+            break;
+        default:
+            break;
+    }
+}
+
+// The values of a hashtable of properties or variables, internal properties hold no values.
+static void markHashtable(hashtable_t* hashtable) {
+    for ( entry_t* pair = ht_first(hashtable) ; pair != NULL ; pair = ht_next(hashtable, pair) ) {
+        if ( pair->value != NULL ) {
+            markVariable((Variable) (uintptr_t) pair->value);
+        }
+    }
+}
+
+static void markGlobals() {
+    if ( native_globalCells == NULL ) return;
+    for ( entry_t* pair = ht_first(native_globalCells) ; pair != NULL ; pair = ht_next(native_globalCells, pair) ) {
+        markVariable(((GlobalCell*) pair->value)->value);
+    }
+}
+
+static void trace() {
+    while ( markStackSize > 0 ) {
+        GcCell* cell = markStack[--markStackSize];
+        switch ((GcCellType) cell->type) {
+            case OBJECT_GC_CELL_TYPE: {
+                Object* object = (Object*) (cell + 1);
+                if ( object->shape != NULL ) {
+                    for ( int i = 0 ; i < object->shape->slotCount ; i++ ) {
+                        markVariable(object->slots[i]);
+                    }
+                } else {
+                    markHashtable(object->properties);
+                }
+                for ( uint32_t i = 0 ; i < object->elementCount ; i++ ) {
+                    markVariable(object->elements[i]);
+                }
+            } break;
+            case SCOPE_GC_CELL_TYPE: {
+                Scope* scope = (Scope*) (cell + 1);
+                if ( scope->parent != NULL ) {
+                    mark(scope->parent);
+                }
+                markHashtable(scope->hashtable);
+            } break;
+            case STRING_GC_CELL_TYPE: {
+                String* rope = (String*) (cell + 1);
+                mark(rope->left);
+                mark(rope->right);
+            } break;
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Sweep
+
+static void destroy(GcCell* cell) {
+    switch ((GcCellType) cell->type) {
+        case OBJECT_GC_CELL_TYPE: {
+            Object* object = (Object*) (cell + 1);
+            if ( object->properties != NULL ) {
+                ht_destroy(object->properties);
+            }
+            if ( object->slots != object->inlineSlots ) {
+                stats_free(OBJECT_SLOTS_STATS_KIND, object->slotCapacity * sizeof(Variable));
+                free(object->slots);
+            }
+            if ( object->elementCapacity > 0 ) {
+                stats_free(OBJECT_SLOTS_STATS_KIND, object->elementCapacity * sizeof(Variable));
+                free(object->elements);
+            }
+            ht_destroy(object->internalProperties);
+        } break;
+        case SCOPE_GC_CELL_TYPE:
+            ht_destroy(((Scope*) (cell + 1))->hashtable);
+            break;
+        case STRING_GC_CELL_TYPE: {
+            String* string = (String*) (cell + 1);
+            if ( string->chars != NULL && string->chars != string->data && !string->interned ) {
+                stats_free(STRING_CHARS_STATS_KIND, string->length + 1);
+                free(string->chars);
+            }
+        } break;
+    }
+    freeCell(cell);
+}
+
+static void sweep() {
+    GcCell** link = &cells;
+    while ( *link != NULL ) {
+        GcCell* cell = *link;
+        if ( cell->marked ) {
+            cell->marked = false;
+            link = &cell->next;
+        } else {
+            *link = cell->next;
+            heapBytes -= cell->size;
+            stats.freedBytes += cell->size;
+            destroy(cell);
+        }
+    }
+}
+
+static uint64_t now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+void gc_collect() {
+    if ( snapshotRequested ) {
+        snapshotRequested = 0;
+        snapshot_write(NULL);
+    }
+    uint64_t start = now();
+    for ( size_t i = 0 ; i < rootCount ; i++ ) {
+        mark(roots[i]);
+    }
+    for ( size_t i = 0 ; i < gcHeap.shadowStackSize ; i++ ) {
+        mark(gcHeap.shadowStack[i]);
+    }
+    markGlobals();
+    trace();
+    sweep();
+    for ( size_t i = 0 ; i < markedUnsweptCellCount ; i++ ) {
+        markedUnsweptCells[i]->marked = false;
+    }
+    markedUnsweptCellCount = 0;
+    gcHeap.allocatedBytes = 0;
+    gcHeap.threshold = heapBytes * ( growth - 1 ) > minHeap ? heapBytes * ( growth - 1 ) : minHeap;
+    uint64_t pause = now() - start;
+    stats.collections += 1;
+    stats.totalPauseNanoseconds += pause;
+    if ( pause > stats.maxPauseNanoseconds ) {
+        stats.maxPauseNanoseconds = pause;
+    }
+}
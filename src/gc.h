@@ -0,0 +1,118 @@
+#ifndef GC_H
+#define GC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A precise mark-sweep garbage collector for the strings, objects and scopes of the runtime.
+ *
+ * The roots are the permanent ones registered with gc_addRoot() (the global scope, module scopes, the constants of the
+ * interpreter), the cells of the global variables and the shadow stack. The runtime pushes every cell it allocates, and
+ * every value it hands out of a scope or an object, onto the shadow stack, so the temporaries of whatever is being
+ * evaluated stay alive. Generated code pops them again at safepoints:
+ *
+ *     size_t frame = gc_frame();    // on entry to a function, and before a loop once its hoisted values are computed
+ *     gc_safepoint(scope, frame);   // on entry to a function, and at the start of every iteration
+ *
+ * A safepoint drops everything pushed since `frame`, pushes the current scope, which keeps the scope chain alive, and
+ * collects once enough has been allocated since the last collection. Collections only ever happen at safepoints, and
+ * generated code only places them where it holds no value in a C local that is not on the shadow stack.
+ *
+ * Calls additionally get a region, see gc_enterRegion(): cells that cannot outlive the call, like its scopes, are
+ * allocated there and freed all at once when it returns, without waiting for a collection.
+ *
+ * Cells can also be part of the program's static data, with a header initialized by GC_STATIC_CELL(). They are traced
+ * like any other cell whenever they are reachable, but never freed.
+ *
+ * The environment tunes the collector:
+ *
+ *     CJS_GC_MIN_HEAP  bytes to allocate before the first collection, 4 MiB by default
+ *     CJS_GC_GROWTH    collect again when the heap grew to this factor of what survived the last collection, 2 by default
+ *     CJS_GC_STATS     if set, print the number of collections, pause times and heap sizes to stderr on exit
+ *
+ * SIGUSR2 makes the next safepoint write a heap snapshot, see snapshot.h.
+ */
+
+typedef enum GcCellType GcCellType;
+
+typedef struct GcCell GcCell;
+typedef struct GcHeap GcHeap;
+typedef struct GcRegion GcRegion;
+typedef struct GcStats GcStats;
+
+enum GcCellType {
+    STRING_GC_CELL_TYPE,
+    OBJECT_GC_CELL_TYPE,
+    SCOPE_GC_CELL_TYPE
+};
+
+// Precedes every cell, which starts right after it.
+struct GcCell {
+    GcCell* next;
+    uint32_t size;
+    uint8_t type;
+    bool marked;
+    bool inRegion;
+    bool isStatic;
+};
+
+#define GC_STATIC_CELL(type) { NULL, 0, (type), false, false, true }
+
+struct GcHeap {
+    void** shadowStack;
+    size_t shadowStackSize;
+    size_t shadowStackCapacity;
+    size_t allocatedBytes; // since the last collection
+    size_t threshold;      // collect when allocatedBytes reaches this
+};
+
+struct GcRegion {
+    void* cells;            // the innermost region's cells when this one was entered
+    size_t shadowStackSize; // and the size of the shadow stack
+};
+
+struct GcStats {
+    uint64_t allocations;      // cells, in regions or not
+    uint64_t allocatedBytes;
+    uint64_t collections;
+    uint64_t totalPauseNanoseconds;
+    uint64_t maxPauseNanoseconds;
+    uint64_t freedBytes;
+    uint64_t regionFreedBytes;
+    uint64_t heapBytes;
+};
+
+extern GcHeap gcHeap;
+
+void* gc_allocate(GcCellType, size_t);
+void* gc_allocateInRegion(GcCellType, size_t);
+GcRegion gc_enterRegion();
+void gc_leaveRegion(GcRegion);
+void gc_addRoot(void*);
+void** gc_roots(size_t*);
+void gc_collect();
+void gc_growShadowStack();
+GcStats gc_stats();
+
+static inline void gc_push(void* cell) {
+    if ( gcHeap.shadowStackSize == gcHeap.shadowStackCapacity ) {
+        gc_growShadowStack();
+    }
+    gcHeap.shadowStack[gcHeap.shadowStackSize++] = cell;
+}
+
+static inline size_t gc_frame() {
+    return gcHeap.shadowStackSize;
+}
+
+static inline void gc_safepoint(void* scope, size_t frame) {
+    gcHeap.shadowStackSize = frame;
+    gc_push(scope);
+    if ( gcHeap.allocatedBytes >= gcHeap.threshold ) {
+        gc_collect();
+    }
+}
+
+#endif
@@ -1,138 +1,282 @@
 /*
- * Stolen and adapted from https://gist.github.com/tonious/1377667
+ * Originally adapted from https://gist.github.com/tonious/1377667, now open addressing with Robin Hood probing.
  */
 
 #include "hashtable.h"
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <limits.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "atom.h"
+#include "slab.h"
+#include "stats.h"
 
-static int ht_hash(hashtable_t*, char*);
-static entry_t* ht_newpair(char*, void*);
+#define HT_MIN_CAPACITY 4
 
-/* Create a new hashtable. */
-hashtable_t* ht_create(int size) {
+static SlabAllocator tableCells = SLAB_ALLOCATOR("hashtable", sizeof(hashtable_t));
+
+static uint64_t seed[2];
+static bool seeded = false;
+
+static void ht_insert(hashtable_t*, entry_t);
+static void ht_resize(hashtable_t*, int);
 
+/* The smallest capacity that holds `count` pairs without growing. */
+static int ht_capacityFor(int count) {
+    int capacity = HT_MIN_CAPACITY;
+    while (capacity - capacity / 8 < count) {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/*
+ * Create a new hashtable for about `size` pairs, with room for all of them so that setting them does not grow the
+ * table. With a size of 1 the slots are only allocated when the first pair is set, as most scopes never get one.
+ */
+hashtable_t* ht_create(int size) {
     hashtable_t* hashtable = NULL;
-    int i;
 
     if (size < 1) return NULL;
 
-    /* Allocate the table itself. */
-    if ((hashtable = malloc(sizeof(hashtable_t))) == NULL) {
-        return NULL;
+    hashtable = slab_allocate(&tableCells);
+    stats_allocate(HASHTABLE_STATS_KIND, sizeof(hashtable_t));
+    hashtable->capacity = 0;
+    hashtable->count = 0;
+    hashtable->table = NULL;
+    if (size > 1) {
+        ht_resize(hashtable, ht_capacityFor(size));
     }
 
-    /* Allocate pointers to the head nodes. */
-    if ((hashtable->table = malloc(sizeof(entry_t*) * size)) == NULL) {
-        return NULL;
+    return hashtable;
+}
+
+static void ht_resize(hashtable_t* hashtable, int capacity) {
+    entry_t* table = hashtable->table;
+    int oldCapacity = hashtable->capacity;
+    int i;
+
+    if ((hashtable->table = calloc(capacity, sizeof(entry_t))) == NULL) {
+        fprintf(stderr, "Out of memory: hashtable of %i slots\n", capacity);
+        exit(1);
     }
-    for ( i = 0 ; i < size ; i++ ) {
-        hashtable->table[i] = NULL;
+    stats_reallocate(HASHTABLE_ENTRIES_STATS_KIND, oldCapacity * sizeof(entry_t), capacity * sizeof(entry_t));
+    hashtable->capacity = capacity;
+    hashtable->count = 0;
+    for ( i = 0 ; i < oldCapacity ; i++ ) {
+        if (table[i].key != NULL) {
+            ht_insert(hashtable, table[i]);
+        }
+    }
+    free(table);
+}
+
+/* Create a hashtable holding `count` pairs with distinct keys, sized for exactly that many. */
+hashtable_t* ht_create_bulk(int count, char** keys, void** values) {
+    hashtable_t* hashtable = NULL;
+    int i;
+
+    if ((hashtable = ht_create(count > 0 ? count : 1)) == NULL) {
+        return NULL;
     }
 
-    hashtable->size = size;
+    if (hashtable->capacity == 0 && count > 0) {
+        ht_resize(hashtable, ht_capacityFor(count));
+    }
+    for ( i = 0 ; i < count ; i++ ) {
+        entry_t pair = { keys[i], values[i], atom_hash(keys[i]) };
+        ht_insert(hashtable, pair);
+    }
 
     return hashtable;
 }
 
-/* Insert a value into a hash table at the key. */
-void ht_set(hashtable_t* hashtable, char* key, void* value) {
-    int bin = 0;
-    entry_t* newpair = NULL;
-    entry_t* next = NULL;
-    entry_t* last = NULL;
+/* The slot of the key, or -1 if it is not in the table. */
+static int ht_find(hashtable_t* hashtable, char* key) {
+    uint64_t hash;
+    int mask;
+    int i;
+    int distance;
+
+    if (hashtable->count == 0) return -1;
+
+    hash = atom_hash(key);
+    mask = hashtable->capacity - 1;
+    for ( i = hash & mask, distance = 0 ; ; i = ( i + 1 ) & mask, distance++ ) {
+        entry_t* pair = &hashtable->table[i];
+        /* A pair closer to its home slot than we are to ours means the key would have taken its place. */
+        if (pair->key == NULL || ( ( i - (int) ( pair->hash & mask ) ) & mask ) < distance) {
+            stats_hashtableLookup(distance);
+            return -1;
+        }
+        if (pair->key == key) {
+            stats_hashtableLookup(distance);
+            return i;
+        }
+    }
+}
 
-    bin = ht_hash(hashtable, key);
+/* Insert a pair whose key is not in the table yet, there has to be room for it. */
+static void ht_insert(hashtable_t* hashtable, entry_t pair) {
+    int mask = hashtable->capacity - 1;
+    int i = pair.hash & mask;
+    int distance = 0;
 
-    next = hashtable->table[bin];
+    for ( ; ; i = ( i + 1 ) & mask, distance++ ) {
+        entry_t* slot = &hashtable->table[i];
+        int slotDistance;
 
-    while (next != NULL && next->key != NULL && strcmp(key, next->key) > 0) {
-        last = next;
-        next = next->next;
+        if (slot->key == NULL) {
+            *slot = pair;
+            hashtable->count++;
+            return;
+        }
+        slotDistance = ( i - (int) ( slot->hash & mask ) ) & mask;
+        if (slotDistance < distance) {
+            entry_t displaced = *slot;
+            *slot = pair;
+            pair = displaced;
+            distance = slotDistance;
+        }
     }
+}
 
-    /* There's already a pair. */
-    if (next != NULL && next->key != NULL && strcmp(key, next->key) == 0) {
+/* Insert a value into a hash table at the key. */
+void ht_set(hashtable_t* hashtable, char* key, void* value) {
+    int i = ht_find(hashtable, key);
 
-        if ( next->value != NULL ) {
-            free(next->value);
-        }
-        next->value = value;
+    if (i >= 0) {
+        /* The table does not own its values, they may be shared with other tables. */
+        hashtable->table[i].value = value;
+        return;
+    }
 
-        /* Nope, could't find it.  Time to grow a pair. */
-    } else {
-        newpair = ht_newpair(key, value);
+    if (hashtable->count + 1 > hashtable->capacity - hashtable->capacity / 8) {
+        ht_resize(hashtable, hashtable->capacity == 0 ? HT_MIN_CAPACITY : hashtable->capacity * 2);
+    }
+    entry_t pair = { key, value, atom_hash(key) };
+    ht_insert(hashtable, pair);
+}
+
+/* Retrieve a key-value pair from a hash table. */
+void* ht_get(hashtable_t* hashtable, char* key) {
+    int i = ht_find(hashtable, key);
 
-        /* We're at the start of the linked list in this bin. */
-        if (next == hashtable->table[bin]) {
-            newpair->next = next;
-            hashtable->table[bin] = newpair;
+    return i < 0 ? NULL : hashtable->table[i].value;
+}
+
+/* Remove a key, shifting the pairs after it back towards their home slots. Returns whether the key was there. */
+bool ht_delete(hashtable_t* hashtable, char* key) {
+    int mask;
+    int i = ht_find(hashtable, key);
+    int next;
 
-            /* We're at the end of the linked list in this bin. */
-        } else if (next == NULL) {
-            last->next = newpair;
+    if (i < 0) return false;
 
-            /* We're in the middle of the list. */
-        } else {
-            newpair->next = next;
-            last->next = newpair;
+    mask = hashtable->capacity - 1;
+    for ( next = ( i + 1 ) & mask ; ; i = next, next = ( next + 1 ) & mask ) {
+        entry_t* pair = &hashtable->table[next];
+        if (pair->key == NULL || ( pair->hash & mask ) == (uint64_t) next) {
+            break;
         }
+        hashtable->table[i] = *pair;
     }
-}
+    memset(&hashtable->table[i], 0, sizeof(entry_t));
+    hashtable->count--;
 
-/* Retrieve a key-value pair from a hash table. */
-void* ht_get(hashtable_t* hashtable, char* key) {
-    int bin = 0;
-    entry_t* pair;
+    return true;
+}
 
-    bin = ht_hash(hashtable, key);
+/* Clear every value but keep the pairs, so setting the same keys again does not allocate. */
+void ht_reset(hashtable_t* hashtable) {
+    int i;
 
-    /* Step through the bin, looking for our value. */
-    pair = hashtable->table[bin];
-    while (pair != NULL && pair->key != NULL && strcmp(key, pair->key) > 0) {
-        pair = pair->next;
+    for ( i = 0 ; i < hashtable->capacity ; i++ ) {
+        hashtable->table[i].value = NULL;
     }
+}
 
-    /* Did we actually find anything? */
-    if (pair == NULL || pair->key == NULL || strcmp(key, pair->key) != 0) {
-        return NULL;
-    } else {
-        return pair->value;
+/* Free the table. Neither the keys nor the values are owned by the table. */
+void ht_destroy(hashtable_t* hashtable) {
+    if (hashtable->capacity > 0) {
+        stats_free(HASHTABLE_ENTRIES_STATS_KIND, hashtable->capacity * sizeof(entry_t));
     }
+    stats_free(HASHTABLE_STATS_KIND, sizeof(hashtable_t));
+    free(hashtable->table);
+    slab_free(&tableCells, hashtable);
+}
+
+/* The first pair in slot order, or NULL if the table is empty. */
+entry_t* ht_first(hashtable_t* hashtable) {
+    return hashtable->capacity == 0 ? NULL : ht_next(hashtable, hashtable->table - 1);
 }
 
-/* Hash a string for a particular hash table. */
-static int ht_hash(hashtable_t* hashtable, char* key) {
-    unsigned long int hashval;
-    int i = 0;
+/* The pair after `pair` in slot order, or NULL. The table must not change while iterating. */
+entry_t* ht_next(hashtable_t* hashtable, entry_t* pair) {
+    entry_t* end = hashtable->table + hashtable->capacity;
 
-    /* Convert our string to an integer */
-    while (hashval < ULONG_MAX && i < strlen(key)) {
-        hashval = hashval << 8;
-        hashval += key[i];
-        i++;
+    for ( pair++ ; pair < end ; pair++ ) {
+        if (pair->key != NULL) {
+            return pair;
+        }
     }
+    return NULL;
+}
 
-    return hashval % hashtable->size;
+/* SipHash-1-3 of a string, under a key chosen at random when the first string is hashed. Only atom_intern() hashes
+ * strings, every atom keeps its hash. */
+
+#define ROTATE(x, b) (uint64_t) ( ( (x) << (b) ) | ( (x) >> ( 64 - (b) ) ) )
+#define SIPROUND do { \
+    v0 += v1; v1 = ROTATE(v1, 13); v1 ^= v0; v0 = ROTATE(v0, 32); \
+    v2 += v3; v3 = ROTATE(v3, 16); v3 ^= v2; \
+    v0 += v3; v3 = ROTATE(v3, 21); v3 ^= v0; \
+    v2 += v1; v1 = ROTATE(v1, 17); v1 ^= v2; v2 = ROTATE(v2, 32); \
+} while (0)
+
+static void ht_seed() {
+    seeded = true;
+    if (getentropy(seed, sizeof(seed)) != 0) {
+        struct timespec time;
+        clock_gettime(CLOCK_REALTIME, &time);
+        seed[0] = (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+        seed[1] = (uint64_t) (uintptr_t) &time ^ ( (uint64_t) getpid() << 32 );
+    }
 }
 
-/* Create a key-value pair. */
-static entry_t* ht_newpair(char* key, void* value) {
-    entry_t* newpair;
+uint64_t ht_hash(char* key) {
+    uint64_t v0, v1, v2, v3;
+    uint64_t m;
+    size_t length = strlen(key);
+    size_t i;
 
-    if ((newpair = malloc(sizeof(entry_t))) == NULL) {
-        return NULL;
-    }
+    if (!seeded) ht_seed();
 
-    if ((newpair->key = strdup(key)) == NULL) {
-        return NULL;
+    v0 = seed[0] ^ 0x736f6d6570736575ULL;
+    v1 = seed[1] ^ 0x646f72616e646f6dULL;
+    v2 = seed[0] ^ 0x6c7967656e657261ULL;
+    v3 = seed[1] ^ 0x7465646279746573ULL;
+
+    for ( i = 0 ; i + 8 <= length ; i += 8 ) {
+        memcpy(&m, key + i, 8);
+        v3 ^= m;
+        SIPROUND;
+        v0 ^= m;
     }
+    m = (uint64_t) length << 56;
+    for ( ; i < length ; i++ ) {
+        m |= (uint64_t) (unsigned char) key[i] << ( 8 * ( i & 7 ) );
+    }
+    v3 ^= m;
+    SIPROUND;
+    v0 ^= m;
 
-    newpair->value = value;
-    newpair->next = NULL;
+    v2 ^= 0xff;
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
 
-    return newpair;
-}
\ No newline at end of file
+    return v0 ^ v1 ^ v2 ^ v3;
+}
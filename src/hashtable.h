@@ -1,25 +1,47 @@
 #ifndef HASHTABLE_H
 #define HASHTABLE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
 /*
- * Stolen and adapted from https://gist.github.com/tonious/1377667
+ * An open addressing hashtable from atoms to pointers, with Robin Hood probing: a pair that is further from its home
+ * slot than the one in its way takes that slot, so probe sequences stay short even at high load. Keys have to be atoms,
+ * see atom.h, which carry their hash and are compared by pointer, and which the table does not copy. They are hashed
+ * with SipHash-1-3 under a random key chosen once per process, so input cannot be crafted to make every key collide.
+ *
+ * The table starts empty and grows by doubling once it is 7/8 full. ht_get() returns NULL both for a key that is absent
+ * and for one whose value is NULL, as after ht_reset().
+ *
+ * Iterate over all pairs with:
+ *
+ *     for ( entry_t* pair = ht_first(hashtable) ; pair != NULL ; pair = ht_next(hashtable, pair) )
  */
 
 typedef struct hashtable_s hashtable_t;
 typedef struct entry_s entry_t;
 
 hashtable_t* ht_create(int);
+hashtable_t* ht_create_bulk(int, char**, void**);
 void ht_set(hashtable_t*, char*, void*);
 void* ht_get(hashtable_t*, char*);
+bool ht_delete(hashtable_t*, char*);
+void ht_reset(hashtable_t*);
+void ht_destroy(hashtable_t*);
+entry_t* ht_first(hashtable_t*);
+entry_t* ht_next(hashtable_t*, entry_t*);
+uint64_t ht_hash(char*);
 
 struct entry_s {
-    char* key;
+    char* key;      /* an atom, NULL for an empty slot */
     void* value;
-    entry_t* next;
+    uint64_t hash;
 };
 
 struct hashtable_s {
-    int size;
-    entry_t** table;
+    int capacity;   /* a power of two, or 0 until the first pair is set */
+    int count;
+    entry_t* table;
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,238 @@
+#include "interpreter.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "runtime.h"
+
+/*
+ * Runs bytecode directly on the runtime, so `--run` gives the same results as the compiled program without the round
+ * trip through gcc. Dispatch is threaded: every instruction jumps straight to the handler of the next one through a
+ * table of label addresses (a GNU extension, like the statement expressions in the generated code).
+ */
+
+static Bytecode* bytecode;
+static Variable* constants; // the constants of `bytecode` as values, created once
+static char** names;        // and the atoms of its string constants, for the ones that name a variable or property
+
+// Functions declared in the program are plain function objects, so they can be stored and passed around like any
+// other value. Calls from the interpreter run their bytecode; the runtime itself never calls back into user code.
+static Return BytecodeFunction_call(Scope* scope, int argc, Variable* argv) {
+    fprintf(stderr, "Unsupported Operation: interpreted function called from native code\n");
+    Return ret;
+    ret.error = "interpreted function called from native code";
+    ret.value = new_undefined();
+    return ret;
+}
+
+static Variable run(BytecodeFunction*, Scope*);
+
+// The inline cache of the property access at `instruction`, like the static one a dot access gets in generated code.
+static PropertyCache* cacheOf(BytecodeFunction* function, uint32_t* instruction) {
+    if ( function->caches == NULL ) {
+        function->caches = (PropertyCache**) calloc(function->length, sizeof(PropertyCache*));
+    }
+    PropertyCache** cache = &function->caches[instruction - function->code];
+    if ( *cache == NULL ) {
+        *cache = (PropertyCache*) calloc(1, sizeof(PropertyCache));
+    }
+    return *cache;
+}
+
+static Variable call(Variable callee, Scope* scope, int argc, Variable* argv) {
+    Object* object = native_toObject(callee);
+    if ( object->function != BytecodeFunction_call ) {
+        return native_apply(object, scope, argc, argv).value;
+    }
+    BytecodeFunction* function = (BytecodeFunction*) ht_get(object->internalProperties, ATOM("bytecode"));
+    // like native_apply(), the scopes of the call are freed when it returns
+    GcRegion region = gc_enterRegion();
+    Scope* functionScope = new_Scope(scope);
+    if ( function->referencesArguments ) {
+        functionScope->defineVariable(functionScope, ATOM("arguments"));
+        functionScope->setVariable(functionScope, ATOM("arguments"), new_array(argc, argv));
+    }
+    for ( int i = 0 ; i < function->parameterCount ; i++ ) {
+        char* name = names[function->parameters[i]];
+        functionScope->defineVariable(functionScope, name);
+        functionScope->setVariable(functionScope, name, i < argc ? argv[i] : new_undefined());
+    }
+    Variable value = run(function, functionScope);
+    gc_leaveRegion(region);
+    return value;
+}
+
+static Variable run(BytecodeFunction* function, Scope* scope) {
+    static void* dispatch[OPCODE_COUNT] = {
+        &&PUSH_UNDEFINED_OPCODE, &&PUSH_NULL_OPCODE, &&PUSH_TRUE_OPCODE, &&PUSH_FALSE_OPCODE, &&PUSH_CONSTANT_OPCODE,
+        &&PUSH_FUNCTION_OPCODE, &&POP_OPCODE, &&DEFINE_VARIABLE_OPCODE, &&GET_VARIABLE_OPCODE, &&SET_VARIABLE_OPCODE,
+        &&GET_PROPERTY_OPCODE, &&GET_PROPERTY_DYNAMIC_OPCODE, &&SET_PROPERTY_OPCODE, &&SET_PROPERTY_DYNAMIC_OPCODE,
+        &&NEW_OBJECT_OPCODE, &&INIT_PROPERTY_OPCODE, &&INIT_PROPERTY_DYNAMIC_OPCODE, &&NEW_ARRAY_OPCODE, &&CALL_OPCODE,
+        &&RETURN_OPCODE,
+        &&ENTER_SCOPE_OPCODE, &&LEAVE_SCOPE_OPCODE, &&JUMP_OPCODE, &&JUMP_IF_FALSE_OPCODE, &&JUMP_IF_TRUE_OPCODE,
+        &&JUMP_IF_FALSE_OR_POP_OPCODE, &&JUMP_IF_TRUE_OR_POP_OPCODE, &&ADD_OPCODE, &&SUBTRACT_OPCODE,
+        &&MULTIPLY_OPCODE, &&DIVIDE_OPCODE, &&MODULO_OPCODE, &&LEFT_SHIFT_OPCODE, &&RIGHT_SHIFT_OPCODE,
+        &&UNSIGNED_RIGHT_SHIFT_OPCODE, &&LESS_THAN_OPCODE, &&GREATER_THAN_OPCODE, &&LESS_THAN_EQUALS_OPCODE,
+        &&GREATER_THAN_EQUALS_OPCODE, &&EQUALS_OPCODE, &&NOT_EQUALS_OPCODE, &&STRICT_EQUALS_OPCODE,
+        &&STRICT_NOT_EQUALS_OPCODE, &&BITWISE_AND_OPCODE, &&BITWISE_XOR_OPCODE, &&BITWISE_OR_OPCODE,
+        &&TO_NUMBER_OPCODE, &&NEGATE_OPCODE, &&BITWISE_NOT_OPCODE, &&NOT_OPCODE
+    };
+    Variable stack[function->stackSize > 0 ? function->stackSize : 1];
+    Variable* top = stack; // the next free slot
+    uint32_t* code = function->code;
+    uint32_t* pc = code;
+    uint32_t operand;
+    Variable left;
+    Variable right;
+    // the operand stack is empty on entry and at the backward jumps of loops, so those are the safepoints
+    size_t frame = gc_frame();
+    gc_safepoint(scope, frame);
+
+    #define NEXT() do { operand = BYTECODE_OPERAND(*pc); goto *dispatch[BYTECODE_OPCODE(*pc++)]; } while (0)
+    #define PUSH(value) ( *top++ = (value) )
+    #define POP() ( *--top )
+    #define PEEK() ( top[-1] )
+    #define NAME() names[operand]
+    #define CACHE() cacheOf(function, pc - 1)
+    #define BINARY(expression) do { right = POP(); left = POP(); PUSH(expression); NEXT(); } while (0)
+    #define NUMBERS(operator) new_number(native_toNumber(left) operator native_toNumber(right))
+
+    NEXT();
+
+    PUSH_UNDEFINED_OPCODE:  PUSH(new_undefined()); NEXT();
+    PUSH_NULL_OPCODE:       PUSH(new_null()); NEXT();
+    PUSH_TRUE_OPCODE:       PUSH(new_boolean(true)); NEXT();
+    PUSH_FALSE_OPCODE:      PUSH(new_boolean(false)); NEXT();
+    PUSH_CONSTANT_OPCODE:   PUSH(constants[operand]); NEXT();
+    PUSH_FUNCTION_OPCODE: {
+        Variable value = new_function(BytecodeFunction_call);
+        ht_set(native_toObject(value)->internalProperties, ATOM("bytecode"), bytecode->functions[operand]);
+        PUSH(value);
+        NEXT();
+    }
+    POP_OPCODE:             --top; NEXT();
+    DEFINE_VARIABLE_OPCODE: scope->defineVariable(scope, NAME()); NEXT();
+    GET_VARIABLE_OPCODE:    PUSH(scope->getVariable(scope, NAME())); NEXT();
+    SET_VARIABLE_OPCODE:    scope->setVariable(scope, NAME(), PEEK()); NEXT();
+    GET_PROPERTY_OPCODE: {
+        Object* object = native_toObject(POP());
+        PUSH(native_getCachedProperty(object, NAME(), CACHE()));
+        NEXT();
+    }
+    GET_PROPERTY_DYNAMIC_OPCODE: {
+        right = POP();
+        Object* object = native_toObject(POP());
+        PUSH(native_getElement(object, right));
+        NEXT();
+    }
+    SET_PROPERTY_OPCODE: {
+        right = POP();
+        Object* object = native_toObject(POP());
+        PUSH(native_setCachedProperty(object, NAME(), right, CACHE()));
+        NEXT();
+    }
+    SET_PROPERTY_DYNAMIC_OPCODE: {
+        right = POP();
+        left = POP();
+        Object* object = native_toObject(POP());
+        PUSH(native_setElement(object, left, right));
+        NEXT();
+    }
+    NEW_OBJECT_OPCODE:      PUSH(new_object(0, NULL, NULL)); NEXT();
+    INIT_PROPERTY_OPCODE: {
+        right = POP();
+        Object* object = native_toObject(PEEK());
+        object->setProperty(object, NAME(), right);
+        NEXT();
+    }
+    INIT_PROPERTY_DYNAMIC_OPCODE: {
+        right = POP();
+        left = POP();
+        Object* object = native_toObject(PEEK());
+        object->setProperty(object, native_toPropertyKey(left), right);
+        NEXT();
+    }
+    NEW_ARRAY_OPCODE: {
+        Variable array = new_array(operand, top - operand);
+        top -= operand;
+        PUSH(array);
+        NEXT();
+    }
+    CALL_OPCODE: {
+        top -= operand;
+        Variable value = call(top[-1], scope, operand, top);
+        top[-1] = value;
+        NEXT();
+    }
+    RETURN_OPCODE:          return POP();
+    ENTER_SCOPE_OPCODE:     scope = new_Scope(scope); NEXT();
+    LEAVE_SCOPE_OPCODE:     scope = scope->parent; NEXT();
+    JUMP_OPCODE:
+        if ( code + operand < pc ) gc_safepoint(scope, frame);
+        pc = code + operand;
+        NEXT();
+    JUMP_IF_FALSE_OPCODE:   if ( !native_toBoolean(POP()) ) pc = code + operand; NEXT();
+    JUMP_IF_TRUE_OPCODE:
+        if ( native_toBoolean(POP()) ) {
+            if ( code + operand < pc ) gc_safepoint(scope, frame);
+            pc = code + operand;
+        }
+        NEXT();
+    JUMP_IF_FALSE_OR_POP_OPCODE:
+        if ( native_toBoolean(PEEK()) ) --top; else pc = code + operand;
+        NEXT();
+    JUMP_IF_TRUE_OR_POP_OPCODE:
+        if ( native_toBoolean(PEEK()) ) pc = code + operand; else --top;
+        NEXT();
+    ADD_OPCODE:                  BINARY(native_add(left, right));
+    SUBTRACT_OPCODE:             BINARY(NUMBERS(-));
+    MULTIPLY_OPCODE:             BINARY(NUMBERS(*));
+    DIVIDE_OPCODE:               BINARY(NUMBERS(/));
+    MODULO_OPCODE:               BINARY(new_number(fmod(native_toNumber(left), native_toNumber(right))));
+    LEFT_SHIFT_OPCODE:           BINARY(new_number((int32_t) ( native_toUint32(native_toNumber(left)) << ( native_toUint32(native_toNumber(right)) & 0x1F ) )));
+    RIGHT_SHIFT_OPCODE:          BINARY(new_number(native_toInt32(native_toNumber(left)) >> ( native_toUint32(native_toNumber(right)) & 0x1F )));
+    UNSIGNED_RIGHT_SHIFT_OPCODE: BINARY(new_number(native_toUint32(native_toNumber(left)) >> ( native_toUint32(native_toNumber(right)) & 0x1F )));
+    LESS_THAN_OPCODE:            BINARY(new_boolean(native_lessThan(left, right)));
+    GREATER_THAN_OPCODE:         BINARY(new_boolean(native_greaterThan(left, right)));
+    LESS_THAN_EQUALS_OPCODE:     BINARY(new_boolean(native_lessThanOrEqual(left, right)));
+    GREATER_THAN_EQUALS_OPCODE:  BINARY(new_boolean(native_greaterThanOrEqual(left, right)));
+    EQUALS_OPCODE:               BINARY(new_boolean(native_equals(left, right)));
+    NOT_EQUALS_OPCODE:           BINARY(new_boolean(!native_equals(left, right)));
+    STRICT_EQUALS_OPCODE:        BINARY(new_boolean(native_strictEquals(left, right)));
+    STRICT_NOT_EQUALS_OPCODE:    BINARY(new_boolean(!native_strictEquals(left, right)));
+    BITWISE_AND_OPCODE:          BINARY(new_number(native_toInt32(native_toNumber(left)) & native_toInt32(native_toNumber(right))));
+    BITWISE_XOR_OPCODE:          BINARY(new_number(native_toInt32(native_toNumber(left)) ^ native_toInt32(native_toNumber(right))));
+    BITWISE_OR_OPCODE:           BINARY(new_number(native_toInt32(native_toNumber(left)) | native_toInt32(native_toNumber(right))));
+    TO_NUMBER_OPCODE:            PEEK() = new_number(native_toNumber(PEEK())); NEXT();
+    NEGATE_OPCODE:               PEEK() = new_number(-native_toNumber(PEEK())); NEXT();
+    BITWISE_NOT_OPCODE:          PEEK() = new_number(~native_toInt32(native_toNumber(PEEK()))); NEXT();
+    NOT_OPCODE:                  PEEK() = new_boolean(!native_toBoolean(PEEK())); NEXT();
+
+    #undef NEXT
+    #undef PUSH
+    #undef POP
+    #undef PEEK
+    #undef NAME
+    #undef CACHE
+    #undef BINARY
+    #undef NUMBERS
+}
+
+int Interpreter_run(Bytecode* program) {
+    bytecode = program;
+    constants = (Variable*) calloc(program->constantCount, sizeof(Variable));
+    names = (char**) calloc(program->constantCount, sizeof(char*));
+    for ( int i = 0 ; i < program->constantCount ; i++ ) {
+        BytecodeConstant* constant = &program->constants[i];
+        if ( constant->type == STRING_CONSTANT_TYPE ) {
+            names[i] = atom_intern(constant->string);
+            constants[i] = new_literal(names[i]);
+        } else {
+            constants[i] = new_number(constant->number);
+        }
+    }
+    Scope* scope = new_Scope(NULL);
+    initialize_runtime(scope);
+    run(program->functions[0], scope);
+    return 0;
+}
@@ -0,0 +1,8 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include "bytecode.h"
+
+int Interpreter_run(Bytecode*);
+
+#endif
@@ -1,7 +1,12 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include "analyzer.h"
 #include "args.h"
+#include "bytecode.h"
+#include "interpreter.h"
 #include "node.h"
+#include "stats.h"
 
 extern FILE* yyin;
 extern int yyparse();
@@ -9,15 +14,121 @@ extern Program_node* root;
 
 char VERBOSE_LEXER;
 char VERBOSE_PARSER;
+char INSTRUMENT_FUNCTIONS;
+char PROFILE_SITES;
+char* SOURCE_FILE = "<stdin>";
+
+static char* readAll(FILE* file, size_t* length) {
+    size_t capacity = 4096;
+    char* buffer = (char*) malloc(capacity);
+    *length = 0;
+    size_t read;
+    while ( ( read = fread(buffer + *length, 1, capacity - *length, file) ) > 0 ) {
+        *length += read;
+        if ( *length == capacity ) {
+            capacity *= 2;
+            buffer = (char*) realloc(buffer, capacity);
+        }
+    }
+    return buffer;
+}
+
+// `--run` interprets the program in this process instead of printing C for gcc. With `--cache <file>` the compiled
+// bytecode is kept in that file and reused as long as the source does not change.
+static int run() {
+    FILE* input = stdin;
+    if ( !args_flag("--stdin") ) {
+        char* path = args_value("--run");
+        if ( path == NULL || path[0] == '-' ) {
+            fprintf(stderr, "%s\n", "no input file specified");
+            exit(1);
+        }
+        input = fopen(path, "r");
+        if ( input == NULL ) {
+            printf("file not found: %s\n", path);
+            return 1;
+        }
+    }
+    size_t length;
+    char* source = readAll(input, &length);
+    if ( input != stdin ) {
+        fclose(input);
+    }
+    uint64_t hash = Bytecode_hash(source, length);
+    char* cache = args_value("--cache");
+    Bytecode* bytecode = cache == NULL ? NULL : Bytecode_load(cache, hash);
+    if ( bytecode == NULL ) {
+        yyin = fmemopen(source, length, "r");
+        if (yyparse()) {
+            fprintf(stderr, "%s\n", "an error occurred while parsing");
+            exit(1);
+        }
+        bytecode = Bytecode_compile(root);
+        if ( cache != NULL && !Bytecode_save(bytecode, cache, hash) ) {
+            fprintf(stderr, "could not write bytecode cache: %s\n", cache);
+        }
+    }
+    return Interpreter_run(bytecode);
+}
+
+// `--stats <file>` prints the stats that a program run with CJS_STATS_FILE=<file> keeps there, while it runs or after.
+static int printStats() {
+    char* path = args_value("--stats");
+    Stats stats;
+    if ( path == NULL || !stats_read(path, &stats) ) {
+        fprintf(stderr, "no stats file: %s\n", path == NULL ? "" : path);
+        return 1;
+    }
+    stats_print(stdout, &stats);
+    return 0;
+}
 
 int main(int argc, char** argv) {
     args_init(argc, argv);
+    args_valueless(14, "-h", "--help", "--debug", "--debug-lexer", "--debug-parser", "--verbose", "--verbose-lexer",
+        "--verbose-parser", "--instrument", "--profile-sites", "--stdin", "-t", "--tree", "--parse-tree");
     if (args_flagv(2, "-h", "--help")) {
         puts("TODO"); //TODO
         exit(0);
     }
+    VERBOSE_LEXER  = args_flagv(4, "--debug", "--debug-lexer",  "--verbose", "--verbose-lexer");
+    VERBOSE_PARSER = args_flagv(4, "--debug", "--debug-parser", "--verbose", "--verbose-parser");
+    // `--instrument` generates code that profiles its functions when it runs, see profile.h.
+    INSTRUMENT_FUNCTIONS = args_flag("--instrument");
+    // `--profile-sites` generates code that profiles its variable and property lookups by site, see stats.h.
+    PROFILE_SITES = args_flag("--profile-sites");
+    if (args_flag("--run")) {
+        return run();
+    }
+    if (args_flag("--stats")) {
+        return printStats();
+    }
+    if (args_flag("--analyze-snapshot")) {
+        char* path = args_value("--analyze-snapshot");
+        if ( path == NULL ) {
+            fprintf(stderr, "%s\n", "no heap snapshot specified");
+            return 1;
+        }
+        return Analyzer_run(path, stdout);
+    }
+    // `--module <file.js>` generates a module for other programs to require(), see Program_toModuleCode(). Reading from
+    // stdin, the module is named with `--stdin --module <name>` instead.
+    char* module = args_value("--module");
+    if ( args_flag("--module") && ( module == NULL || module[0] == '-' ) ) {
+        fprintf(stderr, "%s\n", "no module specified");
+        exit(1);
+    }
+    if ( module != NULL ) {
+        SOURCE_FILE = module;
+    }
     if (args_flag("--stdin")) {
         yyin = stdin;
+    } else if ( module != NULL ) {
+        yyin = fopen(module, "r");
+        if ( yyin == NULL ) {
+            printf("file not found: %s\n", module);
+            return 1;
+        }
     } else {
         char** varargs = (char**) calloc(1, sizeof(char*));
         int num = args_varargs(varargs);
@@ -30,20 +141,21 @@ int main(int argc, char** argv) {
             fprintf(stderr, "%s\n", "only one input file is supported at this time");
             exit(1);
         }
+        SOURCE_FILE = varargs[0];
         yyin = fopen(varargs[0], "r");
         if ( yyin == NULL ) {
             printf("file not found: %s\n", varargs[0]);
             return 1;
         }
     }
-    VERBOSE_LEXER  = args_flagv(4, "--debug", "--debug-lexer",  "--verbose", "--verbose-lexer");
-    VERBOSE_PARSER = args_flagv(4, "--debug", "--debug-parser", "--verbose", "--verbose-parser");
     if (yyparse()) {
         fprintf(stderr, "%s\n", "an error occurred while parsing");
         exit(1);
     }
     if (args_flagv(3, "-t", "--tree", "--parse-tree")) {
         printf("%s\n", root->toString(root));
+    } else if (args_flag("--module")) {
+        printf("%s\n", Program_toModuleCode(root, module));
     } else {
         printf("%s\n", root->toCode(root));
     }
@@ -4,6 +4,279 @@
 #include "node.h"
 #include "string_utils.h"
 
+extern char INSTRUMENT_FUNCTIONS;
+extern char PROFILE_SITES;
+extern char* SOURCE_FILE;
+extern int yylineno;
+
+// Bindings are recorded while the program is parsed so that code generation can reason about how every name is used,
+// e.g. to prove that `console` is still the builtin installed by the runtime.
+typedef struct Binding Binding;
+
+struct Binding {
+    char* name;
+    int declarations;      // var statements, function declarations and formal parameters
+    int assignments;       // `name = ...`
+    int references;        // `name` read as an expression
+    int memberReferences;  // `name.member` or `name[member]`, a subset of references
+    int memberAssignments; // `name.member = ...` or `name[member] = ...`
+};
+
+static int bindingCount = 0;
+static Binding** bindings = NULL;
+
+static Binding* getBinding(char* name) {
+    for ( int i = 0 ; i < bindingCount ; i++ ) {
+        if ( strcmp(name, bindings[i]->name) == 0 ) {
+            return bindings[i];
+        }
+    }
+    Binding* binding = (Binding*) calloc(1, sizeof(Binding));
+    binding->name = new_string(name);
+    bindings = (Binding**) realloc(bindings, ( bindingCount + 1 ) * sizeof(Binding*) );
+    bindings[bindingCount] = binding;
+    bindingCount += 1;
+    return binding;
+}
+
+// `console` is the builtin global of the runtime unless the program declares, assigns or mutates it, or lets it
+// escape as a value where it could be mutated out of our sight.
+static char isBuiltinConsole() {
+    Binding* binding = getBinding("console");
+    return binding->declarations == 0
+        && binding->assignments == 0
+        && binding->memberAssignments == 0
+        && binding->references == binding->memberReferences;
+}
+
+// `require` is the module loader unless the program declares or assigns a variable of that name.
+static char isBuiltinRequire() {
+    Binding* binding = getBinding("require");
+    return binding->declarations == 0 && binding->assignments == 0;
+}
+
+// Modules that the program requires, so their entry points can be declared ahead of the code that calls them.
+static int requiredModuleCount = 0;
+static char** requiredModules = NULL;
+
+// The names that generated code uses as variables or property keys, as C string literals. They are interned at startup,
+// see atom.h, and the code refers to them as `cjs_atoms[i]`.
+static int atomCount = 0;
+static char** atoms = NULL;
+
+static char* Atom_toCode(char* literal) {
+    int i = 0;
+    while ( i < atomCount && strcmp(literal, atoms[i]) != 0 ) {
+        i++;
+    }
+    if ( i == atomCount ) {
+        atoms = (char**) realloc(atoms, ( atomCount + 1 ) * sizeof(char*) );
+        atoms[atomCount] = new_string(literal);
+        atomCount += 1;
+    }
+    char* code = (char*) calloc(30, sizeof(char));
+    sprintf(code, "cjs_atoms[%i]", i);
+    return code;
+}
+
+// The string literals of the program, as C string literals. They are created at startup, see new_literal(), and the
+// code refers to them as `cjs_strings[i]`.
+static int stringCount = 0;
+static char** strings = NULL;
+
+static char* String_toCode(char* literal) {
+    int i = 0;
+    while ( i < stringCount && strcmp(literal, strings[i]) != 0 ) {
+        i++;
+    }
+    if ( i == stringCount ) {
+        strings = (char**) realloc(strings, ( stringCount + 1 ) * sizeof(char*) );
+        strings[stringCount] = new_string(literal);
+        stringCount += 1;
+    }
+    char* code = (char*) calloc(30, sizeof(char));
+    sprintf(code, "cjs_strings[%i]", i);
+    return code;
+}
+
+// The atom of an identifier, or of any other name that needs no escaping.
+static char* Atom_nameCode(char* name) {
+    char* literal = new_string("\"");
+    literal = concat(literal, name);
+    literal = concat(literal, "\"");
+    char* code = Atom_toCode(literal);
+    free(literal);
+    return code;
+}
+
+// Appends the atom of a name to the code.
+static char* concat_atom(char* code, char* name) {
+    char* tmp = Atom_nameCode(name);
+    code = concat(code, tmp);
+    free(tmp);
+    return code;
+}
+
+// Set while the top level code of a program is generated outside of any block that has a scope of its own, where
+// declarations go into the global scope.
+static char globalScopeCode = 0;
+
+// Set while the body of a function that refers to `arguments` is generated, see createFunctionDeclaration().
+static char argumentsCode = 0;
+
+// With `--profile-sites`, the static StatsSite of a read or assignment, named `x`, `.x` or `[]`, see runtime.h.
+static char* Site_code(int line, char write, char* prefix, char* name) {
+    char* code = new_string("static StatsSite site = STATS_SITE(\"");
+    for ( char* c = SOURCE_FILE ; *c != 0 ; c++ ) {
+        char escaped[3] = { '\\', *c, 0 };
+        code = concat(code, *c == '"' || *c == '\\' ? escaped : escaped + 1);
+    }
+    char lineCode[16];
+    sprintf(lineCode, "%d", line);
+    code = concat(code, "\", ");
+    code = concat(code, lineCode);
+    code = concat(code, write ? ", true, \"" : ", false, \"");
+    code = concat(code, prefix);
+    code = concat(code, name);
+    code = concat(code, "\"); ");
+    return code;
+}
+
+// Appends the access to the code, marked as the site's if sites are profiled, once its operands are evaluated.
+static char* concat_siteAccess(char* code, char* access) {
+    if ( !PROFILE_SITES ) {
+        return concat(code, access);
+    }
+    code = concat(code, "native_enterSite(&site); native_leaveSite(");
+    code = concat(code, access);
+    return concat(code, ")");
+}
+
+// Declares a variable in the current scope. Outside of the global scope, the site announces the name the first time it
+// runs, so that cached lookups of a global of the same name go through the scope chain, see native_shadowGlobal().
+static char* Declaration_toCode(char* name) {
+    char* code = new_string(globalScopeCode ? "scope->defineVariable(scope, " : "{ static bool shadowing; native_defineLocal(scope, ");
+    code = concat_atom(code, name);
+    code = concat(code, globalScopeCode ? ");" : ", &shadowing); }");
+    return code;
+}
+
+// Set while a module is generated: its functions then run in the scope of the module, not in the scope they are called
+// from, so that they still see the variables of the module when another program calls them.
+static char* moduleSymbol = NULL;
+static char* moduleName = NULL;
+
+static char* Module_path(char*, char*);
+
+// Whether a statement declares variables into the scope it runs in. Blocks get a scope of their own only when some
+// statement directly inside them does, otherwise they run in the enclosing scope.
+static char Statement_declaresIntoScope(Statement_node* statement) {
+    switch (statement->type) {
+        case VARIABLE_STATEMENT_TYPE:
+            return 1;
+        case ITERATION_STATEMENT_TYPE:
+            return statement->statementUnion.iterationStatement->initialVariableDeclarationList != NULL
+                || Statement_declaresIntoScope(statement->statementUnion.iterationStatement->statement);
+        default:
+            return 0;
+    }
+}
+
+char Block_declaresIntoScope(Block_node* block) {
+    for ( int i = 0 ; i < block->statementList->count ; i++ ) {
+        if ( Statement_declaresIntoScope(block->statementList->statements[i]) ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static char VariableDeclarationList_declares(VariableDeclarationList_node* variableDeclarationList, char* name) {
+    for ( int i = 0 ; i < variableDeclarationList->count ; i++ ) {
+        if ( strcmp(name, variableDeclarationList->variableDeclarations[i]->identifier->name) == 0 ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Whether a statement, or any statement nested in it, declares the given name.
+static char Statement_declares(Statement_node* statement, char* name) {
+    switch (statement->type) {
+        case BLOCK_STATEMENT_TYPE: {
+            StatementList_node* statementList = statement->statementUnion.block->statementList;
+            for ( int i = 0 ; i < statementList->count ; i++ ) {
+                if ( Statement_declares(statementList->statements[i], name) ) {
+                    return 1;
+                }
+            }
+            return 0;
+        }
+        case VARIABLE_STATEMENT_TYPE:
+            return VariableDeclarationList_declares(statement->statementUnion.variableStatement->variableDeclarationList, name);
+        case ITERATION_STATEMENT_TYPE: {
+            IterationStatement_node* iterationStatement = statement->statementUnion.iterationStatement;
+            return ( iterationStatement->initialVariableDeclarationList != NULL && VariableDeclarationList_declares(iterationStatement->initialVariableDeclarationList, name) )
+                || Statement_declares(iterationStatement->statement, name);
+        }
+        default:
+            return 0;
+    }
+}
+
+// Names that are never assigned and not declared inside a loop resolve to the same variable on every iteration, so a
+// loop looks them up once before the first iteration and keeps them in C locals. While the condition, body and update
+// of a loop are generated, `currentLoop` records what was hoisted that way.
+typedef struct Loop Loop;
+
+struct Loop {
+    IterationStatement_node* iterationStatement;
+    int count;
+    char** keys;
+    Expression_node** expressions;
+    char** locals;
+    Loop* outer;
+};
+
+static Loop* currentLoop = NULL;
+static int hoistedCount = 0;
+
+// Returns the C local holding the value of the expression, or NULL if it has to be evaluated where it is.
+static char* Loop_hoist(Expression_node* expression) {
+    if ( currentLoop == NULL ) {
+        return NULL;
+    }
+    char* key;
+    switch (expression->type) {
+        case IDENTIFIER_EXPRESSION_TYPE: {
+            char* name = expression->expressionUnion.identifier->name;
+            if ( getBinding(name)->assignments > 0 || Statement_declares(currentLoop->iterationStatement->statement, name) ) {
+                return NULL;
+            }
+            key = new_string(name);
+        } break;
+        default:
+            return NULL;
+    }
+    for ( int i = 0 ; i < currentLoop->count ; i++ ) {
+        if ( strcmp(key, currentLoop->keys[i]) == 0 ) {
+            free(key);
+            return new_string(currentLoop->locals[i]);
+        }
+    }
+    char* local = (char*) calloc(30, sizeof(char));
+    sprintf(local, "hoisted_%i", hoistedCount);
+    hoistedCount += 1;
+    currentLoop->keys = (char**) realloc(currentLoop->keys, ( currentLoop->count + 1 ) * sizeof(char*) );
+    currentLoop->expressions = (Expression_node**) realloc(currentLoop->expressions, ( currentLoop->count + 1 ) * sizeof(Expression_node*) );
+    currentLoop->locals = (char**) realloc(currentLoop->locals, ( currentLoop->count + 1 ) * sizeof(char*) );
+    currentLoop->keys[currentLoop->count] = key;
+    currentLoop->expressions[currentLoop->count] = expression;
+    currentLoop->locals[currentLoop->count] = local;
+    currentLoop->count += 1;
+    return new_string(local);
+}
+
 char* Identifier_toString(Identifier_node* identifier) {
     char* string = new_string("Identifier ");
     string = concat(string, identifier->name);
@@ -13,6 +286,7 @@ char* Identifier_toString(Identifier_node* identifier) {
 Identifier_node* createIdentifier(char* name) {
     Identifier_node* identifier = (Identifier_node*) calloc(1, sizeof(Identifier_node));
     identifier->name = new_string(name);
+    identifier->line = yylineno;
     identifier->toString = Identifier_toString;
     return identifier;
 }
@@ -29,6 +303,8 @@ char* Statement_toString(Statement_node* statement) {
             return statement->statementUnion.expressionStatement->toString(statement->statementUnion.expressionStatement);
         case RETURN_STATEMENT_TYPE:
             return statement->statementUnion.returnStatement->toString(statement->statementUnion.returnStatement);
+        case ITERATION_STATEMENT_TYPE:
+            return statement->statementUnion.iterationStatement->toString(statement->statementUnion.iterationStatement);
     }
 }
 
@@ -36,7 +312,7 @@ char* Statement_toCode(Statement_node* statement) {
     switch (statement->type) {
         case BLOCK_STATEMENT_TYPE: {
             char* code = new_string("{\n");
-            char* tmp1 = new_string("Scope* parentScope = scope;\n");
+            char* tmp1 = new_string(Block_declaresIntoScope(statement->statementUnion.block) ? "Scope* parentScope = scope;\n" : "");
             char* tmp2 = statement->statementUnion.block->toCode(statement->statementUnion.block, NULL);
             tmp1 = concat(tmp1, tmp2);
             free(tmp2);
@@ -53,6 +329,8 @@ char* Statement_toCode(Statement_node* statement) {
             return statement->statementUnion.expressionStatement->toCode(statement->statementUnion.expressionStatement);
         case RETURN_STATEMENT_TYPE:
             return statement->statementUnion.returnStatement->toCode(statement->statementUnion.returnStatement);
+        case ITERATION_STATEMENT_TYPE:
+            return statement->statementUnion.iterationStatement->toCode(statement->statementUnion.iterationStatement);
     }
 }
 
@@ -124,29 +402,46 @@ char* Block_toString(Block_node* block) {
 char* Block_toCode(Block_node* block, FormalParameterList_node* formalParameterList) {
     char* code = new_string("{\n");
     char* tmp1 = new_string("");
+    char outerGlobalScopeCode = globalScopeCode;
+    if ( formalParameterList != NULL || Block_declaresIntoScope(block) ) {
+        globalScopeCode = 0;
+    }
     if ( formalParameterList == NULL ) {
         if ( block->statementList->count == 0 ) {
             tmp1 = concat_comment(tmp1, "empty block");
-        } else {
+        } else if ( Block_declaresIntoScope(block) ) {
             tmp1 = concat(tmp1, "Scope* scope = new_Scope(parentScope);\n");
         }
     } else {
-        tmp1 = concat(tmp1, "Scope* scope = new_Scope(callingScope);\n");
+        tmp1 = concat(tmp1, moduleSymbol == NULL ? "Scope* scope = new_Scope(callingScope);\n" : "Scope* scope = new_Scope(moduleScope);\n");
+        if ( argumentsCode ) {
+            char* tmp2 = Declaration_toCode("arguments");
+            tmp1 = concat(tmp1, tmp2);
+            free(tmp2);
+            tmp1 = concat(tmp1, "\nscope->setVariable(scope, ");
+            tmp1 = concat_atom(tmp1, "arguments");
+            tmp1 = concat(tmp1, ", new_array(argc, argv));\n");
+        }
         for ( int i = 0 ; i < formalParameterList->count ; i++ ) {
             Identifier_node* parameter = formalParameterList->parameters[i];
-            tmp1 = concat(tmp1, "scope->setVariable(scope, \"");
-            tmp1 = concat(tmp1, parameter->name);
-            tmp1 = concat(tmp1, "\", arguments->getProperty(arguments, \"");
-            char* tmp2 = (char*) calloc(20, sizeof(char));
+            char* tmp2 = Declaration_toCode(parameter->name);
+            tmp1 = concat(tmp1, tmp2);
+            free(tmp2);
+            tmp1 = concat(tmp1, "\nscope->setVariable(scope, ");
+            tmp1 = concat_atom(tmp1, parameter->name);
+            tmp1 = concat(tmp1, ", native_argument(argc, argv, ");
+            tmp2 = (char*) calloc(20, sizeof(char));
             sprintf(tmp2, "%i", i);
             tmp1 = concat(tmp1, tmp2);
             free(tmp2);
-            tmp1 = concat(tmp1, "\"));\n");
+            tmp1 = concat(tmp1, "));\n");
         }
+        tmp1 = concat(tmp1, "size_t frame = gc_frame();\ngc_safepoint(scope, frame);\n");
     }
     char* tmp2 = block->statementList->toCode(block->statementList);
     tmp1 = concat(tmp1, tmp2);
     free(tmp2);
+    globalScopeCode = outerGlobalScopeCode;
     if ( formalParameterList != NULL) {
         tmp1 = concat(tmp1, "\n");
         // TODO only do this if there is code path without a return statement
@@ -220,11 +515,48 @@ char* FunctionDeclaration_toString(FunctionDeclaration_node* functionDeclaration
     return string;
 }
 
+// With `--instrument`, the function runs as cjs_instrumented_<name>, wrapped in one that tells the profiler when it is
+// called and when it returns, see profile.h. Functions of a module are named after its path, as in `lib/math.add`.
+static char* FunctionDeclaration_instrumentedCode(FunctionDeclaration_node* functionDeclaration, char* body) {
+    char* name = functionDeclaration->identifier->name;
+    char* code = new_string("static ProfileFunction cjs_profile_");
+    code = concat(code, name);
+    code = concat(code, " = PROFILE_FUNCTION(\"");
+    if ( moduleSymbol != NULL ) {
+        code = concat(code, moduleName);
+        code = concat(code, ".");
+    }
+    code = concat(code, name);
+    code = concat(code, "\");\n\nstatic Return cjs_instrumented_");
+    code = concat(code, name);
+    code = concat(code, "(Scope* callingScope, int argc, Variable* argv) ");
+    code = concat(code, body);
+    code = concat(code, "\n\nstatic Return ");
+    code = concat(code, name);
+    code = concat(code, "(Scope* callingScope, int argc, Variable* argv) {\n");
+    char* tmp = new_string("ProfileFrame frame;\nprofile_enter(&frame, &cjs_profile_");
+    tmp = concat(tmp, name);
+    tmp = concat(tmp, ");\nReturn ret = cjs_instrumented_");
+    tmp = concat(tmp, name);
+    tmp = concat(tmp, "(callingScope, argc, argv);\nprofile_leave(&frame);\nreturn ret;");
+    code = concat_indent(code, tmp);
+    free(tmp);
+    code = concat(code, "\n}\n\n");
+    return code;
+}
+
 char* FunctionDeclaration_toCode(FunctionDeclaration_node* functionDeclaration) {
+    argumentsCode = functionDeclaration->referencesArguments;
+    char* tmp = functionDeclaration->block->toCode(functionDeclaration->block, functionDeclaration->formalParameterList);
+    argumentsCode = 0;
+    if ( INSTRUMENT_FUNCTIONS ) {
+        char* code = FunctionDeclaration_instrumentedCode(functionDeclaration, tmp);
+        free(tmp);
+        return code;
+    }
     char* code = new_string("static Return ");
     code = concat(code, functionDeclaration->identifier->name);
-    code = concat(code, "(Scope* callingScope, Object* arguments) ");
-    char* tmp = functionDeclaration->block->toCode(functionDeclaration->block, functionDeclaration->formalParameterList);
+    code = concat(code, "(Scope* callingScope, int argc, Variable* argv) ");
     code = concat(code, tmp);
     free(tmp);
     code = concat(code, "\n\n");
@@ -236,6 +568,24 @@ FunctionDeclaration_node* createFunctionDeclaration(Identifier_node* identifier,
     functionDeclaration->identifier = identifier;
     functionDeclaration->formalParameterList = formalParameterList;
     functionDeclaration->block = block;
+    getBinding(identifier->name)->declarations += 1;
+    for ( int i = 0 ; i < formalParameterList->count ; i++ ) {
+        getBinding(formalParameterList->parameters[i]->name)->declarations += 1;
+    }
+    // Functions do not nest, so the uses of `arguments` since the previous declaration are in this body or in top level
+    // code in between, which at worst materializes it for nothing. A parameter of that name hides it.
+    static int argumentsUses = 0;
+    Binding* arguments = getBinding("arguments");
+    functionDeclaration->referencesArguments = arguments->references + arguments->assignments > argumentsUses;
+    argumentsUses = arguments->references + arguments->assignments;
+    for ( int i = 0 ; i < formalParameterList->count ; i++ ) {
+        if ( strcmp(formalParameterList->parameters[i]->name, "arguments") == 0 ) {
+            functionDeclaration->referencesArguments = 0;
+        }
+    }
+    if ( functionDeclaration->referencesArguments ) {
+        arguments->declarations += 1;
+    }
     functionDeclaration->toString = FunctionDeclaration_toString;
     functionDeclaration->toCode = FunctionDeclaration_toCode;
     return functionDeclaration;
@@ -295,9 +645,8 @@ char* Program_toString(Program_node* program) {
     return string;
 }
 
-char* Program_toCode(Program_node* program) {
+static char* Program_functionDeclarationsCode(Program_node* program) {
     char* code = new_string("");
-    code = concat(code, "#include <stdlib.h>\n#include \"runtime.h\"\n\n");
     code = concat(code, "////////////////////////////////////////////////////////////////////////////////\n");
     code = concat(code, "// function declarations\n\n");
     for ( int i = 0 ; i < program->sourceElements->count ; i++ ) {
@@ -308,6 +657,145 @@ char* Program_toCode(Program_node* program) {
             free(tmp);
         }
     }
+    return code;
+}
+
+// Every top level function is an object in static data, see runtime.h. A program also keeps its top level functions in
+// static global cells, `cjs_globals`, in the order of their declarations.
+static char* Program_staticFunctionsCode(Program_node* program, char globals) {
+    char* code = new_string("");
+    char* cells = new_string("");
+    for ( int i = 0 ; i < program->sourceElements->count ; i++ ) {
+        if ( program->sourceElements->elements[i]->type == FUNCTION_DECLARATION_SOURCE_ELEMENT_TYPE ) {
+            char* name = program->sourceElements->elements[i]->sourceElementUnion.functionDeclaration->identifier->name;
+            code = concat(code, "static StaticObject cjs_function_");
+            code = concat(code, name);
+            code = concat(code, " = STATIC_FUNCTION(cjs_function_");
+            code = concat(code, name);
+            code = concat(code, ", ");
+            code = concat(code, name);
+            code = concat(code, ");\n");
+            cells = concat(cells, strlen(cells) > 0 ? ",\n    { STATIC_VARIABLE(cjs_function_" : "    { STATIC_VARIABLE(cjs_function_");
+            cells = concat(cells, name);
+            cells = concat(cells, "), true, false }");
+        }
+    }
+    if ( strlen(code) == 0 ) {
+        free(cells);
+        return code;
+    }
+    if ( globals ) {
+        code = concat(code, "\nstatic GlobalCell cjs_globals[] = {\n");
+        code = concat(code, cells);
+        code = concat(code, "\n};\n");
+    }
+    free(cells);
+    code = concat(code, "\n");
+    char* header = new_string("////////////////////////////////////////////////////////////////////////////////\n");
+    header = concat(header, "// top level functions\n\n");
+    header = concat(header, code);
+    free(code);
+    return header;
+}
+
+// Binds the names of the program's top level functions to their cells in `cjs_globals`, all before any code runs.
+static char* Program_defineGlobalsCode(Program_node* program) {
+    char* names = new_string("");
+    int count = 0;
+    for ( int i = 0 ; i < program->sourceElements->count ; i++ ) {
+        if ( program->sourceElements->elements[i]->type == FUNCTION_DECLARATION_SOURCE_ELEMENT_TYPE ) {
+            names = concat(names, count > 0 ? ", " : "");
+            names = concat_atom(names, program->sourceElements->elements[i]->sourceElementUnion.functionDeclaration->identifier->name);
+            count += 1;
+        }
+    }
+    if ( count == 0 ) {
+        free(names);
+        return new_string("");
+    }
+    char countCode[16];
+    sprintf(countCode, "%d", count);
+    char* code = new_string("\nnative_defineGlobals(");
+    code = concat(code, countCode);
+    code = concat(code, ", (char*[]){ ");
+    code = concat(code, names);
+    code = concat(code, " }, cjs_globals);");
+    free(names);
+    return code;
+}
+
+// The top level code of the program, run in `scope`. A program's top level functions are bound already, a module
+// binds each of them in its own scope where it is declared.
+static char* Program_sourceElementsCode(Program_node* program) {
+    char* code = new_string("");
+    for ( int i = 0 ; i < program->sourceElements->count ; i++ ) {
+        SourceElement_node* sourceElement = program->sourceElements->elements[i];
+        if ( globalScopeCode && sourceElement->type == FUNCTION_DECLARATION_SOURCE_ELEMENT_TYPE ) continue;
+        code = concat(code, "\n");
+        switch (sourceElement->type) {
+            case FUNCTION_DECLARATION_SOURCE_ELEMENT_TYPE: {
+                FunctionDeclaration_node* functionDeclaration = sourceElement->sourceElementUnion.functionDeclaration;
+                char* tmp = Declaration_toCode(functionDeclaration->identifier->name);
+                code = concat(code, tmp);
+                free(tmp);
+                code = concat(code, "\nscope->setVariable(scope, ");
+                code = concat_atom(code, functionDeclaration->identifier->name);
+                code = concat(code, ", STATIC_VARIABLE(cjs_function_");
+                code = concat(code, functionDeclaration->identifier->name);
+                code = concat(code, "));");
+            } break;
+            case STATEMENT_SOURCE_ELEMENT_TYPE: {
+                Statement_node* statement = sourceElement->sourceElementUnion.statement;
+                char* tmp = statement->toCode(statement);
+                code = concat(code, tmp);
+                free(tmp);
+            } break;
+        }
+    }
+    return code;
+}
+
+// Includes, the entry points of the modules the program requires, the atoms and the string literals. Only complete once
+// the rest of the program has been generated.
+static char* Program_headerCode() {
+    char* code = new_string("");
+    code = concat(code, INSTRUMENT_FUNCTIONS ? "#include <math.h>\n#include <stdlib.h>\n#include \"profile.h\"\n#include \"runtime.h\"\n\n" : "#include <math.h>\n#include <stdlib.h>\n#include \"runtime.h\"\n\n");
+    if ( requiredModuleCount > 0 ) {
+        code = concat(code, "////////////////////////////////////////////////////////////////////////////////\n");
+        code = concat(code, "// required modules\n\n");
+        for ( int i = 0 ; i < requiredModuleCount ; i++ ) {
+            code = concat(code, "Variable ");
+            code = concat(code, requiredModules[i]);
+            code = concat(code, "(Scope*);\n");
+        }
+        code = concat(code, "\n");
+    }
+    code = concat(code, "////////////////////////////////////////////////////////////////////////////////\n");
+    code = concat(code, "// atoms\n\n");
+    code = concat(code, "static char* cjs_atoms[] = {\n");
+    for ( int i = 0 ; i < atomCount ; i++ ) {
+        code = concat(code, "    ");
+        code = concat(code, atoms[i]);
+        code = concat(code, ",\n");
+    }
+    code = concat(code, "    NULL\n};\n\n");
+    code = concat(code, "////////////////////////////////////////////////////////////////////////////////\n");
+    code = concat(code, "// string literals\n\n");
+    code = concat(code, "static char* cjs_literals[] = {\n");
+    for ( int i = 0 ; i < stringCount ; i++ ) {
+        code = concat(code, "    ");
+        code = concat(code, strings[i]);
+        code = concat(code, ",\n");
+    }
+    code = concat(code, "    NULL\n};\n\n");
+    code = concat(code, "static Variable cjs_strings[sizeof(cjs_literals) / sizeof(char*)];\n\n");
+    return code;
+}
+
+char* Program_toCode(Program_node* program) {
+    char* functions = Program_functionDeclarationsCode(program);
+    char* staticFunctions = Program_staticFunctionsCode(program, 1);
+    char* code = new_string("");
     code = concat(code, "////////////////////////////////////////////////////////////////////////////////\n");
     code = concat(code, "// main program\n\n");
     code = concat(code, "int main(int argc, char** argv) {\n");
@@ -315,35 +803,148 @@ char* Program_toCode(Program_node* program) {
     if ( program->sourceElements->count == 0 ) {
         tmp1 = concat_comment(tmp1, "empty program");
     } else {
-        tmp1 = concat(tmp1, "Scope* scope = new_Scope(NULL);\ninitialize_runtime(scope);");
-        for ( int i = 0 ; i < program->sourceElements->count ; i++ ) {
-            SourceElement_node* sourceElement = program->sourceElements->elements[i];
-            tmp1 = concat(tmp1, "\n");
-            switch (sourceElement->type) {
-                case FUNCTION_DECLARATION_SOURCE_ELEMENT_TYPE: {
-                    FunctionDeclaration_node* functionDeclaration = sourceElement->sourceElementUnion.functionDeclaration;
-                    tmp1 = concat(tmp1, "scope->defineVariable(scope, \"");
-                    tmp1 = concat(tmp1, functionDeclaration->identifier->name);
-                    tmp1 = concat(tmp1, "\");\nscope->setVariable(scope, \"");
-                    tmp1 = concat(tmp1, functionDeclaration->identifier->name);
-                    tmp1 = concat(tmp1, "\", new_function(");
-                    tmp1 = concat(tmp1, functionDeclaration->identifier->name);
-                    tmp1 = concat(tmp1, "));");
-                } break;
-                case STATEMENT_SOURCE_ELEMENT_TYPE: {
-                    Statement_node* statement = sourceElement->sourceElementUnion.statement;
-                    char* tmp2 = statement->toCode(statement);
-                    tmp1 = concat(tmp1, tmp2);
-                    free(tmp2);
-                } break;
-            }
-        }
+        tmp1 = concat(tmp1, INSTRUMENT_FUNCTIONS ? "profile_start();\n" : "");
+        tmp1 = concat(tmp1, "atom_internAll(cjs_atoms);\nnative_internLiterals(cjs_literals, cjs_strings);\nScope* scope = new_Scope(NULL);\ninitialize_runtime(scope);");
+        char* tmp2 = Program_defineGlobalsCode(program);
+        tmp1 = concat(tmp1, tmp2);
+        free(tmp2);
+        globalScopeCode = 1;
+        tmp2 = Program_sourceElementsCode(program);
+        globalScopeCode = 0;
+        tmp1 = concat(tmp1, tmp2);
+        free(tmp2);
     }
     tmp1 = concat(tmp1, "\nreturn 0;");
     code = concat_indent(code, tmp1);
     free(tmp1);
     code = concat(code, "\n}");
-    return code;
+    char* header = Program_headerCode();
+    header = concat(header, functions);
+    header = concat(header, staticFunctions);
+    header = concat(header, code);
+    free(functions);
+    free(staticFunctions);
+    free(code);
+    return header;
+}
+
+/*
+ * Generates a module instead of a program: no main(), but one entry point
+ *
+ *     Variable cjs_module_<name>(Scope* globalScope);
+ *
+ * which runs the top level code of the module the first time it is called, in a scope of its own whose parent is the
+ * global scope, and returns the value of the module's `exports` variable (an empty object to begin with). Later calls
+ * return the same exports without running the module again. Programs, and other modules, call it for `require()`.
+ */
+char* Program_toModuleCode(Program_node* program, char* path) {
+    moduleSymbol = Module_symbol(path, NULL);
+    moduleName = Module_path(path, NULL);
+    char* functions = Program_functionDeclarationsCode(program);
+    char* staticFunctions = Program_staticFunctionsCode(program, 0);
+    char* code = new_string("");
+    code = concat(code, "////////////////////////////////////////////////////////////////////////////////\n");
+    code = concat(code, "// module entry point\n\n");
+    code = concat(code, "Variable ");
+    code = concat(code, moduleSymbol);
+    code = concat(code, "(Scope* globalScope) {\n");
+    char* tmp1 = new_string("if ( moduleScope != NULL ) {\n");
+    char* tmp2 = new_string("return moduleScope->getVariable(moduleScope, ");
+    tmp2 = concat_atom(tmp2, "exports");
+    tmp2 = concat(tmp2, ");");
+    tmp1 = concat_indent(tmp1, tmp2);
+    free(tmp2);
+    tmp1 = concat(tmp1, "\n}\natom_internAll(cjs_atoms);\nnative_internLiterals(cjs_literals, cjs_strings);\nScope* scope = moduleScope = new_PermanentScope(globalScope);\n");
+    tmp2 = Declaration_toCode("exports");
+    tmp1 = concat(tmp1, tmp2);
+    free(tmp2);
+    tmp1 = concat(tmp1, "\nscope->setVariable(scope, ");
+    tmp1 = concat_atom(tmp1, "exports");
+    tmp1 = concat(tmp1, ", new_object(0, NULL, NULL));");
+    tmp2 = Program_sourceElementsCode(program);
+    tmp1 = concat(tmp1, tmp2);
+    free(tmp2);
+    tmp1 = concat(tmp1, "\nreturn scope->getVariable(scope, ");
+    tmp1 = concat_atom(tmp1, "exports");
+    tmp1 = concat(tmp1, ");");
+    code = concat_indent(code, tmp1);
+    free(tmp1);
+    code = concat(code, "\n}");
+    char* header = Program_headerCode();
+    header = concat(header, "static Scope* moduleScope = NULL;\n\n");
+    header = concat(header, functions);
+    header = concat(header, staticFunctions);
+    header = concat(header, code);
+    free(functions);
+    free(staticFunctions);
+    free(code);
+    free(moduleSymbol);
+    free(moduleName);
+    moduleSymbol = NULL;
+    moduleName = NULL;
+    return header;
+}
+
+// The path of a module from the directory the transpiler runs in, without `.js`, `.` and `..`: a path starting with
+// `./` or `../` is relative to the directory of the file that requires it, any other path to the current directory.
+// `require("./util")` in lib/a/main.js, `require("lib/a/util.js")` and `--module lib/a/util.js` are all lib/a/util.
+static char* Module_path(char* path, char* requiredFrom) {
+    char* joined = new_string("");
+    if ( requiredFrom != NULL && ( strncmp(path, "./", 2) == 0 || strncmp(path, "../", 3) == 0 ) ) {
+        char* slash = strrchr(requiredFrom, '/');
+        if ( slash != NULL ) {
+            joined = (char*) realloc(joined, slash - requiredFrom + 2);
+            strncpy(joined, requiredFrom, slash - requiredFrom + 1);
+            joined[slash - requiredFrom + 1] = 0;
+        }
+    }
+    joined = concat(joined, path);
+    size_t length = strlen(joined);
+    if ( length > 3 && strcmp(joined + length - 3, ".js") == 0 ) {
+        joined[length - 3] = 0;
+    }
+    char* normalized = (char*) calloc(strlen(joined) + 1, sizeof(char));
+    size_t end = 0;
+    for ( char* segment = strtok(joined, "/") ; segment != NULL ; segment = strtok(NULL, "/") ) {
+        char* parent = strrchr(normalized, '/');
+        parent = parent == NULL ? normalized : parent + 1;
+        if ( strcmp(segment, ".") == 0 ) continue;
+        if ( strcmp(segment, "..") == 0 && end > 0 && strcmp(parent, "..") != 0 ) {
+            end = parent == normalized ? 0 : parent - normalized - 1;
+            normalized[end] = 0;
+            continue;
+        }
+        if ( end > 0 ) {
+            normalized[end++] = '/';
+        }
+        strcpy(normalized + end, segment);
+        end += strlen(segment);
+    }
+    free(joined);
+    return normalized;
+}
+
+// The C name of the entry point of a module, from its path by Module_path(): letters and digits stay, `/` becomes `__`
+// and any other character `_` and its two hex digits, so that lib/a/util is cjs_module_lib__a__util and no two paths
+// share a name.
+char* Module_symbol(char* path, char* requiredFrom) {
+    char* name = Module_path(path, requiredFrom);
+    size_t length = strlen(name);
+    char* symbol = (char*) calloc(strlen("cjs_module_") + 3 * length + 1, sizeof(char));
+    strcpy(symbol, "cjs_module_");
+    char* tmp = symbol + strlen(symbol);
+    for ( size_t i = 0 ; i < length ; i++ ) {
+        char c = name[i];
+        if ( ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' ) || ( c >= '0' && c <= '9' ) ) {
+            *tmp++ = c;
+        } else if ( c == '/' ) {
+            tmp += sprintf(tmp, "__");
+        } else {
+            tmp += sprintf(tmp, "_%02x", (unsigned char) c);
+        }
+    }
+    free(name);
+    return symbol;
 }
 
 Program_node* createProgram(SourceElements_node* sourceElements) {
@@ -389,13 +990,11 @@ char* VariableDeclaration_toString(VariableDeclaration_node* variableDeclaration
 }
 
 char* VariableDeclaration_toCode(VariableDeclaration_node* variableDeclaration) {
-    char* code = new_string("scope->defineVariable(scope, \"");
-    code = concat(code, variableDeclaration->identifier->name);
-    code = concat(code, "\");");
+    char* code = Declaration_toCode(variableDeclaration->identifier->name);
     if ( variableDeclaration->initializer != NULL ) {
-        code = concat(code, "\nscope->setVariable(scope, \"");
-        code = concat(code, variableDeclaration->identifier->name);
-        code = concat(code, "\", ");
+        code = concat(code, "\nscope->setVariable(scope, ");
+        code = concat_atom(code, variableDeclaration->identifier->name);
+        code = concat(code, ", ");
         char* tmp = variableDeclaration->initializer->toCode(variableDeclaration->initializer);
         code = concat(code, tmp);
         free(tmp);
@@ -408,6 +1007,7 @@ VariableDeclaration_node* createVariableDeclaration(Identifier_node* identifier)
     VariableDeclaration_node* variableDeclaration = (VariableDeclaration_node*) calloc(1, sizeof(VariableDeclaration_node));
     variableDeclaration->identifier = identifier;
     variableDeclaration->initializer = NULL;
+    getBinding(identifier->name)->declarations += 1;
     variableDeclaration->toString = VariableDeclaration_toString;
     variableDeclaration->toCode = VariableDeclaration_toCode;
     return variableDeclaration;
@@ -523,15 +1123,36 @@ char* Expression_toString(Expression_node* expression) {
             return expression->expressionUnion.callExpression->toString(expression->expressionUnion.callExpression);
         case MEMBER_EXPRESSION_TYPE:
             return expression->expressionUnion.memberExpression->toString(expression->expressionUnion.memberExpression);
+        case BINARY_EXPRESSION_TYPE:
+            return expression->expressionUnion.binaryExpression->toString(expression->expressionUnion.binaryExpression);
+        case UNARY_EXPRESSION_TYPE:
+            return expression->expressionUnion.unaryExpression->toString(expression->expressionUnion.unaryExpression);
+        case OBJECT_LITERAL_EXPRESSION_TYPE:
+            return expression->expressionUnion.objectLiteral->toString(expression->expressionUnion.objectLiteral);
+        case ARRAY_LITERAL_EXPRESSION_TYPE:
+            return expression->expressionUnion.arrayLiteral->toString(expression->expressionUnion.arrayLiteral);
     }
 }
 
 char* Expression_toCode(Expression_node* expression) {
     switch (expression->type) {
         case IDENTIFIER_EXPRESSION_TYPE: {
-            char* code = new_string("scope->getVariable(scope, \"");
-            code = concat(code, expression->expressionUnion.identifier->name);
-            code = concat(code, "\")");
+            char* code = Loop_hoist(expression);
+            if ( code == NULL ) {
+                Identifier_node* identifier = expression->expressionUnion.identifier;
+                code = new_string("({ static GlobalCache cache; ");
+                if ( PROFILE_SITES ) {
+                    char* tmp = Site_code(identifier->line, 0, "", identifier->name);
+                    code = concat(code, tmp);
+                    free(tmp);
+                }
+                char* access = new_string("native_getGlobal(scope, ");
+                access = concat_atom(access, identifier->name);
+                access = concat(access, ", &cache)");
+                code = concat_siteAccess(code, access);
+                free(access);
+                code = concat(code, "; })");
+            }
             return code;
         }
         case ASSIGNMENT_EXPRESSION_TYPE:
@@ -542,6 +1163,14 @@ char* Expression_toCode(Expression_node* expression) {
             return expression->expressionUnion.callExpression->toCode(expression->expressionUnion.callExpression);
         case MEMBER_EXPRESSION_TYPE:
             return expression->expressionUnion.memberExpression->toCode(expression->expressionUnion.memberExpression);
+        case BINARY_EXPRESSION_TYPE:
+            return expression->expressionUnion.binaryExpression->toCode(expression->expressionUnion.binaryExpression);
+        case UNARY_EXPRESSION_TYPE:
+            return expression->expressionUnion.unaryExpression->toCode(expression->expressionUnion.unaryExpression);
+        case OBJECT_LITERAL_EXPRESSION_TYPE:
+            return expression->expressionUnion.objectLiteral->toCode(expression->expressionUnion.objectLiteral);
+        case ARRAY_LITERAL_EXPRESSION_TYPE:
+            return expression->expressionUnion.arrayLiteral->toCode(expression->expressionUnion.arrayLiteral);
         default:
             return new_string("(/* Unsupported Expression */)");
     }
@@ -551,6 +1180,9 @@ Expression_node* createExpression(ExpressionType_enum type, void* untypedExpress
     Expression_node* expression = (Expression_node*) calloc(1, sizeof(Expression_node));
     expression->type = type;
     expression->expressionUnion.any = untypedExpression; // TODO do we need .any ?
+    if ( type == IDENTIFIER_EXPRESSION_TYPE ) {
+        getBinding(expression->expressionUnion.identifier->name)->references += 1;
+    }
     expression->toString = Expression_toString;
     expression->toCode = Expression_toCode;
     return expression;
@@ -578,34 +1210,45 @@ char* MemberExpression_toString(MemberExpression_node* memberExpression) {
     return string;
 }
 
+// A dot access goes through a static inline cache of its own, see PropertyCache in runtime.h, a bracket access is an
+// element access, see native_getElement(). The object is evaluated once, before the key.
 char* MemberExpression_toCode(MemberExpression_node* memberExpression) {
-    char* code = new_string("");
-    char* tmp1 = new_string("native_toObject(");
-    tmp1 = concat(tmp1, memberExpression->parent->toCode(memberExpression->parent));
-    tmp1 = concat(tmp1, ")");
-    code = concat(code, tmp1);
-    code = concat(code, "->getProperty(");
-    code = concat(code, tmp1);
-    free(tmp1);
-    code = concat(code, ", ");
-    char* tmp2;
+    char* code = new_string("({ ");
+    if ( memberExpression->type == DOT_MEMBER_EXPRESSION_TYPE ) {
+        code = concat(code, "static PropertyCache cache; ");
+    }
+    char* tmp;
+    if ( PROFILE_SITES ) {
+        tmp = memberExpression->type == DOT_MEMBER_EXPRESSION_TYPE
+            ? Site_code(memberExpression->line, 0, ".", memberExpression->child.identifier->name)
+            : Site_code(memberExpression->line, 0, "[]", "");
+        code = concat(code, tmp);
+        free(tmp);
+    }
+    code = concat(code, "Object* object = native_toObject(");
+    tmp = memberExpression->parent->toCode(memberExpression->parent);
+    code = concat(code, tmp);
+    free(tmp);
+    code = concat(code, "); ");
+    char* access;
     switch (memberExpression->type) {
         case DOT_MEMBER_EXPRESSION_TYPE:
-            tmp1 = new_string("\"");
-            tmp1 = concat(tmp1, memberExpression->child.identifier->name);
-            tmp1 = concat(tmp1, "\"");
+            access = new_string("native_getCachedProperty(object, ");
+            access = concat_atom(access, memberExpression->child.identifier->name);
+            access = concat(access, ", &cache)");
             break;
         case BRACKET_MEMBER_EXPRESSION_TYPE:
-            tmp1 = new_string("native_toString(");
-            tmp2 = memberExpression->child.expression->toCode(memberExpression->child.expression);
-            tmp1 = concat(tmp1, tmp2);
-            free(tmp2);
-            tmp1 = concat(tmp1, ")");
+            code = concat(code, "Variable key = ");
+            tmp = memberExpression->child.expression->toCode(memberExpression->child.expression);
+            code = concat(code, tmp);
+            free(tmp);
+            code = concat(code, "; ");
+            access = new_string("native_getElement(object, key)");
             break;
     }
-    code = concat(code, tmp1);
-    free(tmp1);
-    code = concat(code, ")");
+    code = concat_siteAccess(code, access);
+    free(access);
+    code = concat(code, "; })");
     return code;
 }
 
@@ -614,6 +1257,10 @@ MemberExpression_node* createMemberExpression(Expression_node* parent, MemberExp
     memberExpression->type = type;
     memberExpression->parent = parent;
     memberExpression->child.any = child;
+    memberExpression->line = yylineno;
+    if ( parent->type == IDENTIFIER_EXPRESSION_TYPE ) {
+        getBinding(parent->expressionUnion.identifier->name)->memberReferences += 1;
+    }
     memberExpression->toString = MemberExpression_toString;
     memberExpression->toCode = MemberExpression_toCode;
     return memberExpression;
@@ -665,52 +1312,72 @@ char* AssignmentExpression_toCode(AssignmentExpression_node* assignmentExpressio
     char* code = new_string("");
     char* tmp;
     switch (assignmentExpression->leftHandSideExpression->type) {
-        case IDENTIFIER_LEFT_HAND_SIDE_EXPRESSION_TYPE:
-            tmp = new_string("scope");
-            break;
-        case MEMBER_EXPRESSION_LEFT_HAND_SIDE_EXPRESSION_TYPE: {
-            MemberExpression_node* memberExpression = assignmentExpression->leftHandSideExpression->leftHandSideExpressionUnion.memberExpression;
-            tmp = new_string("native_toObject(");
-            tmp = concat(tmp, memberExpression->parent->toCode(memberExpression->parent));
-            tmp = concat(tmp, ")");
+        case IDENTIFIER_LEFT_HAND_SIDE_EXPRESSION_TYPE: {
+            Identifier_node* identifier = assignmentExpression->leftHandSideExpression->leftHandSideExpressionUnion.identifier;
+            code = concat(code, "({ static GlobalCache cache; ");
+            if ( PROFILE_SITES ) {
+                tmp = Site_code(identifier->line, 1, "", identifier->name);
+                code = concat(code, tmp);
+                free(tmp);
+            }
+            code = concat(code, "Variable value = ");
+            tmp = assignmentExpression->expression->toCode(assignmentExpression->expression);
+            code = concat(code, tmp);
+            free(tmp);
+            code = concat(code, "; ");
+            char* access = new_string("native_setGlobal(scope, ");
+            access = concat_atom(access, identifier->name);
+            access = concat(access, ", value, &cache)");
+            code = concat_siteAccess(code, access);
+            free(access);
+            code = concat(code, "; })");
+            return code;
         }
-    }
-    code = concat(code, tmp);
-    code = concat(code, "->setProperty(");
-    code = concat(code, tmp);
-    free(tmp);
-    code = concat(code, ", ");
-    switch (assignmentExpression->leftHandSideExpression->type) {
-        case IDENTIFIER_LEFT_HAND_SIDE_EXPRESSION_TYPE:
-            code = concat(code, "\"");
-            code = concat(code, assignmentExpression->leftHandSideExpression->leftHandSideExpressionUnion.identifier->name);
-            code = concat(code, "\"");
-            break;
         case MEMBER_EXPRESSION_LEFT_HAND_SIDE_EXPRESSION_TYPE: {
+            // like MemberExpression_toCode(), the object is evaluated first, then the key and then the value
             MemberExpression_node* memberExpression = assignmentExpression->leftHandSideExpression->leftHandSideExpressionUnion.memberExpression;
-            switch (memberExpression->type) {
-                case DOT_MEMBER_EXPRESSION_TYPE:
-                    code = concat(code, "\"");
-                    code = concat(code, memberExpression->child.identifier->name);
-                    code = concat(code, "\"");
-                    break;
-                case BRACKET_MEMBER_EXPRESSION_TYPE: {
-                    code = concat(code, "native_toString(");
-                    char* tmp = memberExpression->child.expression->toCode(memberExpression->child.expression);
-                    code = concat(code, tmp);
-                    free(tmp);
-                    code = concat(code, ")");
-                    break;
-                }
+            code = concat(code, "({ ");
+            if ( memberExpression->type == DOT_MEMBER_EXPRESSION_TYPE ) {
+                code = concat(code, "static PropertyCache cache; ");
             }
-            break;
+            if ( PROFILE_SITES ) {
+                tmp = memberExpression->type == DOT_MEMBER_EXPRESSION_TYPE
+                    ? Site_code(memberExpression->line, 1, ".", memberExpression->child.identifier->name)
+                    : Site_code(memberExpression->line, 1, "[]", "");
+                code = concat(code, tmp);
+                free(tmp);
+            }
+            code = concat(code, "Object* object = native_toObject(");
+            tmp = memberExpression->parent->toCode(memberExpression->parent);
+            code = concat(code, tmp);
+            free(tmp);
+            code = concat(code, "); ");
+            if ( memberExpression->type == BRACKET_MEMBER_EXPRESSION_TYPE ) {
+                code = concat(code, "Variable key = ");
+                tmp = memberExpression->child.expression->toCode(memberExpression->child.expression);
+                code = concat(code, tmp);
+                free(tmp);
+                code = concat(code, "; ");
+            }
+            code = concat(code, "Variable value = ");
+            tmp = assignmentExpression->expression->toCode(assignmentExpression->expression);
+            code = concat(code, tmp);
+            free(tmp);
+            code = concat(code, "; ");
+            char* access;
+            if ( memberExpression->type == DOT_MEMBER_EXPRESSION_TYPE ) {
+                access = new_string("native_setCachedProperty(object, ");
+                access = concat_atom(access, memberExpression->child.identifier->name);
+                access = concat(access, ", value, &cache)");
+            } else {
+                access = new_string("native_setElement(object, key, value)");
+            }
+            code = concat_siteAccess(code, access);
+            free(access);
+            code = concat(code, "; })");
+            return code;
         }
     }
-    code = concat(code, ", ");
-    tmp = assignmentExpression->expression->toCode(assignmentExpression->expression);
-    code = concat(code, tmp);
-    free(tmp);
-    code = concat(code, ")");
     return code;
 }
 
@@ -719,6 +1386,18 @@ AssignmentExpression_node* createAssignmentExpression(LeftHandSideExpression_nod
     assignmentExpression->leftHandSideExpression = leftHandSideExpression;
     assignmentExpression->assignmentOperator = assignmentOperator;
     assignmentExpression->expression = expression;
+    switch (leftHandSideExpression->type) {
+        case IDENTIFIER_LEFT_HAND_SIDE_EXPRESSION_TYPE:
+            getBinding(leftHandSideExpression->leftHandSideExpressionUnion.identifier->name)->assignments += 1;
+            break;
+        case MEMBER_EXPRESSION_LEFT_HAND_SIDE_EXPRESSION_TYPE: {
+            Expression_node* parent = leftHandSideExpression->leftHandSideExpressionUnion.memberExpression->parent;
+            if ( parent->type == IDENTIFIER_EXPRESSION_TYPE ) {
+                getBinding(parent->expressionUnion.identifier->name)->memberAssignments += 1;
+            }
+            break;
+        }
+    }
     assignmentExpression->toString = AssignmentExpression_toString;
     assignmentExpression->toCode = AssignmentExpression_toCode;
     return assignmentExpression;
@@ -739,55 +1418,233 @@ char* CallExpression_toString(CallExpression_node* callExpression) {
     return string;
 }
 
-char* CallExpression_toCode(CallExpression_node* callExpression) {
-    char* code = new_string("native_toObject(");
-    code = concat(code, callExpression->function->toCode(callExpression->function));
-    code = concat(code, ")->call(native_toObject(");
-    code = concat(code, callExpression->function->toCode(callExpression->function));
-    code = concat(code, "), scope, ");
-    char* tmp = callExpression->argumentList->toCode(callExpression->argumentList);
-    code = concat(code, tmp);
-    free(tmp);
-    code = concat(code, ").value");
-    return code;
-}
-
-CallExpression_node* createCallExpression(Expression_node* function, ArgumentList_node* argumentList) {
-    CallExpression_node* callExpression = (CallExpression_node*) calloc(1, sizeof(CallExpression_node));
-    callExpression->function = function;
-    callExpression->argumentList = argumentList;
-    callExpression->toString = CallExpression_toString;
-    callExpression->toCode = CallExpression_toCode;
-    return callExpression;
-}
-
-void ArgumentList_append(ArgumentList_node* argumentList, Expression_node* argument) {
-    argumentList->arguments = (Expression_node**) realloc(argumentList->arguments, ( argumentList->count + 1 ) * sizeof(Expression_node*) );
-    argumentList->arguments[argumentList->count] = argument;
-    argumentList->count += 1;
-}
+static char Expression_hasSideEffects(Expression_node*);
+static char Expression_needsSequence(Expression_node**, int);
 
-char* ArgumentList_toString(ArgumentList_node* argumentList) {
-    char* string = new_string("ArgumentList");
-    for ( int i = 0 ; i < argumentList->count ; i++ ) {
-        string = concat(string, "\n");
-        char* tmp = argumentList->arguments[i]->toString(argumentList->arguments[i]);
-        string = concat_indent(string, tmp);
-        free(tmp);
+// The string form of a literal that has a fixed one, or NULL.
+static char* Expression_foldedString(Expression_node* argument) {
+    if ( argument->type != LITERAL_EXPRESSION_TYPE ) return NULL;
+    Literal_node* literal = argument->expressionUnion.literal;
+    switch (literal->type) {
+        case NULL_LITERAL_TYPE:
+            return "null";
+        case BOOLEAN_LITERAL_TYPE:
+            return literal->literalUnion.booleanLiteral->boolean ? "true" : "false";
+        case STRING_LITERAL_TYPE:
+            return literal->literalUnion.stringLiteral->string;
+        default:
+            return NULL;
     }
-    return string;
 }
 
-char* ArgumentList_toCode(ArgumentList_node* argumentList) {
+static char* CallExpression_toApplyCode(CallExpression_node*);
+
+// Lowers `console.log(...)` and `console.error(...)` to a single `native_consoleWrite()`, with every literal that
+// has a fixed string form folded into the format at compile time. Returns NULL if the call is not such a call. The
+// other arguments are varargs, which C evaluates in no particular order, so if any of them has side effects they are
+// evaluated into locals first, in order, like the arguments of CallExpression_toCode().
+static char* CallExpression_toConsoleWriteCode(CallExpression_node* callExpression) {
+    if ( callExpression->function->type != MEMBER_EXPRESSION_TYPE ) return NULL;
+    MemberExpression_node* memberExpression = callExpression->function->expressionUnion.memberExpression;
+    if ( memberExpression->type != DOT_MEMBER_EXPRESSION_TYPE ) return NULL;
+    if ( memberExpression->parent->type != IDENTIFIER_EXPRESSION_TYPE ) return NULL;
+    if ( strcmp(memberExpression->parent->expressionUnion.identifier->name, "console") != 0 ) return NULL;
+    char* output;
+    if ( strcmp(memberExpression->child.identifier->name, "log") == 0 ) {
+        output = "&output_stdout";
+    } else if ( strcmp(memberExpression->child.identifier->name, "error") == 0 ) {
+        output = "&output_stderr";
+    } else {
+        return NULL;
+    }
+    if ( !isBuiltinConsole() ) return NULL;
+    char sequence = 0;
+    for ( int i = 0 ; i < callExpression->argumentList->count ; i++ ) {
+        Expression_node* argument = callExpression->argumentList->arguments[i];
+        if ( Expression_foldedString(argument) == NULL && Expression_hasSideEffects(argument) ) sequence = 1;
+    }
+    char* format = new_string("");
+    char* locals = new_string("");
+    char* values = new_string("");
+    for ( int i = 0 ; i < callExpression->argumentList->count ; i++ ) {
+        Expression_node* argument = callExpression->argumentList->arguments[i];
+        if ( i > 0 ) format = concat(format, " ");
+        char* folded = Expression_foldedString(argument);
+        if ( folded == NULL ) {
+            format = concat(format, "%v");
+            values = concat(values, ", ");
+            char* tmp = argument->toCode(argument);
+            if ( sequence ) {
+                char local[30];
+                sprintf(local, "argument_%i", i);
+                locals = concat(locals, "Variable ");
+                locals = concat(locals, local);
+                locals = concat(locals, " = ");
+                locals = concat(locals, tmp);
+                locals = concat(locals, "; ");
+                values = concat(values, local);
+            } else {
+                values = concat(values, tmp);
+            }
+            free(tmp);
+        } else {
+            for ( int j = 0 ; j < strlen(folded) ; j++ ) {
+                if ( folded[j] == '%' ) format = concat_char(format, '%');
+                format = concat_char(format, folded[j]);
+            }
+        }
+    }
+    char* code = new_string(sequence ? "({ " : "");
+    code = concat(code, locals);
+    free(locals);
+    code = concat(code, "native_consoleWrite(");
+    code = concat(code, output);
+    code = concat(code, ", \"");
+    code = concat_escaped(code, format);
+    free(format);
+    code = concat(code, "\"");
+    code = concat(code, values);
+    free(values);
+    code = concat(code, sequence ? "); })" : ")");
+    if ( moduleSymbol == NULL && getBinding("require")->references == 0 ) {
+        return code;
+    }
+    // Code linked from other modules may have replaced `console` or its methods, so check it still is the builtin.
+    char* guarded = new_string("( native_isBuiltinConsole(");
+    char* tmp = memberExpression->parent->toCode(memberExpression->parent);
+    guarded = concat(guarded, tmp);
+    free(tmp);
+    guarded = concat(guarded, ") ? ");
+    guarded = concat(guarded, code);
+    free(code);
+    guarded = concat(guarded, " : ");
+    tmp = CallExpression_toApplyCode(callExpression);
+    guarded = concat(guarded, tmp);
+    free(tmp);
+    guarded = concat(guarded, " )");
+    return guarded;
+}
+
+// `require("path/name")` calls the entry point of the module compiled from path/name.js, see Module_symbol().
+static char* CallExpression_toRequireCode(CallExpression_node* callExpression) {
+    if ( callExpression->function->type != IDENTIFIER_EXPRESSION_TYPE ) return NULL;
+    if ( strcmp(callExpression->function->expressionUnion.identifier->name, "require") != 0 ) return NULL;
+    if ( callExpression->argumentList->count != 1 ) return NULL;
+    Expression_node* argument = callExpression->argumentList->arguments[0];
+    if ( argument->type != LITERAL_EXPRESSION_TYPE || argument->expressionUnion.literal->type != STRING_LITERAL_TYPE ) return NULL;
+    if ( !isBuiltinRequire() ) return NULL;
+    char* symbol = Module_symbol(argument->expressionUnion.literal->literalUnion.stringLiteral->string, SOURCE_FILE);
+    char known = 0;
+    for ( int i = 0 ; i < requiredModuleCount ; i++ ) {
+        known = known || strcmp(symbol, requiredModules[i]) == 0;
+    }
+    if ( !known ) {
+        requiredModules = (char**) realloc(requiredModules, ( requiredModuleCount + 1 ) * sizeof(char*) );
+        requiredModules[requiredModuleCount] = new_string(symbol);
+        requiredModuleCount += 1;
+    }
+    char* code = new_string(symbol);
+    code = concat(code, "(native_globalScope(scope))");
+    free(symbol);
+    return code;
+}
+
+char* CallExpression_toCode(CallExpression_node* callExpression) {
+    char* lowered = CallExpression_toConsoleWriteCode(callExpression);
+    if ( lowered != NULL ) return lowered;
+    lowered = CallExpression_toRequireCode(callExpression);
+    if ( lowered != NULL ) return lowered;
+    return CallExpression_toApplyCode(callExpression);
+}
+
+// The callee is evaluated once, before the arguments, and the arguments go to it as an array on the caller's stack.
+static char* CallExpression_toApplyCode(CallExpression_node* callExpression) {
+    ArgumentList_node* argumentList = callExpression->argumentList;
+    char sequence = Expression_needsSequence(argumentList->arguments, argumentList->count);
+    char* code = new_string("({ Object* callee = native_toObject(");
+    char* tmp = callExpression->function->toCode(callExpression->function);
+    code = concat(code, tmp);
+    free(tmp);
+    code = concat(code, "); ");
+    if ( !sequence ) {
+        code = concat(code, "callee->call(callee, scope, ");
+        tmp = argumentList->toCode(argumentList);
+        code = concat(code, tmp);
+        free(tmp);
+    } else {
+        char* values = new_string("");
+        for ( int i = 0 ; i < argumentList->count ; i++ ) {
+            char* local = (char*) calloc(30, sizeof(char));
+            sprintf(local, "argument_%i", i);
+            code = concat(code, "Variable ");
+            code = concat(code, local);
+            code = concat(code, " = ");
+            tmp = argumentList->arguments[i]->toCode(argumentList->arguments[i]);
+            code = concat(code, tmp);
+            free(tmp);
+            code = concat(code, "; ");
+            values = concat(values, i > 0 ? ", " : "");
+            values = concat(values, local);
+            free(local);
+        }
+        code = concat(code, "callee->call(callee, scope, ");
+        tmp = (char*) calloc(20, sizeof(char));
+        sprintf(tmp, "%i", argumentList->count);
+        code = concat(code, tmp);
+        free(tmp);
+        code = concat(code, ", (Variable[]){ ");
+        code = concat(code, values);
+        code = concat(code, " }");
+        free(values);
+    }
+    code = concat(code, ").value; })");
+    return code;
+}
+
+CallExpression_node* createCallExpression(Expression_node* function, ArgumentList_node* argumentList) {
+    CallExpression_node* callExpression = (CallExpression_node*) calloc(1, sizeof(CallExpression_node));
+    callExpression->function = function;
+    callExpression->argumentList = argumentList;
+    callExpression->toString = CallExpression_toString;
+    callExpression->toCode = CallExpression_toCode;
+    return callExpression;
+}
+
+void ArgumentList_append(ArgumentList_node* argumentList, Expression_node* argument) {
+    argumentList->arguments = (Expression_node**) realloc(argumentList->arguments, ( argumentList->count + 1 ) * sizeof(Expression_node*) );
+    argumentList->arguments[argumentList->count] = argument;
+    argumentList->count += 1;
+}
+
+char* ArgumentList_toString(ArgumentList_node* argumentList) {
+    char* string = new_string("ArgumentList");
+    for ( int i = 0 ; i < argumentList->count ; i++ ) {
+        string = concat(string, "\n");
+        char* tmp = argumentList->arguments[i]->toString(argumentList->arguments[i]);
+        string = concat_indent(string, tmp);
+        free(tmp);
+    }
+    return string;
+}
+
+// The argument count and the arguments as an array, or NULL without any.
+char* ArgumentList_toCode(ArgumentList_node* argumentList) {
     char* code = (char*) calloc(12, sizeof(char));
     sprintf(code, "%i", argumentList->count);
     code = (char*) realloc(code, strlen(code)+1);
+    if ( argumentList->count == 0 ) {
+        return concat(code, ", NULL");
+    }
+    code = concat(code, ", (Variable[]){ ");
     for ( int i = 0 ; i < argumentList->count ; i++ ) {
-        code = concat(code, ", ");
+        if ( i > 0 ) {
+            code = concat(code, ", ");
+        }
         char* tmp = argumentList->arguments[i]->toCode(argumentList->arguments[i]);
         code = concat(code, tmp);
         free(tmp);
     }
+    code = concat(code, " }");
     return code;
 }
 
@@ -942,27 +1799,15 @@ NumberLiteral_node* createNumberLiteral(double number) {
 
 char* StringLiteral_toString(StringLiteral_node* stringLiteral) {
     char* string = new_string("\"");
-    for ( int i =  0 ; i < strlen(stringLiteral->string) ; i++ ) {
-        switch (stringLiteral->string[i]) {
-            case '\b': string = concat(string, "\\b");  break; // \b backspace
-            case '\f': string = concat(string, "\\f");  break; // \f form feed
-            case '\n': string = concat(string, "\\n");  break; // \n line feed (new line)
-            case '\r': string = concat(string, "\\r");  break; // \r carriage return
-            case '\t': string = concat(string, "\\t");  break; // \t horizontal tab
-            case '"':  string = concat(string, "\\\""); break; // \" double quotation mark
-            default:   string = concat_char(string, stringLiteral->string[i]);
-        }
-    }
+    string = concat_escaped(string, stringLiteral->string);
     string = concat(string, "\"");
     return string;
 }
 
 char* StringLiteral_toCode(StringLiteral_node* stringLiteral) {
-    char* code = new_string("new_string(");
     char* tmp = stringLiteral->toString(stringLiteral);
-    code = concat(code, tmp);
+    char* code = String_toCode(tmp);
     free(tmp);
-    code = concat(code, ")");
     return code;
 }
 
@@ -973,3 +1818,888 @@ StringLiteral_node* createStringLiteral(char* string) {
     stringLiteral->toCode = StringLiteral_toCode;
     return stringLiteral;
 }
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Operators
+//
+// Besides the usual toCode(), which produces a `Variable`, operator expressions can be compiled straight to a C
+// `double` or `bool` when their result is known to be a number or a boolean. Nested arithmetic and comparisons then
+// run entirely on unboxed C values, and only the outermost result (if any) is boxed into a Variable.
+
+static char* BinaryOperator_toString(BinaryOperator_enum binaryOperator) {
+    switch (binaryOperator) {
+        case ASTERISK_BINARY_OPERATOR:                  return "*";
+        case SLASH_BINARY_OPERATOR:                     return "/";
+        case PERCENT_BINARY_OPERATOR:                   return "%";
+        case PLUS_BINARY_OPERATOR:                      return "+";
+        case MINUS_BINARY_OPERATOR:                     return "-";
+        case LEFT_SHIFT_BINARY_OPERATOR:                return "<<";
+        case RIGHT_SHIFT_BINARY_OPERATOR:               return ">>";
+        case UNSIGNED_RIGHT_SHIFT_BINARY_OPERATOR:      return ">>>";
+        case LESS_THAN_BINARY_OPERATOR:                 return "<";
+        case GREATER_THAN_BINARY_OPERATOR:              return ">";
+        case LESS_THAN_EQUALS_BINARY_OPERATOR:          return "<=";
+        case GREATER_THAN_EQUALS_BINARY_OPERATOR:       return ">=";
+        case EQUALS_EQUALS_BINARY_OPERATOR:             return "==";
+        case EXCLAMATION_EQUALS_BINARY_OPERATOR:        return "!=";
+        case EQUALS_EQUALS_EQUALS_BINARY_OPERATOR:      return "===";
+        case EXCLAMATION_EQUALS_EQUALS_BINARY_OPERATOR: return "!==";
+        case AMPERSAND_BINARY_OPERATOR:                 return "&";
+        case CARET_BINARY_OPERATOR:                     return "^";
+        case PIPE_BINARY_OPERATOR:                      return "|";
+        case AMPERSAND_AMPERSAND_BINARY_OPERATOR:       return "&&";
+        case PIPE_PIPE_BINARY_OPERATOR:                 return "||";
+    }
+}
+
+static char* UnaryOperator_toString(UnaryOperator_enum unaryOperator) {
+    switch (unaryOperator) {
+        case PLUS_UNARY_OPERATOR:        return "+";
+        case MINUS_UNARY_OPERATOR:       return "-";
+        case TILDE_UNARY_OPERATOR:       return "~";
+        case EXCLAMATION_UNARY_OPERATOR: return "!";
+    }
+}
+
+static char Expression_isNumber(Expression_node* expression) {
+    switch (expression->type) {
+        case LITERAL_EXPRESSION_TYPE:
+            return expression->expressionUnion.literal->type == NUMBER_LITERAL_TYPE;
+        case UNARY_EXPRESSION_TYPE:
+            return expression->expressionUnion.unaryExpression->unaryOperator != EXCLAMATION_UNARY_OPERATOR;
+        case BINARY_EXPRESSION_TYPE: {
+            BinaryExpression_node* binaryExpression = expression->expressionUnion.binaryExpression;
+            switch (binaryExpression->binaryOperator) {
+                case ASTERISK_BINARY_OPERATOR:
+                case SLASH_BINARY_OPERATOR:
+                case PERCENT_BINARY_OPERATOR:
+                case MINUS_BINARY_OPERATOR:
+                case LEFT_SHIFT_BINARY_OPERATOR:
+                case RIGHT_SHIFT_BINARY_OPERATOR:
+                case UNSIGNED_RIGHT_SHIFT_BINARY_OPERATOR:
+                case AMPERSAND_BINARY_OPERATOR:
+                case CARET_BINARY_OPERATOR:
+                case PIPE_BINARY_OPERATOR:
+                    return 1;
+                case PLUS_BINARY_OPERATOR:
+                    return Expression_isNumber(binaryExpression->left) && Expression_isNumber(binaryExpression->right);
+                default:
+                    return 0;
+            }
+        }
+        default:
+            return 0;
+    }
+}
+
+static char Expression_isBoolean(Expression_node* expression) {
+    switch (expression->type) {
+        case LITERAL_EXPRESSION_TYPE:
+            return expression->expressionUnion.literal->type == BOOLEAN_LITERAL_TYPE;
+        case UNARY_EXPRESSION_TYPE:
+            return expression->expressionUnion.unaryExpression->unaryOperator == EXCLAMATION_UNARY_OPERATOR;
+        case BINARY_EXPRESSION_TYPE: {
+            BinaryExpression_node* binaryExpression = expression->expressionUnion.binaryExpression;
+            switch (binaryExpression->binaryOperator) {
+                case LESS_THAN_BINARY_OPERATOR:
+                case GREATER_THAN_BINARY_OPERATOR:
+                case LESS_THAN_EQUALS_BINARY_OPERATOR:
+                case GREATER_THAN_EQUALS_BINARY_OPERATOR:
+                case EQUALS_EQUALS_BINARY_OPERATOR:
+                case EXCLAMATION_EQUALS_BINARY_OPERATOR:
+                case EQUALS_EQUALS_EQUALS_BINARY_OPERATOR:
+                case EXCLAMATION_EQUALS_EQUALS_BINARY_OPERATOR:
+                    return 1;
+                case AMPERSAND_AMPERSAND_BINARY_OPERATOR:
+                case PIPE_PIPE_BINARY_OPERATOR:
+                    return Expression_isBoolean(binaryExpression->left) && Expression_isBoolean(binaryExpression->right);
+                default:
+                    return 0;
+            }
+        }
+        default:
+            return 0;
+    }
+}
+
+static char Expression_hasSideEffects(Expression_node* expression) {
+    switch (expression->type) {
+        case ASSIGNMENT_EXPRESSION_TYPE:
+        case CALL_EXPRESSION_TYPE:
+            return 1;
+        case MEMBER_EXPRESSION_TYPE: {
+            MemberExpression_node* memberExpression = expression->expressionUnion.memberExpression;
+            if ( Expression_hasSideEffects(memberExpression->parent) ) return 1;
+            return memberExpression->type == BRACKET_MEMBER_EXPRESSION_TYPE && Expression_hasSideEffects(memberExpression->child.expression);
+        }
+        case BINARY_EXPRESSION_TYPE:
+            return Expression_hasSideEffects(expression->expressionUnion.binaryExpression->left)
+                || Expression_hasSideEffects(expression->expressionUnion.binaryExpression->right);
+        case UNARY_EXPRESSION_TYPE:
+            return Expression_hasSideEffects(expression->expressionUnion.unaryExpression->expression);
+        case OBJECT_LITERAL_EXPRESSION_TYPE: {
+            ObjectLiteral_node* objectLiteral = expression->expressionUnion.objectLiteral;
+            for ( int i = 0 ; i < objectLiteral->count ; i++ ) {
+                if ( Expression_hasSideEffects(objectLiteral->propertyAssignments[i]->expression) ) return 1;
+            }
+            return 0;
+        }
+        case ARRAY_LITERAL_EXPRESSION_TYPE: {
+            ArrayLiteral_node* arrayLiteral = expression->expressionUnion.arrayLiteral;
+            for ( int i = 0 ; i < arrayLiteral->count ; i++ ) {
+                if ( Expression_hasSideEffects(arrayLiteral->elements[i]) ) return 1;
+            }
+            return 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+// Whether the value of an expression is the same wherever it is evaluated, so that no side effect can change it.
+static char Expression_isConstant(Expression_node* expression) {
+    switch (expression->type) {
+        case LITERAL_EXPRESSION_TYPE:
+            return 1;
+        case BINARY_EXPRESSION_TYPE:
+            return Expression_isConstant(expression->expressionUnion.binaryExpression->left)
+                && Expression_isConstant(expression->expressionUnion.binaryExpression->right);
+        case UNARY_EXPRESSION_TYPE:
+            return Expression_isConstant(expression->expressionUnion.unaryExpression->expression);
+        default:
+            return 0;
+    }
+}
+
+// Whether expressions that C evaluates in no particular order, such as operands or the values of an initializer, have
+// to be evaluated in order into locals: when one of them has side effects that another one could observe.
+static char Expression_needsSequence(Expression_node** expressions, int count) {
+    char sideEffects = 0;
+    int nonConstants = 0;
+    for ( int i = 0 ; i < count ; i++ ) {
+        sideEffects = sideEffects || Expression_hasSideEffects(expressions[i]);
+        nonConstants += !Expression_isConstant(expressions[i]);
+    }
+    return sideEffects && nonConstants > 1;
+}
+
+// Joins the code of two operands as `prefix left infix right suffix`. C leaves the order in which operands are
+// evaluated unspecified, so when either operand has side effects that the other one could observe, the left one is
+// evaluated first into a temporary of the given C type. Frees `left` and `right`.
+static char* combineOperands(BinaryExpression_node* binaryExpression, char* type, char* left, char* right, char* prefix, char* infix, char* suffix) {
+    Expression_node* operands[] = { binaryExpression->left, binaryExpression->right };
+    char sequence = Expression_needsSequence(operands, 2);
+    char* code = new_string("");
+    if ( sequence ) {
+        code = concat(code, "({ ");
+        code = concat(code, type);
+        code = concat(code, " left = ");
+        code = concat(code, left);
+        code = concat(code, "; ");
+    }
+    code = concat(code, prefix);
+    code = concat(code, sequence ? "left" : left);
+    code = concat(code, infix);
+    code = concat(code, right);
+    code = concat(code, suffix);
+    if ( sequence ) {
+        code = concat(code, "; })");
+    }
+    free(left);
+    free(right);
+    return code;
+}
+
+static char* Expression_toNumberCode(Expression_node*);
+static char* Expression_toBooleanCode(Expression_node*);
+
+// Compiles a binary expression for which Expression_isNumber() holds into a C `double` expression.
+static char* BinaryExpression_toNumberCode(BinaryExpression_node* binaryExpression) {
+    char* left = Expression_toNumberCode(binaryExpression->left);
+    char* right = Expression_toNumberCode(binaryExpression->right);
+    switch (binaryExpression->binaryOperator) {
+        case ASTERISK_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(", " * ", ")");
+        case SLASH_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(", " / ", ")");
+        case PERCENT_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "fmod(", ", ", ")");
+        case PLUS_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(", " + ", ")");
+        case MINUS_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(", " - ", ")");
+        case LEFT_SHIFT_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(double) (int32_t) (native_toUint32(", ") << (native_toUint32(", ") & 0x1F))");
+        case RIGHT_SHIFT_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(double) (native_toInt32(", ") >> (native_toUint32(", ") & 0x1F))");
+        case UNSIGNED_RIGHT_SHIFT_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(double) (native_toUint32(", ") >> (native_toUint32(", ") & 0x1F))");
+        case AMPERSAND_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(double) (native_toInt32(", ") & native_toInt32(", "))");
+        case CARET_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(double) (native_toInt32(", ") ^ native_toInt32(", "))");
+        case PIPE_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "double", left, right, "(double) (native_toInt32(", ") | native_toInt32(", "))");
+        default:
+            free(left);
+            free(right);
+            return new_string("(/* Unsupported Number Expression */ 0)");
+    }
+}
+
+static char* Expression_toNumberCode(Expression_node* expression) {
+    if ( expression->type == LITERAL_EXPRESSION_TYPE && expression->expressionUnion.literal->type == NUMBER_LITERAL_TYPE ) {
+        char* code = (char*) calloc(30, sizeof(char));
+        sprintf(code, "%.18e", expression->expressionUnion.literal->literalUnion.numberLiteral->number);
+        return code;
+    }
+    if ( expression->type == BINARY_EXPRESSION_TYPE && Expression_isNumber(expression) ) {
+        return BinaryExpression_toNumberCode(expression->expressionUnion.binaryExpression);
+    }
+    if ( expression->type == UNARY_EXPRESSION_TYPE && Expression_isNumber(expression) ) {
+        UnaryExpression_node* unaryExpression = expression->expressionUnion.unaryExpression;
+        char* operand = Expression_toNumberCode(unaryExpression->expression);
+        char* code;
+        switch (unaryExpression->unaryOperator) {
+            case MINUS_UNARY_OPERATOR:
+                code = new_string("(-");
+                code = concat(code, operand);
+                code = concat(code, ")");
+                break;
+            case TILDE_UNARY_OPERATOR:
+                code = new_string("(double) (~native_toInt32(");
+                code = concat(code, operand);
+                code = concat(code, "))");
+                break;
+            default:
+                code = new_string(operand);
+                break;
+        }
+        free(operand);
+        return code;
+    }
+    char* code = new_string("native_toNumber(");
+    char* tmp = expression->toCode(expression);
+    code = concat(code, tmp);
+    free(tmp);
+    code = concat(code, ")");
+    return code;
+}
+
+// Compiles a comparison into a C `bool` expression, on unboxed doubles when both operands are numbers.
+static char* BinaryExpression_toComparisonCode(BinaryExpression_node* binaryExpression) {
+    char numbers = Expression_isNumber(binaryExpression->left) && Expression_isNumber(binaryExpression->right);
+    char* type = numbers ? "double" : "Variable";
+    char* left;
+    char* right;
+    if ( numbers ) {
+        left = Expression_toNumberCode(binaryExpression->left);
+        right = Expression_toNumberCode(binaryExpression->right);
+    } else {
+        left = binaryExpression->left->toCode(binaryExpression->left);
+        right = binaryExpression->right->toCode(binaryExpression->right);
+    }
+    switch (binaryExpression->binaryOperator) {
+        case LESS_THAN_BINARY_OPERATOR:
+            return numbers ? combineOperands(binaryExpression, type, left, right, "(", " < ", ")")
+                           : combineOperands(binaryExpression, type, left, right, "native_lessThan(", ", ", ")");
+        case GREATER_THAN_BINARY_OPERATOR:
+            return numbers ? combineOperands(binaryExpression, type, left, right, "(", " > ", ")")
+                           : combineOperands(binaryExpression, type, left, right, "native_greaterThan(", ", ", ")");
+        case LESS_THAN_EQUALS_BINARY_OPERATOR:
+            return numbers ? combineOperands(binaryExpression, type, left, right, "(", " <= ", ")")
+                           : combineOperands(binaryExpression, type, left, right, "native_lessThanOrEqual(", ", ", ")");
+        case GREATER_THAN_EQUALS_BINARY_OPERATOR:
+            return numbers ? combineOperands(binaryExpression, type, left, right, "(", " >= ", ")")
+                           : combineOperands(binaryExpression, type, left, right, "native_greaterThanOrEqual(", ", ", ")");
+        case EQUALS_EQUALS_BINARY_OPERATOR:
+            return numbers ? combineOperands(binaryExpression, type, left, right, "(", " == ", ")")
+                           : combineOperands(binaryExpression, type, left, right, "native_equals(", ", ", ")");
+        case EXCLAMATION_EQUALS_BINARY_OPERATOR:
+            return numbers ? combineOperands(binaryExpression, type, left, right, "(", " != ", ")")
+                           : combineOperands(binaryExpression, type, left, right, "!native_equals(", ", ", ")");
+        case EQUALS_EQUALS_EQUALS_BINARY_OPERATOR:
+            return numbers ? combineOperands(binaryExpression, type, left, right, "(", " == ", ")")
+                           : combineOperands(binaryExpression, type, left, right, "native_strictEquals(", ", ", ")");
+        case EXCLAMATION_EQUALS_EQUALS_BINARY_OPERATOR:
+            return numbers ? combineOperands(binaryExpression, type, left, right, "(", " != ", ")")
+                           : combineOperands(binaryExpression, type, left, right, "!native_strictEquals(", ", ", ")");
+        default:
+            free(left);
+            free(right);
+            return new_string("(/* Unsupported Comparison */ false)");
+    }
+}
+
+static char* Expression_toBooleanCode(Expression_node* expression) {
+    if ( expression->type == LITERAL_EXPRESSION_TYPE && expression->expressionUnion.literal->type == BOOLEAN_LITERAL_TYPE ) {
+        return new_string(expression->expressionUnion.literal->literalUnion.booleanLiteral->boolean ? "true" : "false");
+    }
+    if ( expression->type == UNARY_EXPRESSION_TYPE && expression->expressionUnion.unaryExpression->unaryOperator == EXCLAMATION_UNARY_OPERATOR ) {
+        char* code = new_string("!");
+        char* tmp = Expression_toBooleanCode(expression->expressionUnion.unaryExpression->expression);
+        code = concat(code, tmp);
+        free(tmp);
+        return code;
+    }
+    if ( expression->type == BINARY_EXPRESSION_TYPE ) {
+        BinaryExpression_node* binaryExpression = expression->expressionUnion.binaryExpression;
+        switch (binaryExpression->binaryOperator) {
+            case AMPERSAND_AMPERSAND_BINARY_OPERATOR:
+            case PIPE_PIPE_BINARY_OPERATOR: {
+                // in a boolean context the operands' truthiness is all that matters, and C's && and || short-circuit
+                char* code = new_string("(");
+                char* tmp = Expression_toBooleanCode(binaryExpression->left);
+                code = concat(code, tmp);
+                free(tmp);
+                code = concat(code, binaryExpression->binaryOperator == AMPERSAND_AMPERSAND_BINARY_OPERATOR ? " && " : " || ");
+                tmp = Expression_toBooleanCode(binaryExpression->right);
+                code = concat(code, tmp);
+                free(tmp);
+                code = concat(code, ")");
+                return code;
+            }
+            default:
+                if ( Expression_isBoolean(expression) ) {
+                    return BinaryExpression_toComparisonCode(binaryExpression);
+                }
+        }
+    }
+    char* code;
+    char* tmp;
+    if ( Expression_isNumber(expression) ) {
+        code = new_string("native_numberToBoolean(");
+        tmp = Expression_toNumberCode(expression);
+    } else {
+        code = new_string("native_toBoolean(");
+        tmp = expression->toCode(expression);
+    }
+    code = concat(code, tmp);
+    free(tmp);
+    code = concat(code, ")");
+    return code;
+}
+
+char* BinaryExpression_toString(BinaryExpression_node* binaryExpression) {
+    char* string = new_string("BinaryExpression\n");
+    char* tmp1 = new_string("Left\n");
+    char* tmp2 = binaryExpression->left->toString(binaryExpression->left);
+    tmp1 = concat_indent(tmp1, tmp2);
+    free(tmp2);
+    tmp1 = concat(tmp1, "\nBinaryOperator\n");
+    tmp1 = concat_indent(tmp1, BinaryOperator_toString(binaryExpression->binaryOperator));
+    tmp1 = concat(tmp1, "\nRight\n");
+    tmp2 = binaryExpression->right->toString(binaryExpression->right);
+    tmp1 = concat_indent(tmp1, tmp2);
+    free(tmp2);
+    string = concat_indent(string, tmp1);
+    free(tmp1);
+    return string;
+}
+
+char* BinaryExpression_toCode(BinaryExpression_node* binaryExpression) {
+    Expression_node expression;
+    expression.type = BINARY_EXPRESSION_TYPE;
+    expression.expressionUnion.binaryExpression = binaryExpression;
+    if ( Expression_isNumber(&expression) ) {
+        char* code = new_string("new_number(");
+        char* tmp = BinaryExpression_toNumberCode(binaryExpression);
+        code = concat(code, tmp);
+        free(tmp);
+        code = concat(code, ")");
+        return code;
+    }
+    if ( Expression_isBoolean(&expression) ) {
+        char* code = new_string("new_boolean(");
+        char* tmp = Expression_toBooleanCode(&expression);
+        code = concat(code, tmp);
+        free(tmp);
+        code = concat(code, ")");
+        return code;
+    }
+    char* left = binaryExpression->left->toCode(binaryExpression->left);
+    char* right = binaryExpression->right->toCode(binaryExpression->right);
+    switch (binaryExpression->binaryOperator) {
+        case PLUS_BINARY_OPERATOR:
+            return combineOperands(binaryExpression, "Variable", left, right, "native_add(", ", ", ")");
+        case AMPERSAND_AMPERSAND_BINARY_OPERATOR:
+        case PIPE_PIPE_BINARY_OPERATOR: {
+            // the right operand is only evaluated if the left one does not already decide the result
+            char* code = new_string("({ Variable left = ");
+            code = concat(code, left);
+            free(left);
+            if ( binaryExpression->binaryOperator == AMPERSAND_AMPERSAND_BINARY_OPERATOR ) {
+                code = concat(code, "; native_toBoolean(left) ? ");
+                code = concat(code, right);
+                code = concat(code, " : left; })");
+            } else {
+                code = concat(code, "; native_toBoolean(left) ? left : ");
+                code = concat(code, right);
+                code = concat(code, "; })");
+            }
+            free(right);
+            return code;
+        }
+        default:
+            free(left);
+            free(right);
+            return new_string("(/* Unsupported Binary Expression */)");
+    }
+}
+
+BinaryExpression_node* createBinaryExpression(Expression_node* left, BinaryOperator_enum binaryOperator, Expression_node* right) {
+    BinaryExpression_node* binaryExpression = (BinaryExpression_node*) calloc(1, sizeof(BinaryExpression_node));
+    binaryExpression->left = left;
+    binaryExpression->binaryOperator = binaryOperator;
+    binaryExpression->right = right;
+    binaryExpression->toString = BinaryExpression_toString;
+    binaryExpression->toCode = BinaryExpression_toCode;
+    return binaryExpression;
+}
+
+char* UnaryExpression_toString(UnaryExpression_node* unaryExpression) {
+    char* string = new_string("UnaryExpression\n");
+    char* tmp1 = new_string("UnaryOperator\n");
+    tmp1 = concat_indent(tmp1, UnaryOperator_toString(unaryExpression->unaryOperator));
+    tmp1 = concat(tmp1, "\nExpression\n");
+    char* tmp2 = unaryExpression->expression->toString(unaryExpression->expression);
+    tmp1 = concat_indent(tmp1, tmp2);
+    free(tmp2);
+    string = concat_indent(string, tmp1);
+    free(tmp1);
+    return string;
+}
+
+char* UnaryExpression_toCode(UnaryExpression_node* unaryExpression) {
+    Expression_node expression;
+    expression.type = UNARY_EXPRESSION_TYPE;
+    expression.expressionUnion.unaryExpression = unaryExpression;
+    char* code;
+    char* tmp;
+    if ( unaryExpression->unaryOperator == EXCLAMATION_UNARY_OPERATOR ) {
+        code = new_string("new_boolean(");
+        tmp = Expression_toBooleanCode(&expression);
+    } else {
+        code = new_string("new_number(");
+        tmp = Expression_toNumberCode(&expression);
+    }
+    code = concat(code, tmp);
+    free(tmp);
+    code = concat(code, ")");
+    return code;
+}
+
+UnaryExpression_node* createUnaryExpression(UnaryOperator_enum unaryOperator, Expression_node* expression) {
+    UnaryExpression_node* unaryExpression = (UnaryExpression_node*) calloc(1, sizeof(UnaryExpression_node));
+    unaryExpression->unaryOperator = unaryOperator;
+    unaryExpression->expression = expression;
+    unaryExpression->toString = UnaryExpression_toString;
+    unaryExpression->toCode = UnaryExpression_toCode;
+    return unaryExpression;
+}
+
+char* IterationStatement_toString(IterationStatement_node* iterationStatement) {
+    char* string = new_string("IterationStatement\n");
+    char* tmp1;
+    switch (iterationStatement->type) {
+        case DO_WHILE_ITERATION_STATEMENT_TYPE:
+            tmp1 = new_string("do while");
+            break;
+        case WHILE_ITERATION_STATEMENT_TYPE:
+            tmp1 = new_string("while");
+            break;
+        case FOR_ITERATION_STATEMENT_TYPE:
+            tmp1 = new_string("for");
+            break;
+    }
+    char* tmp2;
+    if ( iterationStatement->initialVariableDeclarationList != NULL ) {
+        tmp1 = concat(tmp1, "\nInitialization\n");
+        tmp2 = iterationStatement->initialVariableDeclarationList->toString(iterationStatement->initialVariableDeclarationList);
+        tmp1 = concat_indent(tmp1, tmp2);
+        free(tmp2);
+    }
+    if ( iterationStatement->initialExpression != NULL ) {
+        tmp1 = concat(tmp1, "\nInitialization\n");
+        tmp2 = iterationStatement->initialExpression->toString(iterationStatement->initialExpression);
+        tmp1 = concat_indent(tmp1, tmp2);
+        free(tmp2);
+    }
+    if ( iterationStatement->condition != NULL ) {
+        tmp1 = concat(tmp1, "\nCondition\n");
+        tmp2 = iterationStatement->condition->toString(iterationStatement->condition);
+        tmp1 = concat_indent(tmp1, tmp2);
+        free(tmp2);
+    }
+    if ( iterationStatement->update != NULL ) {
+        tmp1 = concat(tmp1, "\nUpdate\n");
+        tmp2 = iterationStatement->update->toString(iterationStatement->update);
+        tmp1 = concat_indent(tmp1, tmp2);
+        free(tmp2);
+    }
+    tmp1 = concat(tmp1, "\nStatement\n");
+    tmp2 = iterationStatement->statement->toString(iterationStatement->statement);
+    tmp1 = concat_indent(tmp1, tmp2);
+    free(tmp2);
+    string = concat_indent(string, tmp1);
+    free(tmp1);
+    return string;
+}
+
+// A loop body that declares variables gets one scope, allocated before the loop, that the condition, the update and
+// every iteration run in, instead of a new scope per iteration. Declaring a variable again keeps its value, so a `var`
+// of the body keeps it from one iteration to the next, as in JS, though like any `var` in a block it is not seen after
+// the block. A body that declares nothing runs in the enclosing scope.
+char* IterationStatement_toCode(IterationStatement_node* iterationStatement) {
+    char* code = new_string("{\n");
+    char* tmp1 = new_string("");
+    char* tmp2;
+    if ( iterationStatement->initialVariableDeclarationList != NULL ) {
+        tmp2 = iterationStatement->initialVariableDeclarationList->toCode(iterationStatement->initialVariableDeclarationList);
+        tmp1 = concat(tmp1, tmp2);
+        free(tmp2);
+        tmp1 = concat(tmp1, "\n");
+    }
+    if ( iterationStatement->initialExpression != NULL ) {
+        tmp2 = iterationStatement->initialExpression->toCode(iterationStatement->initialExpression);
+        tmp1 = concat(tmp1, tmp2);
+        free(tmp2);
+        tmp1 = concat(tmp1, ";\n");
+    }
+
+    Statement_node* statement = iterationStatement->statement;
+    char reuseScope = statement->type == BLOCK_STATEMENT_TYPE && Block_declaresIntoScope(statement->statementUnion.block);
+
+    Loop loop = { iterationStatement, 0, NULL, NULL, NULL, currentLoop };
+    currentLoop = &loop;
+    char outerGlobalScopeCode = globalScopeCode;
+    if ( reuseScope ) {
+        globalScopeCode = 0;
+    }
+    char* condition = iterationStatement->condition == NULL ? new_string("") : Expression_toBooleanCode(iterationStatement->condition);
+    char* body = new_string("{\n");
+    if ( statement->type == BLOCK_STATEMENT_TYPE ) {
+        StatementList_node* statementList = statement->statementUnion.block->statementList;
+        tmp2 = new_string("gc_safepoint(scope, frame);\n");
+        if ( statementList->count == 0 ) {
+            tmp2 = concat_comment(tmp2, "empty block");
+        }
+        char* tmp3 = statementList->toCode(statementList);
+        tmp2 = concat(tmp2, tmp3);
+        free(tmp3);
+    } else {
+        tmp2 = new_string("gc_safepoint(scope, frame);\n");
+        char* tmp3 = statement->toCode(statement);
+        tmp2 = concat(tmp2, tmp3);
+        free(tmp3);
+    }
+    body = concat_indent(body, tmp2);
+    free(tmp2);
+    body = concat(body, "\n}");
+    char* update = iterationStatement->update == NULL ? new_string("") : iterationStatement->update->toCode(iterationStatement->update);
+    globalScopeCode = outerGlobalScopeCode;
+    currentLoop = loop.outer;
+
+    // the hoisted expressions are evaluated once, as part of whatever encloses the loop
+    for ( int i = 0 ; i < loop.count ; i++ ) {
+        tmp1 = concat(tmp1, "Variable ");
+        tmp1 = concat(tmp1, loop.locals[i]);
+        tmp1 = concat(tmp1, " = ");
+        tmp2 = loop.expressions[i]->toCode(loop.expressions[i]);
+        tmp1 = concat(tmp1, tmp2);
+        free(tmp2);
+        tmp1 = concat(tmp1, ";\n");
+        free(loop.keys[i]);
+        free(loop.locals[i]);
+    }
+    free(loop.keys);
+    free(loop.expressions);
+    free(loop.locals);
+    // the loop runs in a block of its own where `scope` is the scope of the loop
+    char* outer = tmp1;
+    tmp1 = new_string(reuseScope ? "Scope* scope = loopScope;\n" : "");
+    // whatever the loop keeps in C locals is on the shadow stack below this frame
+    tmp1 = concat(tmp1, "size_t frame = gc_frame();\n");
+
+    switch (iterationStatement->type) {
+        case DO_WHILE_ITERATION_STATEMENT_TYPE:
+            tmp1 = concat(tmp1, "do ");
+            tmp1 = concat(tmp1, body);
+            tmp1 = concat(tmp1, " while ( ");
+            tmp1 = concat(tmp1, condition);
+            tmp1 = concat(tmp1, " );");
+            break;
+        case WHILE_ITERATION_STATEMENT_TYPE:
+            tmp1 = concat(tmp1, "while ( ");
+            tmp1 = concat(tmp1, condition);
+            tmp1 = concat(tmp1, " ) ");
+            tmp1 = concat(tmp1, body);
+            break;
+        case FOR_ITERATION_STATEMENT_TYPE:
+            tmp1 = concat(tmp1, "for ( ; ");
+            tmp1 = concat(tmp1, condition);
+            tmp1 = concat(tmp1, " ; ");
+            tmp1 = concat(tmp1, update);
+            tmp1 = concat(tmp1, " ) ");
+            tmp1 = concat(tmp1, body);
+            break;
+    }
+    free(condition);
+    free(body);
+    free(update);
+    if ( reuseScope ) {
+        outer = concat(outer, "Scope* loopScope = new_Scope(scope);\n{\n");
+        outer = concat_indent(outer, tmp1);
+        outer = concat(outer, "\n}");
+    } else {
+        outer = concat(outer, tmp1);
+    }
+    free(tmp1);
+    code = concat_indent(code, outer);
+    free(outer);
+    code = concat(code, "\n}");
+    return code;
+}
+
+IterationStatement_node* createIterationStatement(IterationStatementType_enum type, VariableDeclarationList_node* initialVariableDeclarationList, Expression_node* initialExpression, Expression_node* condition, Expression_node* update, Statement_node* statement) {
+    IterationStatement_node* iterationStatement = (IterationStatement_node*) calloc(1, sizeof(IterationStatement_node));
+    iterationStatement->type = type;
+    iterationStatement->initialVariableDeclarationList = initialVariableDeclarationList;
+    iterationStatement->initialExpression = initialExpression;
+    iterationStatement->condition = condition;
+    iterationStatement->update = update;
+    iterationStatement->statement = statement;
+    iterationStatement->toString = IterationStatement_toString;
+    iterationStatement->toCode = IterationStatement_toCode;
+    return iterationStatement;
+}
+
+char* PropertyAssignment_toString(PropertyAssignment_node* propertyAssignment) {
+    char* string = new_string("PropertyAssignment\n");
+    char* tmp1 = propertyAssignment->propertyName->toString(propertyAssignment->propertyName);
+    tmp1 = concat(tmp1, "\n");
+    char* tmp2 = propertyAssignment->expression->toString(propertyAssignment->expression);
+    tmp1 = concat(tmp1, tmp2);
+    free(tmp2);
+    string = concat_indent(string, tmp1);
+    free(tmp1);
+    return string;
+}
+
+PropertyAssignment_node* createPropertyAssignment(Literal_node* propertyName, Expression_node* expression) {
+    PropertyAssignment_node* propertyAssignment = (PropertyAssignment_node*) calloc(1, sizeof(PropertyAssignment_node));
+    propertyAssignment->propertyName = propertyName;
+    propertyAssignment->expression = expression;
+    propertyAssignment->toString = PropertyAssignment_toString;
+    return propertyAssignment;
+}
+
+void ObjectLiteral_append(ObjectLiteral_node* objectLiteral, PropertyAssignment_node* propertyAssignment) {
+    objectLiteral->propertyAssignments = (PropertyAssignment_node**) realloc(objectLiteral->propertyAssignments, ( objectLiteral->count + 1 ) * sizeof(PropertyAssignment_node*) );
+    objectLiteral->propertyAssignments[objectLiteral->count] = propertyAssignment;
+    objectLiteral->count += 1;
+}
+
+char* ObjectLiteral_toString(ObjectLiteral_node* objectLiteral) {
+    char* string = new_string("ObjectLiteral");
+    if ( objectLiteral->count == 0 ) {
+        string = concat(string, " (empty)");
+        return string;
+    }
+    for ( int i = 0 ; i < objectLiteral->count ; i++ ) {
+        string = concat(string, "\n");
+        char* tmp = objectLiteral->propertyAssignments[i]->toString(objectLiteral->propertyAssignments[i]);
+        string = concat_indent(string, tmp);
+        free(tmp);
+    }
+    return string;
+}
+
+// Whether every key is a distinct string, so the object can be created in one go by new_object().
+static char ObjectLiteral_hasStaticKeys(ObjectLiteral_node* objectLiteral) {
+    for ( int i = 0 ; i < objectLiteral->count ; i++ ) {
+        Literal_node* propertyName = objectLiteral->propertyAssignments[i]->propertyName;
+        if ( propertyName->type != STRING_LITERAL_TYPE ) return 0;
+        for ( int j = 0 ; j < i ; j++ ) {
+            Literal_node* otherPropertyName = objectLiteral->propertyAssignments[j]->propertyName;
+            if ( strcmp(propertyName->literalUnion.stringLiteral->string, otherPropertyName->literalUnion.stringLiteral->string) == 0 ) return 0;
+        }
+    }
+    return 1;
+}
+
+// With static keys the object is created by a single new_object() call, which gets the keys as atoms and the values in
+// order. Otherwise, for number keys and keys given more than once, the properties are set one by one.
+char* ObjectLiteral_toCode(ObjectLiteral_node* objectLiteral) {
+    char* code;
+    char* tmp;
+    if ( objectLiteral->count == 0 ) {
+        return new_string("new_object(0, NULL, NULL)");
+    }
+    if ( !ObjectLiteral_hasStaticKeys(objectLiteral) ) {
+        code = new_string("({ Variable object = new_object(0, NULL, NULL); ");
+        for ( int i = 0 ; i < objectLiteral->count ; i++ ) {
+            PropertyAssignment_node* propertyAssignment = objectLiteral->propertyAssignments[i];
+            code = concat(code, "native_toObject(object)->setProperty(native_toObject(object), ");
+            if ( propertyAssignment->propertyName->type == STRING_LITERAL_TYPE ) {
+                char* tmp2 = propertyAssignment->propertyName->literalUnion.stringLiteral->toString(propertyAssignment->propertyName->literalUnion.stringLiteral);
+                tmp = Atom_toCode(tmp2);
+                free(tmp2);
+            } else {
+                tmp = new_string("native_toPropertyKey(");
+                char* tmp2 = propertyAssignment->propertyName->toCode(propertyAssignment->propertyName);
+                tmp = concat(tmp, tmp2);
+                free(tmp2);
+                tmp = concat(tmp, ")");
+            }
+            code = concat(code, tmp);
+            free(tmp);
+            code = concat(code, ", ");
+            tmp = propertyAssignment->expression->toCode(propertyAssignment->expression);
+            code = concat(code, tmp);
+            free(tmp);
+            code = concat(code, "); ");
+        }
+        code = concat(code, "object; })");
+        return code;
+    }
+
+    // C does not define the order in which the values of an array initializer are evaluated
+    Expression_node** expressions = (Expression_node**) malloc(objectLiteral->count * sizeof(Expression_node*));
+    for ( int i = 0 ; i < objectLiteral->count ; i++ ) {
+        expressions[i] = objectLiteral->propertyAssignments[i]->expression;
+    }
+    char sequence = Expression_needsSequence(expressions, objectLiteral->count);
+    free(expressions);
+    char* keys = new_string("");
+    char* values = new_string("");
+    code = new_string(sequence ? "({ " : "");
+    for ( int i = 0 ; i < objectLiteral->count ; i++ ) {
+        PropertyAssignment_node* propertyAssignment = objectLiteral->propertyAssignments[i];
+        if ( i > 0 ) {
+            keys = concat(keys, ", ");
+            values = concat(values, ", ");
+        }
+        char* literal = propertyAssignment->propertyName->literalUnion.stringLiteral->toString(propertyAssignment->propertyName->literalUnion.stringLiteral);
+        tmp = Atom_toCode(literal);
+        free(literal);
+        keys = concat(keys, tmp);
+        free(tmp);
+        tmp = propertyAssignment->expression->toCode(propertyAssignment->expression);
+        if ( sequence ) {
+            char* local = (char*) calloc(30, sizeof(char));
+            sprintf(local, "property_%i", i);
+            code = concat(code, "Variable ");
+            code = concat(code, local);
+            code = concat(code, " = ");
+            code = concat(code, tmp);
+            code = concat(code, "; ");
+            values = concat(values, local);
+            free(local);
+        } else {
+            values = concat(values, tmp);
+        }
+        free(tmp);
+    }
+    code = concat(code, "new_object(");
+    tmp = (char*) calloc(20, sizeof(char));
+    sprintf(tmp, "%i", objectLiteral->count);
+    code = concat(code, tmp);
+    free(tmp);
+    code = concat(code, ", (char*[]){ ");
+    code = concat(code, keys);
+    code = concat(code, " }, (Variable[]){ ");
+    code = concat(code, values);
+    code = concat(code, " })");
+    free(keys);
+    free(values);
+    if ( sequence ) {
+        code = concat(code, "; })");
+    }
+    return code;
+}
+
+ObjectLiteral_node* createObjectLiteral() {
+    ObjectLiteral_node* objectLiteral = (ObjectLiteral_node*) calloc(1, sizeof(ObjectLiteral_node));
+    objectLiteral->count = 0;
+    objectLiteral->propertyAssignments = NULL;
+    objectLiteral->append = ObjectLiteral_append;
+    objectLiteral->toString = ObjectLiteral_toString;
+    objectLiteral->toCode = ObjectLiteral_toCode;
+    return objectLiteral;
+}
+
+void ArrayLiteral_append(ArrayLiteral_node* arrayLiteral, Expression_node* element) {
+    arrayLiteral->elements = (Expression_node**) realloc(arrayLiteral->elements, ( arrayLiteral->count + 1 ) * sizeof(Expression_node*) );
+    arrayLiteral->elements[arrayLiteral->count] = element;
+    arrayLiteral->count += 1;
+}
+
+char* ArrayLiteral_toString(ArrayLiteral_node* arrayLiteral) {
+    char* string = new_string("ArrayLiteral");
+    if ( arrayLiteral->count == 0 ) {
+        string = concat(string, " (empty)");
+        return string;
+    }
+    for ( int i = 0 ; i < arrayLiteral->count ; i++ ) {
+        string = concat(string, "\n");
+        char* tmp = arrayLiteral->elements[i]->toString(arrayLiteral->elements[i]);
+        string = concat_indent(string, tmp);
+        free(tmp);
+    }
+    return string;
+}
+
+// An array is created by a single new_array() call, which copies the values into its dense elements. Like for object
+// literals, values are evaluated into locals first when their order could matter.
+char* ArrayLiteral_toCode(ArrayLiteral_node* arrayLiteral) {
+    if ( arrayLiteral->count == 0 ) {
+        return new_string("new_array(0, NULL)");
+    }
+    char sequence = Expression_needsSequence(arrayLiteral->elements, arrayLiteral->count);
+    char* values = new_string("");
+    char* code = new_string(sequence ? "({ " : "");
+    for ( int i = 0 ; i < arrayLiteral->count ; i++ ) {
+        if ( i > 0 ) {
+            values = concat(values, ", ");
+        }
+        char* tmp = arrayLiteral->elements[i]->toCode(arrayLiteral->elements[i]);
+        if ( sequence ) {
+            char* local = (char*) calloc(30, sizeof(char));
+            sprintf(local, "element_%i", i);
+            code = concat(code, "Variable ");
+            code = concat(code, local);
+            code = concat(code, " = ");
+            code = concat(code, tmp);
+            code = concat(code, "; ");
+            values = concat(values, local);
+            free(local);
+        } else {
+            values = concat(values, tmp);
+        }
+        free(tmp);
+    }
+    code = concat(code, "new_array(");
+    char* tmp = (char*) calloc(20, sizeof(char));
+    sprintf(tmp, "%i", arrayLiteral->count);
+    code = concat(code, tmp);
+    free(tmp);
+    code = concat(code, ", (Variable[]){ ");
+    code = concat(code, values);
+    code = concat(code, " })");
+    free(values);
+    if ( sequence ) {
+        code = concat(code, "; })");
+    }
+    return code;
+}
+
+ArrayLiteral_node* createArrayLiteral() {
+    ArrayLiteral_node* arrayLiteral = (ArrayLiteral_node*) calloc(1, sizeof(ArrayLiteral_node));
+    arrayLiteral->count = 0;
+    arrayLiteral->elements = NULL;
+    arrayLiteral->append = ArrayLiteral_append;
+    arrayLiteral->toString = ArrayLiteral_toString;
+    arrayLiteral->toCode = ArrayLiteral_toCode;
+    return arrayLiteral;
+}
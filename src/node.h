@@ -8,6 +8,9 @@ typedef enum   MemberExpressionType_enum      MemberExpressionType_enum;
 typedef enum   LeftHandSideExpressionType_enum   LeftHandSideExpressionType_enum;
 typedef enum   AssignmentOperator_enum        AssignmentOperator_enum;
 typedef enum   LiteralType_enum               LiteralType_enum;
+typedef enum   BinaryOperator_enum            BinaryOperator_enum;
+typedef enum   UnaryOperator_enum             UnaryOperator_enum;
+typedef enum   IterationStatementType_enum    IterationStatementType_enum;
 
 typedef union  Statement_union                Statement_union;
 typedef union  SourceElement_union            SourceElement_union;
@@ -43,6 +46,12 @@ typedef struct NullLiteral_node               NullLiteral_node;
 typedef struct BooleanLiteral_node            BooleanLiteral_node;
 typedef struct NumberLiteral_node             NumberLiteral_node;
 typedef struct StringLiteral_node             StringLiteral_node;
+typedef struct BinaryExpression_node          BinaryExpression_node;
+typedef struct UnaryExpression_node           UnaryExpression_node;
+typedef struct IterationStatement_node        IterationStatement_node;
+typedef struct ObjectLiteral_node             ObjectLiteral_node;
+typedef struct PropertyAssignment_node        PropertyAssignment_node;
+typedef struct ArrayLiteral_node              ArrayLiteral_node;
 
 Identifier_node*              createIdentifier(char*);
 StatementList_node*           createStatementList();
@@ -71,13 +80,24 @@ NullLiteral_node*             createNullLiteral();
 BooleanLiteral_node*          createBooleanLiteral(char);
 NumberLiteral_node*           createNumberLiteral(double);
 StringLiteral_node*           createStringLiteral(char*);
+BinaryExpression_node*        createBinaryExpression(Expression_node*, BinaryOperator_enum, Expression_node*);
+UnaryExpression_node*         createUnaryExpression(UnaryOperator_enum, Expression_node*);
+ObjectLiteral_node*           createObjectLiteral();
+PropertyAssignment_node*      createPropertyAssignment(Literal_node*, Expression_node*);
+ArrayLiteral_node*            createArrayLiteral();
+IterationStatement_node*      createIterationStatement(IterationStatementType_enum, VariableDeclarationList_node*, Expression_node*, Expression_node*, Expression_node*, Statement_node*);
+
+char Block_declaresIntoScope(Block_node*);
+char* Program_toModuleCode(Program_node*, char*);
+char* Module_symbol(char*, char*);
 
 enum StatementType_enum {
     BLOCK_STATEMENT_TYPE,
     VARIABLE_STATEMENT_TYPE,
     EMPTY_STATEMENT_TYPE,
     EXPRESSION_STATEMENT_TYPE,
-    RETURN_STATEMENT_TYPE
+    RETURN_STATEMENT_TYPE,
+    ITERATION_STATEMENT_TYPE
 };
 
 enum SourceElementType_enum {
@@ -91,7 +111,11 @@ enum ExpressionType_enum {
     ASSIGNMENT_EXPRESSION_TYPE,
     LITERAL_EXPRESSION_TYPE,
     MEMBER_EXPRESSION_TYPE,
-    CALL_EXPRESSION_TYPE
+    CALL_EXPRESSION_TYPE,
+    BINARY_EXPRESSION_TYPE,
+    UNARY_EXPRESSION_TYPE,
+    OBJECT_LITERAL_EXPRESSION_TYPE,
+    ARRAY_LITERAL_EXPRESSION_TYPE
 };
 
 enum MemberExpressionType_enum {
@@ -108,6 +132,43 @@ enum AssignmentOperator_enum {
     EQUALS_ASSIGNMENT_OPERATOR
 };
 
+enum BinaryOperator_enum {
+    ASTERISK_BINARY_OPERATOR,
+    SLASH_BINARY_OPERATOR,
+    PERCENT_BINARY_OPERATOR,
+    PLUS_BINARY_OPERATOR,
+    MINUS_BINARY_OPERATOR,
+    LEFT_SHIFT_BINARY_OPERATOR,
+    RIGHT_SHIFT_BINARY_OPERATOR,
+    UNSIGNED_RIGHT_SHIFT_BINARY_OPERATOR,
+    LESS_THAN_BINARY_OPERATOR,
+    GREATER_THAN_BINARY_OPERATOR,
+    LESS_THAN_EQUALS_BINARY_OPERATOR,
+    GREATER_THAN_EQUALS_BINARY_OPERATOR,
+    EQUALS_EQUALS_BINARY_OPERATOR,
+    EXCLAMATION_EQUALS_BINARY_OPERATOR,
+    EQUALS_EQUALS_EQUALS_BINARY_OPERATOR,
+    EXCLAMATION_EQUALS_EQUALS_BINARY_OPERATOR,
+    AMPERSAND_BINARY_OPERATOR,
+    CARET_BINARY_OPERATOR,
+    PIPE_BINARY_OPERATOR,
+    AMPERSAND_AMPERSAND_BINARY_OPERATOR,
+    PIPE_PIPE_BINARY_OPERATOR
+};
+
+enum UnaryOperator_enum {
+    PLUS_UNARY_OPERATOR,
+    MINUS_UNARY_OPERATOR,
+    TILDE_UNARY_OPERATOR,
+    EXCLAMATION_UNARY_OPERATOR
+};
+
+enum IterationStatementType_enum {
+    DO_WHILE_ITERATION_STATEMENT_TYPE,
+    WHILE_ITERATION_STATEMENT_TYPE,
+    FOR_ITERATION_STATEMENT_TYPE
+};
+
 enum LiteralType_enum {
     NULL_LITERAL_TYPE,
     BOOLEAN_LITERAL_TYPE,
@@ -122,6 +183,7 @@ union Statement_union {
     EmptyStatement_node* emptyStatement;
     ExpressionStatement_node* expressionStatement;
     ReturnStatement_node* returnStatement;
+    IterationStatement_node* iterationStatement;
 };
 
 union SourceElement_union {
@@ -137,6 +199,10 @@ union Expression_union {
     MemberExpression_node* memberExpression;
     AssignmentExpression_node* assignmentExpression;
     CallExpression_node* callExpression;
+    BinaryExpression_node* binaryExpression;
+    UnaryExpression_node* unaryExpression;
+    ObjectLiteral_node* objectLiteral;
+    ArrayLiteral_node* arrayLiteral;
 };
 
 union MemberExpression_union {
@@ -161,6 +227,7 @@ union Literal_union {
 
 struct Identifier_node {
     char* name;
+    int line;
     char* (*toString)(Identifier_node*);
 };
 
@@ -196,6 +263,7 @@ struct FunctionDeclaration_node {
     Identifier_node* identifier;
     FormalParameterList_node* formalParameterList;
     Block_node* block;
+    char referencesArguments; // whether the body may refer to `arguments`, which is then materialized on every call
     char* (*toString)(FunctionDeclaration_node*);
     char* (*toCode)(FunctionDeclaration_node*);
 };
@@ -268,6 +336,7 @@ struct MemberExpression_node {
     Expression_node* parent;
     MemberExpressionType_enum type;
     MemberExpression_union child;
+    int line;
     char* (*toString)(MemberExpression_node*);
     char* (*toCode)(MemberExpression_node*);
 };
@@ -337,4 +406,52 @@ struct StringLiteral_node {
     char* (*toCode)(StringLiteral_node*);
 };
 
-#endif
\ No newline at end of file
+struct BinaryExpression_node {
+    Expression_node* left;
+    BinaryOperator_enum binaryOperator;
+    Expression_node* right;
+    char* (*toString)(BinaryExpression_node*);
+    char* (*toCode)(BinaryExpression_node*);
+};
+
+struct UnaryExpression_node {
+    UnaryOperator_enum unaryOperator;
+    Expression_node* expression;
+    char* (*toString)(UnaryExpression_node*);
+    char* (*toCode)(UnaryExpression_node*);
+};
+
+struct ObjectLiteral_node {
+    int count;
+    PropertyAssignment_node** propertyAssignments;
+    void (*append)(ObjectLiteral_node*, PropertyAssignment_node*);
+    char* (*toString)(ObjectLiteral_node*);
+    char* (*toCode)(ObjectLiteral_node*);
+};
+
+struct PropertyAssignment_node {
+    Literal_node* propertyName;
+    Expression_node* expression;
+    char* (*toString)(PropertyAssignment_node*);
+};
+
+struct ArrayLiteral_node {
+    int count;
+    Expression_node** elements;
+    void (*append)(ArrayLiteral_node*, Expression_node*);
+    char* (*toString)(ArrayLiteral_node*);
+    char* (*toCode)(ArrayLiteral_node*);
+};
+
+struct IterationStatement_node {
+    IterationStatementType_enum type;
+    VariableDeclarationList_node* initialVariableDeclarationList;
+    Expression_node* initialExpression;
+    Expression_node* condition;
+    Expression_node* update;
+    Statement_node* statement;
+    char* (*toString)(IterationStatement_node*);
+    char* (*toCode)(IterationStatement_node*);
+};
+
+#endif
@@ -0,0 +1,268 @@
+#include "number.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Grisu2, after Florian Loitsch, "Printing Floating-Point Numbers Quickly and Accurately with Integers" (PLDI 2010).
+ * The digits it finds always read back as the same double, and are the shortest and closest ones unless there are 16 or
+ * 17 of them, which shorten() checks.
+ */
+
+typedef struct Fp Fp;
+
+// f * 2^e
+struct Fp {
+    uint64_t f;
+    int e;
+};
+
+#define HIDDEN_BIT 0x0010000000000000ULL
+
+static const uint64_t powersOfTen[] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL, 1000000000ULL,
+    10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL, 100000000000000ULL, 1000000000000000ULL,
+    10000000000000000ULL, 100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+// 10^-348, 10^-340, ..., 10^340, normalized.
+static const Fp cachedPowers[] = {
+    { 0xFA8FD5A0081C0288ULL, -1220 }, { 0xBAAEE17FA23EBF76ULL, -1193 }, { 0x8B16FB203055AC76ULL, -1166 },
+    { 0xCF42894A5DCE35EAULL, -1140 }, { 0x9A6BB0AA55653B2DULL, -1113 }, { 0xE61ACF033D1A45DFULL, -1087 },
+    { 0xAB70FE17C79AC6CAULL, -1060 }, { 0xFF77B1FCBEBCDC4FULL, -1034 }, { 0xBE5691EF416BD60CULL, -1007 },
+    { 0x8DD01FAD907FFC3CULL, -980 }, { 0xD3515C2831559A83ULL, -954 }, { 0x9D71AC8FADA6C9B5ULL, -927 },
+    { 0xEA9C227723EE8BCBULL, -901 }, { 0xAECC49914078536DULL, -874 }, { 0x823C12795DB6CE57ULL, -847 },
+    { 0xC21094364DFB5637ULL, -821 }, { 0x9096EA6F3848984FULL, -794 }, { 0xD77485CB25823AC7ULL, -768 },
+    { 0xA086CFCD97BF97F4ULL, -741 }, { 0xEF340A98172AACE5ULL, -715 }, { 0xB23867FB2A35B28EULL, -688 },
+    { 0x84C8D4DFD2C63F3BULL, -661 }, { 0xC5DD44271AD3CDBAULL, -635 }, { 0x936B9FCEBB25C996ULL, -608 },
+    { 0xDBAC6C247D62A584ULL, -582 }, { 0xA3AB66580D5FDAF6ULL, -555 }, { 0xF3E2F893DEC3F126ULL, -529 },
+    { 0xB5B5ADA8AAFF80B8ULL, -502 }, { 0x87625F056C7C4A8BULL, -475 }, { 0xC9BCFF6034C13053ULL, -449 },
+    { 0x964E858C91BA2655ULL, -422 }, { 0xDFF9772470297EBDULL, -396 }, { 0xA6DFBD9FB8E5B88FULL, -369 },
+    { 0xF8A95FCF88747D94ULL, -343 }, { 0xB94470938FA89BCFULL, -316 }, { 0x8A08F0F8BF0F156BULL, -289 },
+    { 0xCDB02555653131B6ULL, -263 }, { 0x993FE2C6D07B7FACULL, -236 }, { 0xE45C10C42A2B3B06ULL, -210 },
+    { 0xAA242499697392D3ULL, -183 }, { 0xFD87B5F28300CA0EULL, -157 }, { 0xBCE5086492111AEBULL, -130 },
+    { 0x8CBCCC096F5088CCULL, -103 }, { 0xD1B71758E219652CULL, -77 }, { 0x9C40000000000000ULL, -50 },
+    { 0xE8D4A51000000000ULL, -24 }, { 0xAD78EBC5AC620000ULL, 3 }, { 0x813F3978F8940984ULL, 30 },
+    { 0xC097CE7BC90715B3ULL, 56 }, { 0x8F7E32CE7BEA5C70ULL, 83 }, { 0xD5D238A4ABE98068ULL, 109 },
+    { 0x9F4F2726179A2245ULL, 136 }, { 0xED63A231D4C4FB27ULL, 162 }, { 0xB0DE65388CC8ADA8ULL, 189 },
+    { 0x83C7088E1AAB65DBULL, 216 }, { 0xC45D1DF942711D9AULL, 242 }, { 0x924D692CA61BE758ULL, 269 },
+    { 0xDA01EE641A708DEAULL, 295 }, { 0xA26DA3999AEF774AULL, 322 }, { 0xF209787BB47D6B85ULL, 348 },
+    { 0xB454E4A179DD1877ULL, 375 }, { 0x865B86925B9BC5C2ULL, 402 }, { 0xC83553C5C8965D3DULL, 428 },
+    { 0x952AB45CFA97A0B3ULL, 455 }, { 0xDE469FBD99A05FE3ULL, 481 }, { 0xA59BC234DB398C25ULL, 508 },
+    { 0xF6C69A72A3989F5CULL, 534 }, { 0xB7DCBF5354E9BECEULL, 561 }, { 0x88FCF317F22241E2ULL, 588 },
+    { 0xCC20CE9BD35C78A5ULL, 614 }, { 0x98165AF37B2153DFULL, 641 }, { 0xE2A0B5DC971F303AULL, 667 },
+    { 0xA8D9D1535CE3B396ULL, 694 }, { 0xFB9B7CD9A4A7443CULL, 720 }, { 0xBB764C4CA7A44410ULL, 747 },
+    { 0x8BAB8EEFB6409C1AULL, 774 }, { 0xD01FEF10A657842CULL, 800 }, { 0x9B10A4E5E9913129ULL, 827 },
+    { 0xE7109BFBA19C0C9DULL, 853 }, { 0xAC2820D9623BF429ULL, 880 }, { 0x80444B5E7AA7CF85ULL, 907 },
+    { 0xBF21E44003ACDD2DULL, 933 }, { 0x8E679C2F5E44FF8FULL, 960 }, { 0xD433179D9C8CB841ULL, 986 },
+    { 0x9E19DB92B4E31BA9ULL, 1013 }, { 0xEB96BF6EBADF77D9ULL, 1039 }, { 0xAF87023B9BF0EE6BULL, 1066 },
+};
+
+static Fp fromDouble(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(double));
+    int exponent = (int) ( ( bits >> 52 ) & 0x7FF );
+    uint64_t significand = bits & ( HIDDEN_BIT - 1 );
+    Fp fp;
+    if ( exponent != 0 ) {
+        fp.f = significand + HIDDEN_BIT;
+        fp.e = exponent - 1075;
+    } else {
+        fp.f = significand;
+        fp.e = -1074;
+    }
+    return fp;
+}
+
+static Fp normalize(Fp fp) {
+    int shift = __builtin_clzll(fp.f);
+    fp.f <<= shift;
+    fp.e -= shift;
+    return fp;
+}
+
+// The upper 64 bits of the product, rounded.
+static Fp multiply(Fp x, Fp y) {
+    __uint128_t product = (__uint128_t) x.f * y.f;
+    Fp fp;
+    fp.f = (uint64_t) ( product >> 64 ) + ( ( (uint64_t) product >> 63 ) & 1 );
+    fp.e = x.e + y.e + 64;
+    return fp;
+}
+
+// A cached power of ten c = 10^-k such that multiplying by it brings a binary exponent of `e` into [-60, -32].
+static Fp cachedPower(int e, int* k) {
+    double dk = ( -61 - e ) * 0.30102999566398114 + 347;
+    int ik = (int) dk;
+    if ( dk - ik > 0.0 ) ik++;
+    int index = ( ik >> 3 ) + 1;
+    *k = -( -348 + index * 8 );
+    return cachedPowers[index];
+}
+
+// Moves the last digit towards the exact value while it stays within the boundaries.
+static void roundWeed(char* digits, int length, uint64_t delta, uint64_t rest, uint64_t tenKappa, uint64_t distance) {
+    while ( rest < distance && delta - rest >= tenKappa
+            && ( rest + tenKappa < distance || distance - rest > rest + tenKappa - distance ) ) {
+        digits[length - 1]--;
+        rest += tenKappa;
+    }
+}
+
+// The digits of a number between `low` and `high`, close to `w`, with *k adjusted to their decimal exponent.
+static int generateDigits(Fp w, Fp high, uint64_t delta, char* digits, int* k) {
+    Fp one = { (uint64_t) 1 << -high.e, high.e };
+    uint64_t distance = high.f - w.f;
+    uint32_t integral = (uint32_t) ( high.f >> -one.e );
+    uint64_t fractional = high.f & ( one.f - 1 );
+    int kappa = 1;
+    while ( kappa < 10 && integral >= powersOfTen[kappa] ) {
+        kappa++;
+    }
+    int length = 0;
+    while ( kappa > 0 ) {
+        uint32_t digit = (uint32_t) ( integral / powersOfTen[kappa - 1] );
+        integral %= powersOfTen[kappa - 1];
+        if ( digit != 0 || length > 0 ) {
+            digits[length++] = (char) ( '0' + digit );
+        }
+        kappa--;
+        uint64_t rest = ( (uint64_t) integral << -one.e ) + fractional;
+        if ( rest <= delta ) {
+            *k += kappa;
+            roundWeed(digits, length, delta, rest, powersOfTen[kappa] << -one.e, distance);
+            return length;
+        }
+    }
+    for ( ; ; ) {
+        fractional *= 10;
+        delta *= 10;
+        char digit = (char) ( fractional >> -one.e );
+        if ( digit != 0 || length > 0 ) {
+            digits[length++] = (char) ( '0' + digit );
+        }
+        fractional &= one.f - 1;
+        kappa--;
+        if ( fractional < delta ) {
+            *k += kappa;
+            roundWeed(digits, length, delta, fractional, one.f, -kappa < 20 ? distance * powersOfTen[-kappa] : 0);
+            return length;
+        }
+    }
+}
+
+// The shortest digits of a positive, finite double, with the value being digits * 10^k.
+static int grisu2(double value, char* digits, int* k) {
+    Fp v = fromDouble(value);
+    Fp high = normalize((Fp) { ( v.f << 1 ) + 1, v.e - 1 });
+    Fp low = v.f == HIDDEN_BIT ? (Fp) { ( v.f << 2 ) - 1, v.e - 2 } : (Fp) { ( v.f << 1 ) - 1, v.e - 1 };
+    low.f <<= low.e - high.e;
+    low.e = high.e;
+    Fp c = cachedPower(high.e, k);
+    Fp w = multiply(normalize(v), c);
+    high = multiply(high, c);
+    low = multiply(low, c);
+    low.f++;
+    high.f--;
+    return generateDigits(w, high, high.f - low.f, digits, k);
+}
+
+// Near the precision of a double, Grisu2 can miss shorter digits, or the ones closest to the value among those of the
+// same length. So long results are replaced with correctly rounded ones, as short as still read back as the same double.
+static int shorten(double value, char* digits, int length, int* k) {
+    char string[32];
+    if ( length < 16 ) return length;
+    for ( int precision = length ; precision > 0 ; precision-- ) {
+        snprintf(string, sizeof(string), "%.*e", precision - 1, value);
+        if ( strtod(string, NULL) != value ) break;
+        char* exponent = strchr(string, 'e');
+        int count = 0;
+        for ( char* c = string ; c < exponent ; c++ ) {
+            if ( *c != '.' ) digits[count++] = *c;
+        }
+        length = count;
+        *k = atoi(exponent + 1) - ( count - 1 );
+    }
+    return length;
+}
+
+static char* writeExponent(char* string, int exponent) {
+    *string++ = 'e';
+    *string++ = exponent < 0 ? '-' : '+';
+    if ( exponent < 0 ) exponent = -exponent;
+    if ( exponent >= 100 ) *string++ = (char) ( '0' + exponent / 100 );
+    if ( exponent >= 10 ) *string++ = (char) ( '0' + exponent / 10 % 10 );
+    *string++ = (char) ( '0' + exponent % 10 );
+    return string;
+}
+
+char* number_toString(double value, char* buffer) {
+    char* string = buffer;
+    if ( value != value ) {
+        return strcpy(buffer, "NaN");
+    }
+    if ( value == 0 ) {
+        return strcpy(buffer, "0");
+    }
+    if ( value < 0 ) {
+        *string++ = '-';
+        value = -value;
+    }
+    if ( value == INFINITY ) {
+        strcpy(string, "Infinity");
+        return buffer;
+    }
+    if ( value < 9007199254740992.0 && value == (double) (uint64_t) value ) {
+        char digits[20];
+        int length = 0;
+        for ( uint64_t integer = (uint64_t) value ; integer > 0 ; integer /= 10 ) {
+            digits[length++] = (char) ( '0' + integer % 10 );
+        }
+        while ( length > 0 ) {
+            *string++ = digits[--length];
+        }
+        *string = 0;
+        return buffer;
+    }
+    char digits[20];
+    int k;
+    int length = shorten(value, digits, grisu2(value, digits, &k), &k);
+    while ( length > 1 && digits[length - 1] == '0' ) {
+        length--;
+        k++;
+    }
+    // the value is 0.digits * 10^n
+    int n = length + k;
+    if ( length <= n && n <= 21 ) {
+        memcpy(string, digits, length);
+        string += length;
+        memset(string, '0', n - length);
+        string += n - length;
+    } else if ( 0 < n && n <= 21 ) {
+        memcpy(string, digits, n);
+        string += n;
+        *string++ = '.';
+        memcpy(string, digits + n, length - n);
+        string += length - n;
+    } else if ( -6 < n && n <= 0 ) {
+        *string++ = '0';
+        *string++ = '.';
+        memset(string, '0', -n);
+        string += -n;
+        memcpy(string, digits, length);
+        string += length;
+    } else {
+        *string++ = digits[0];
+        if ( length > 1 ) {
+            *string++ = '.';
+            memcpy(string, digits + 1, length - 1);
+            string += length - 1;
+        }
+        string = writeExponent(string, n - 1);
+    }
+    *string = 0;
+    return buffer;
+}
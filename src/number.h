@@ -0,0 +1,16 @@
+#ifndef NUMBER_H
+#define NUMBER_H
+
+/*
+ * The string form of a number (ECMA-262 9.8.1): the shortest decimal that reads back as the same double, as Grisu2
+ * finds it, laid out as JavaScript does, so 1 is "1", 0.1 is "0.1" and 1e21 is "1e+21". Integers below 2^53 are
+ * written digit by digit without Grisu2.
+ *
+ * The string is written into a buffer of at least NUMBER_STRING_SIZE characters that the caller provides.
+ */
+
+#define NUMBER_STRING_SIZE 32
+
+char* number_toString(double, char*);
+
+#endif
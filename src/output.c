@@ -0,0 +1,107 @@
+#include "output.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+Output output_stdout = { 1, false, 0, NULL };
+Output output_stderr = { 2, true, 0, NULL };
+
+static bool configured = false;
+
+static void flushAll() {
+    output_flush(&output_stdout);
+    output_flush(&output_stderr);
+}
+
+static void configure() {
+    configured = true;
+    char* flush = getenv("CJS_OUTPUT_FLUSH");
+    if ( flush != NULL && strcmp(flush, "line") == 0 ) {
+        output_stdout.lineBuffered = true;
+    } else if ( flush != NULL && strcmp(flush, "block") == 0 ) {
+        output_stdout.lineBuffered = false;
+    } else {
+        output_stdout.lineBuffered = isatty(output_stdout.fd);
+    }
+    atexit(flushAll);
+}
+
+static void allocate(Output* output) {
+    if ( !configured ) {
+        configure();
+    }
+    if ( ( output->buffer = (char*) malloc(OUTPUT_BUFFER_SIZE) ) == NULL ) {
+        fprintf(stderr, "Out of memory: output buffer\n");
+        exit(1);
+    }
+}
+
+// Writes all of the vectors, which it may change, however many calls it takes. Output that cannot be written is lost,
+// like with stdio.
+static void writeAll(int fd, struct iovec* iov, int count) {
+    while ( count > 0 ) {
+        ssize_t written = writev(fd, iov, count);
+        if ( written < 0 ) {
+            if ( errno == EINTR ) continue;
+            return;
+        }
+        while ( count > 0 && (size_t) written >= iov->iov_len ) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if ( count > 0 ) {
+            iov->iov_base = (char*) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
+    }
+}
+
+void output_write(Output* output, char* data, size_t length) {
+    if ( output->buffer == NULL ) {
+        allocate(output);
+    }
+    if ( output->size + length <= OUTPUT_BUFFER_SIZE ) {
+        memcpy(output->buffer + output->size, data, length);
+        output->size += length;
+        return;
+    }
+    struct iovec iov[2] = { { output->buffer, output->size }, { data, length } };
+    writeAll(output->fd, iov, 2);
+    output->size = 0;
+}
+
+// Room for `length` characters at the end of the buffer, which the caller fills in and adds to `size`. `length` must not
+// exceed OUTPUT_BUFFER_SIZE.
+char* output_reserve(Output* output, size_t length) {
+    if ( output->buffer == NULL ) {
+        allocate(output);
+    }
+    if ( output->size + length > OUTPUT_BUFFER_SIZE ) {
+        output_flush(output);
+    }
+    return output->buffer + output->size;
+}
+
+// Ends a line written with the calls above, flushing it if the stream is line buffered. A line on standard error first
+// flushes standard output.
+void output_endLine(Output* output) {
+    output_char(output, '\n');
+    if ( output == &output_stderr ) {
+        output_flush(&output_stdout);
+    }
+    if ( output->lineBuffered ) {
+        output_flush(output);
+    }
+}
+
+void output_flush(Output* output) {
+    if ( output->size == 0 ) return;
+    struct iovec iov = { output->buffer, output->size };
+    writeAll(output->fd, &iov, 1);
+    output->size = 0;
+}
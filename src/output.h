@@ -0,0 +1,42 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*
+ * Buffered output for `console.log()` and `console.error()`. Each stream has a large buffer of its own that values are
+ * formatted straight into; a write too large for it goes out together with what is buffered in one writev().
+ *
+ * Standard output is flushed at the end of every line when it is a terminal and only once its buffer is full when it is
+ * a pipe or a file. Standard error is flushed at the end of every line, after flushing standard output, so the two keep
+ * their order on a terminal. Both are flushed when the program exits. The environment overrides the policy:
+ *
+ *     CJS_OUTPUT_FLUSH  "line" to flush standard output at the end of every line, "block" to flush it when full
+ */
+
+#define OUTPUT_BUFFER_SIZE (64 << 10)
+
+typedef struct Output Output;
+
+struct Output {
+    int fd;
+    bool lineBuffered;
+    size_t size;
+    char* buffer;
+};
+
+extern Output output_stdout;
+extern Output output_stderr;
+
+void output_write(Output*, char*, size_t);
+char* output_reserve(Output*, size_t);
+void output_endLine(Output*);
+void output_flush(Output*);
+
+static inline void output_char(Output* output, char c) {
+    *output_reserve(output, 1) = c;
+    output->size += 1;
+}
+
+#endif
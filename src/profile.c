@@ -0,0 +1,222 @@
+#include "profile.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct ProfileEdge ProfileEdge;
+
+struct ProfileEdge {
+    ProfileFunction* caller;
+    ProfileFunction* callee;
+    uint64_t calls;
+    uint64_t nanos;             // spent in the callee itself
+};
+
+static ProfileFunction topLevel = PROFILE_FUNCTION("(top level)");
+static ProfileNode root = { &topLevel, NULL, NULL, NULL, 1, 0 };
+
+static bool started = false;
+static uint64_t startTime = 0;
+static uint64_t topLevelChildNanos = 0;
+
+static ProfileFrame* current = NULL;
+static ProfileFunction* functions = NULL;
+
+static void writeProfile();
+
+// Called by the main() of an instrumented program, so that the top level code before its first call counts as well.
+void profile_start() {
+    if ( started ) return;
+    started = true;
+    startTime = profile_now();
+    atexit(writeProfile);
+}
+
+// The context of a call to `function` from `parent`, which moves to the front of the children so that the contexts
+// called most recently, as in a loop, are found first.
+static ProfileNode* childOf(ProfileNode* parent, ProfileFunction* function) {
+    ProfileNode* previous = NULL;
+    for ( ProfileNode* node = parent->children ; node != NULL ; previous = node, node = node->sibling ) {
+        if ( node->function == function ) {
+            if ( previous != NULL ) {
+                previous->sibling = node->sibling;
+                node->sibling = parent->children;
+                parent->children = node;
+            }
+            return node;
+        }
+    }
+    ProfileNode* node = (ProfileNode*) calloc(1, sizeof(ProfileNode));
+    node->function = function;
+    node->parent = parent;
+    node->sibling = parent->children;
+    parent->children = node;
+    return node;
+}
+
+void profile_enter(ProfileFrame* frame, ProfileFunction* function) {
+    if ( !started ) {
+        profile_start();
+    }
+    if ( function->calls == 0 ) {
+        function->next = functions;
+        functions = function;
+    }
+    ProfileNode* node = childOf(current == NULL ? &root : current->node, function);
+    function->calls += 1;
+    function->active += 1;
+    node->calls += 1;
+    frame->node = node;
+    frame->caller = current;
+    frame->childNanos = 0;
+    current = frame;
+    frame->start = profile_now();
+}
+
+void profile_leave(ProfileFrame* frame) {
+    uint64_t elapsed = profile_now() - frame->start;
+    uint64_t self = elapsed > frame->childNanos ? elapsed - frame->childNanos : 0;
+    ProfileFunction* function = frame->node->function;
+    frame->node->selfNanos += self;
+    function->exclusiveNanos += self;
+    function->active -= 1;
+    if ( function->active == 0 ) {
+        function->inclusiveNanos += elapsed;
+    }
+    if ( frame->caller != NULL ) {
+        frame->caller->childNanos += elapsed;
+    } else {
+        topLevelChildNanos += elapsed;
+    }
+    current = frame->caller;
+}
+
+static void writeStack(FILE* file, ProfileNode* node) {
+    size_t depth = 0;
+    for ( ProfileNode* tmp = node ; tmp != NULL ; tmp = tmp->parent ) {
+        depth += 1;
+    }
+    ProfileNode** stack = (ProfileNode**) malloc(depth * sizeof(ProfileNode*));
+    size_t i = depth;
+    for ( ProfileNode* tmp = node ; tmp != NULL ; tmp = tmp->parent ) {
+        stack[--i] = tmp;
+    }
+    for ( i = 0 ; i < depth ; i++ ) {
+        fprintf(file, "%s%s", i == 0 ? "" : ";", stack[i]->function->name);
+    }
+    fprintf(file, " %llu\n", (unsigned long long) node->selfNanos);
+    free(stack);
+}
+
+// Every context with time of its own, in preorder without recursion, as the contexts of deep recursion nest as deep.
+static void writeCollapsed(FILE* file) {
+    ProfileNode* node = &root;
+    while ( node != NULL ) {
+        if ( node->selfNanos > 0 ) {
+            writeStack(file, node);
+        }
+        if ( node->children != NULL ) {
+            node = node->children;
+            continue;
+        }
+        while ( node != NULL && node->sibling == NULL ) {
+            node = node->parent;
+        }
+        node = node == NULL ? NULL : node->sibling;
+    }
+}
+
+static int compareFunctions(const void* left, const void* right) {
+    uint64_t a = ( *(ProfileFunction**) left )->inclusiveNanos;
+    uint64_t b = ( *(ProfileFunction**) right )->inclusiveNanos;
+    return a > b ? -1 : a < b;
+}
+
+static int compareEdges(const void* left, const void* right) {
+    uint64_t a = ( (ProfileEdge*) left )->calls;
+    uint64_t b = ( (ProfileEdge*) right )->calls;
+    return a > b ? -1 : a < b;
+}
+
+static void printReport(FILE* file) {
+    size_t count = 0;
+    for ( ProfileFunction* function = functions ; function != NULL ; function = function->next ) {
+        count += 1;
+    }
+    ProfileFunction** sorted = (ProfileFunction**) malloc(( count + 1 ) * sizeof(ProfileFunction*));
+    count = 0;
+    for ( ProfileFunction* function = functions ; function != NULL ; function = function->next ) {
+        sorted[count++] = function;
+    }
+    qsort(sorted, count, sizeof(ProfileFunction*), compareFunctions);
+    fprintf(file, "profile of process %d, %.3f ms:\n", (int) getpid(), ( root.selfNanos + topLevelChildNanos ) / 1e6);
+    fprintf(file, "  %-24s %14s %16s %16s\n", "function", "calls", "inclusive ms", "exclusive ms");
+    for ( size_t i = 0 ; i < count ; i++ ) {
+        fprintf(file, "  %-24s %14llu %16.3f %16.3f\n", sorted[i]->name, (unsigned long long) sorted[i]->calls,
+            sorted[i]->inclusiveNanos / 1e6, sorted[i]->exclusiveNanos / 1e6);
+    }
+    free(sorted);
+    ProfileEdge* edges = NULL;
+    size_t edgeCount = 0;
+    size_t edgeCapacity = 0;
+    for ( ProfileNode* node = root.children ; node != NULL ; ) {
+        size_t i = 0;
+        while ( i < edgeCount && ( edges[i].caller != node->parent->function || edges[i].callee != node->function ) ) {
+            i += 1;
+        }
+        if ( i == edgeCount ) {
+            if ( edgeCount == edgeCapacity ) {
+                edgeCapacity = edgeCapacity == 0 ? 64 : edgeCapacity * 2;
+                edges = (ProfileEdge*) realloc(edges, edgeCapacity * sizeof(ProfileEdge));
+            }
+            ProfileEdge edge = { node->parent->function, node->function, 0, 0 };
+            edges[edgeCount++] = edge;
+        }
+        edges[i].calls += node->calls;
+        edges[i].nanos += node->selfNanos;
+        if ( node->children != NULL ) {
+            node = node->children;
+            continue;
+        }
+        while ( node != &root && node->sibling == NULL ) {
+            node = node->parent;
+        }
+        node = node == &root ? NULL : node->sibling;
+    }
+    qsort(edges, edgeCount, sizeof(ProfileEdge), compareEdges);
+    fprintf(file, "  %-24s %-24s %14s %16s\n", "caller", "callee", "calls", "callee self ms");
+    for ( size_t i = 0 ; i < edgeCount ; i++ ) {
+        fprintf(file, "  %-24s %-24s %14llu %16.3f\n", edges[i].caller->name, edges[i].callee->name,
+            (unsigned long long) edges[i].calls, edges[i].nanos / 1e6);
+    }
+    free(edges);
+}
+
+// Returns from the calls that are still running, as when the program exits from inside a function, and writes it all.
+static void writeProfile() {
+    while ( current != NULL ) {
+        profile_leave(current);
+    }
+    uint64_t total = profile_now() - startTime;
+    root.selfNanos = total > topLevelChildNanos ? total - topLevelChildNanos : 0;
+    char path[64];
+    char* configured = getenv("CJS_PROFILE");
+    if ( configured == NULL || *configured == 0 ) {
+        snprintf(path, sizeof(path), "cjs-%d.collapsed", (int) getpid());
+        configured = path;
+    }
+    FILE* file = fopen(configured, "w");
+    if ( file == NULL ) {
+        fprintf(stderr, "could not write profile: %s\n", configured);
+    } else {
+        writeCollapsed(file);
+        fclose(file);
+    }
+    char* report = getenv("CJS_PROFILE_REPORT");
+    if ( report != NULL && strcmp(report, "1") == 0 ) {
+        printReport(stderr);
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * The profiler behind `transpiler --instrument`, which wraps every generated function in a call to profile_enter() and
+ * one to profile_leave(). Calls are counted by calling context, the chain of functions that led to them, and timed with
+ * CLOCK_MONOTONIC. On exit the program writes its time by calling context as collapsed stacks, one line each
+ *
+ *     (top level);outer;inner 1250000
+ *
+ * with the nanoseconds spent in `inner` itself when called from `outer`, which flamegraph.pl, speedscope and pprof
+ * read. `(top level)` is the time spent outside of any function. It writes to $CJS_PROFILE or to cjs-<pid>.collapsed,
+ * and with CJS_PROFILE_REPORT=1 it also prints to stderr the calls, inclusive and exclusive time of each function and
+ * the calls along each caller to callee edge.
+ *
+ * The inclusive time of a recursive function only counts its outermost calls. The runtime is single threaded, so there
+ * is a single stack of frames rather than one per thread.
+ */
+
+typedef struct ProfileFunction ProfileFunction;
+typedef struct ProfileNode ProfileNode;
+typedef struct ProfileFrame ProfileFrame;
+
+// A function of the program, in its static data.
+struct ProfileFunction {
+    char* name;
+    uint64_t calls;
+    uint64_t inclusiveNanos;
+    uint64_t exclusiveNanos;
+    int active;                 // calls that have not returned yet
+    ProfileFunction* next;      // in the list of the functions that were called, NULL before their first call
+};
+
+#define PROFILE_FUNCTION(name) { (name), 0, 0, 0, 0, NULL }
+
+// A calling context: a function called from the context of its parent.
+struct ProfileNode {
+    ProfileFunction* function;
+    ProfileNode* parent;
+    ProfileNode* children;
+    ProfileNode* sibling;
+    uint64_t calls;
+    uint64_t selfNanos;
+};
+
+// A call that has not returned yet, on the C stack of the generated function.
+struct ProfileFrame {
+    ProfileNode* node;
+    ProfileFrame* caller;
+    uint64_t start;
+    uint64_t childNanos;
+};
+
+void profile_start();
+void profile_enter(ProfileFrame*, ProfileFunction*);
+void profile_leave(ProfileFrame*);
+
+static inline uint64_t profile_now() {
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return (uint64_t) time.tv_sec * 1000000000 + time.tv_nsec;
+}
+
+#endif
@@ -1,44 +1,181 @@
 #include "runtime.h"
 
+#include <ctype.h>
+#include <math.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "atom.h"
+#include "gc.h"
 #include "hashtable.h"
+#include "number.h"
+#include "output.h"
+#include "slab.h"
+#include "stats.h"
 
-static Variable* new_Variable() {
-    Variable* variable = (Variable*) calloc(1, sizeof(Variable));
-    variable->type = UNDEFINED_VARIABLE_TYPE;
-    variable->value = NULL;
-    return variable;
+_Static_assert(sizeof(Variable) == sizeof(void*), "hashtables store variables in their void* values");
+
+// Variables are stored in hashtables as the bits of their word, never 0, so NULL still means there is no entry.
+#define FROM_SLOT(slot)     ( (Variable) (uintptr_t) (slot) )
+#define TO_SLOT(variable)   ( (void*) (uintptr_t) (variable) )
+
+static Variable wrapString(String* string) {
+    return (Variable) (uintptr_t) string | VARIABLE_STRING_TAG;
+}
+
+static Variable wrapObject(Object* object) {
+    return (Variable) (uintptr_t) object;
 }
 
+// A flat string of `length` characters, which the caller fills in.
+static String* allocateString(size_t length) {
+    String* string = (String*) gc_allocate(STRING_GC_CELL_TYPE, sizeof(String) + length + 1);
+    string->length = length;
+    string->chars = string->data;
+    return string;
+}
+
+#define INDEX_ATOMS 64
+
+// The atom of an array index, the first ones interned once.
+static char* indexAtom(uint32_t index) {
+    static char* atoms[INDEX_ATOMS];
+    if ( index < INDEX_ATOMS && atoms[index] != NULL ) {
+        return atoms[index];
+    }
+    char key[12];
+    sprintf(key, "%u", index);
+    char* atom = atom_intern(key);
+    if ( index < INDEX_ATOMS ) {
+        atoms[index] = atom;
+    }
+    return atom;
+}
+
+// A declared variable is never NULL in its scope, so that a lookup does not fall through to a variable of the same name
+// in a parent scope. Declaring it again keeps its value.
 static void Scope_defineVariable(Scope* scope, char* name) {
-    ht_set(scope->hashtable, name, NULL);
+    if ( ht_get(scope->hashtable, name) == NULL ) {
+        ht_set(scope->hashtable, name, TO_SLOT(new_undefined()));
+    }
 }
 
-static Variable* Scope_getVariable(Scope* scope, char* name) {
-    Variable* variable = ht_get(scope->hashtable, name);
-    if ( variable == NULL ) {
-        Scope* parentScope = scope->parent;
-        if ( parentScope == NULL ) {
-            return new_undefined();
-        } else {
-            return parentScope->getVariable(parentScope, name);
+// Only the global scope, the root of every chain, looks up its variables differently, see GlobalScope_getVariable().
+static Variable Scope_getVariable(Scope* scope, char* name) {
+    for ( ; scope->parent != NULL ; scope = scope->parent ) {
+        void* variable = ht_get(scope->hashtable, name);
+        if ( variable != NULL ) {
+            return native_root(FROM_SLOT(variable));
+        }
+    }
+    return scope->getVariable(scope, name);
+}
+
+// Assigns to the variable in the nearest scope that declares it, or creates a global one like sloppy mode JS does.
+static Variable Scope_setVariable(Scope* scope, char* name, Variable variable) {
+    for ( ; scope->parent != NULL ; scope = scope->parent ) {
+        if ( ht_get(scope->hashtable, name) != NULL ) {
+            ht_set(scope->hashtable, name, TO_SLOT(variable));
+            return variable;
         }
-    } else {
-        return variable;
     }
+    return scope->setVariable(scope, name, variable);
 }
 
-static void Scope_setVariable(Scope* scope, char* name, Variable* variable) {
-    // TODO throw exception if variable is not defined
-    ht_set(scope->hashtable, name, variable);
+/*
+ * Global variables live in cells of their own, one per name for as long as the program runs, so generated code can
+ * keep a pointer to the cell of a global it reads or assigns, see GlobalCache in runtime.h. Such a pointer is only
+ * valid while no other scope declares the same name, since scopes are dynamic and a declaration in any calling scope
+ * hides the global. Generated code therefore announces every name it declares outside of the global scope with
+ * native_shadowGlobal(), which marks the cell as shadowed for good and bumps native_globalVersion to drop every cache.
+ * Declaring a new global bumps it as well, for the caches that found no cell for its name.
+ */
+
+hashtable_t* native_globalCells = NULL;
+uint32_t native_globalVersion = 1;
+
+static GlobalCell* builtinCell(char*);
+
+// The cell of a global, or NULL if nothing ever declared or assigned the name.
+static GlobalCell* findGlobalCell(char* name) {
+    GlobalCell* cell = native_globalCells == NULL ? NULL : (GlobalCell*) ht_get(native_globalCells, name);
+    return cell != NULL ? cell : builtinCell(name);
 }
 
-Scope* new_Scope(Scope* parentScope) {
-    Scope* scope = (Scope*) calloc(1, sizeof(Scope));
+static GlobalCell* globalCell(char* name) {
+    if ( native_globalCells == NULL ) {
+        native_globalCells = ht_create(1);
+    }
+    GlobalCell* cell = findGlobalCell(name);
+    if ( cell == NULL ) {
+        cell = (GlobalCell*) calloc(1, sizeof(GlobalCell));
+        cell->value = new_undefined();
+        ht_set(native_globalCells, name, cell);
+    }
+    return cell;
+}
+
+static void GlobalScope_defineVariable(Scope* scope, char* name) {
+    GlobalCell* cell = globalCell(name);
+    if ( !cell->declared ) {
+        cell->declared = true;
+        native_globalVersion += 1;
+    }
+}
+
+static Variable GlobalScope_getVariable(Scope* scope, char* name) {
+    GlobalCell* cell = findGlobalCell(name);
+    if ( cell == NULL || !cell->declared ) {
+        return new_undefined();
+    }
+    return native_root(cell->value);
+}
+
+static Variable GlobalScope_setVariable(Scope* scope, char* name, Variable variable) {
+    GlobalScope_defineVariable(scope, name);
+    globalCell(name)->value = variable;
+    return variable;
+}
+
+void native_shadowGlobal(char* name) {
+    GlobalCell* cell = globalCell(name);
+    if ( !cell->shadowed ) {
+        cell->shadowed = true;
+        native_globalVersion += 1;
+    }
+}
+
+// Resolves a global for a cache that is out of date, and fills the cache unless the name is also declared elsewhere.
+Variable native_getGlobalMiss(Scope* scope, char* name, GlobalCache* cache) {
+    GlobalCell* cell = findGlobalCell(name);
+    cache->cell = cell != NULL && cell->declared && !cell->shadowed ? cell : NULL;
+    cache->version = native_globalVersion;
+    return scope->getVariable(scope, name);
+}
+
+Variable native_setGlobalMiss(Scope* scope, char* name, Variable variable, GlobalCache* cache) {
+    scope->setVariable(scope, name, variable);
+    GlobalCell* cell = findGlobalCell(name);
+    cache->cell = cell != NULL && cell->declared && !cell->shadowed ? cell : NULL;
+    cache->version = native_globalVersion;
+    return variable;
+}
+
+// Binds globals to cells of their own, like the static ones generated code keeps its top level functions in. The
+// cells are declared already, and a name given twice is bound to its last cell.
+void native_defineGlobals(int count, char** names, GlobalCell* cells) {
+    if ( native_globalCells == NULL ) {
+        native_globalCells = ht_create(count);
+    }
+    for ( int i = 0 ; i < count ; i++ ) {
+        ht_set(native_globalCells, names[i], &cells[i]);
+    }
+    native_globalVersion += 1;
+}
+
+static Scope* initializeScope(Scope* scope, Scope* parentScope) {
     scope->parent = parentScope;
     scope->hashtable = ht_create(1);
     scope->defineVariable = Scope_defineVariable;
@@ -47,133 +184,571 @@ Scope* new_Scope(Scope* parentScope) {
     return scope;
 }
 
-static Variable* Object_getProperty(Object* object, char* name) {
-    Variable* variable = ht_get(object->properties, name);
-    if ( variable == NULL ) {
-        variable = ht_get(object->properties, "prototype");
-        if ( variable == NULL ) {
-            return new_undefined();
-        } else {
-            Object* prototype = (Object*) variable->value;
-            return prototype->getProperty(prototype, name);
+// Scopes never escape the call that creates them, as functions do not close over them, so they live in its region.
+Scope* new_Scope(Scope* parentScope) {
+    return initializeScope((Scope*) gc_allocateInRegion(SCOPE_GC_CELL_TYPE, sizeof(Scope)), parentScope);
+}
+
+// Creates a scope that lives for as long as the program runs, like the one of a module, whichever call creates it.
+Scope* new_PermanentScope(Scope* parentScope) {
+    Scope* scope = initializeScope((Scope*) gc_allocate(SCOPE_GC_CELL_TYPE, sizeof(Scope)), parentScope);
+    gc_addRoot(scope);
+    return scope;
+}
+
+// Keeps a value alive for as long as the program runs.
+void native_addRoot(Variable variable) {
+    switch (native_typeOf(variable)) {
+        case STRING_VARIABLE_TYPE:
+            gc_addRoot(native_stringValue(variable));
+            break;
+        case OBJECT_VARIABLE_TYPE:
+            gc_addRoot(native_objectValue(variable));
+            break;
+        default:
+            break;
+    }
+}
+
+Scope* native_globalScope(Scope* scope) {
+    while ( scope->parent != NULL ) {
+        scope = scope->parent;
+    }
+    return scope;
+}
+
+Shape native_emptyShape = { NULL, NULL, 0, NULL };
+static SlabAllocator shapeCells = SLAB_ALLOCATOR("shape", sizeof(Shape));
+
+// The slot of a property in a shape, or -1.
+static int Shape_slotOf(Shape* shape, char* name) {
+    for ( ; shape->key != NULL ; shape = shape->parent ) {
+        if ( shape->key == name ) {
+            return shape->slotCount - 1;
         }
-    } else {
-        return variable;
     }
+    return -1;
 }
 
-static void Object_setProperty(Object* object, char* name, Variable* property) {
-    ht_set(object->properties, name, property);
+// The shape with one more property, the same for every object that gets it.
+static Shape* Shape_transition(Shape* shape, char* name) {
+    if ( shape->transitions == NULL ) {
+        shape->transitions = ht_create(1);
+    }
+    Shape* next = (Shape*) ht_get(shape->transitions, name);
+    if ( next == NULL ) {
+        next = (Shape*) slab_allocate(&shapeCells);
+        next->parent = shape;
+        next->key = name;
+        next->slotCount = shape->slotCount + 1;
+        ht_set(shape->transitions, name, next);
+    }
+    return next;
 }
 
-static Return Object_call(Object* object, Scope* scope, int argc, ...) {
-    Return (*function)(Scope*, Object*) = (Return (*)(Scope*, Object*)) ht_get(object->internalProperties, "call");
-    if ( function == NULL ) {
-        // TODO this object is not a function, throw runtime exception
-        fprintf(stderr, "Unsupported Operation: object is not a function\n");
-        Return ret;
-        ret.error = "object is not a function";
-        return ret;
+static void Object_reserveSlots(Object* object, int count) {
+    if ( count <= object->slotCapacity ) return;
+    int capacity = object->slotCapacity * 2;
+    while ( capacity < count ) {
+        capacity *= 2;
+    }
+    if ( object->slots == object->inlineSlots ) {
+        object->slots = (Variable*) malloc(capacity * sizeof(Variable));
+        memcpy(object->slots, object->inlineSlots, object->slotCapacity * sizeof(Variable));
+        stats_allocate(OBJECT_SLOTS_STATS_KIND, capacity * sizeof(Variable));
     } else {
-        va_list varargs;
-        va_start(varargs, argc);
-        Object* arguments = new_Object();
-        arguments->setProperty(arguments, "length", new_number(argc));
-        for ( int i = 0 ; i < argc ; i++ ) {
-            char* tmp = (char*) calloc(20, sizeof(char));
-            sprintf(tmp, "%i", i);
-            tmp = (char*) realloc(tmp, strlen(tmp)+1);
-            arguments->setProperty(arguments, tmp, (Variable*) va_arg(varargs, Variable*));
-            free(tmp);
+        object->slots = (Variable*) realloc(object->slots, capacity * sizeof(Variable));
+        stats_reallocate(OBJECT_SLOTS_STATS_KIND, object->slotCapacity * sizeof(Variable), capacity * sizeof(Variable));
+    }
+    object->slotCapacity = capacity;
+}
+
+// Moves the properties of the shape into a hashtable of the object's own.
+static void Object_toDictionary(Object* object) {
+    object->properties = ht_create(object->shape->slotCount);
+    for ( Shape* shape = object->shape ; shape->key != NULL ; shape = shape->parent ) {
+        ht_set(object->properties, shape->key, TO_SLOT(object->slots[shape->slotCount - 1]));
+    }
+    if ( object->slots != object->inlineSlots ) {
+        stats_free(OBJECT_SLOTS_STATS_KIND, object->slotCapacity * sizeof(Variable));
+        free(object->slots);
+    }
+    object->shape = NULL;
+    object->slots = object->inlineSlots;
+    object->slotCapacity = OBJECT_INLINE_SLOTS;
+}
+
+static bool Object_getOwnProperty(Object* object, char* name, Variable* property) {
+    if ( object->shape != NULL ) {
+        int slot = Shape_slotOf(object->shape, name);
+        if ( slot < 0 ) return false;
+        *property = object->slots[slot];
+        return true;
+    }
+    void* variable = ht_get(object->properties, name);
+    if ( variable == NULL ) return false;
+    *property = FROM_SLOT(variable);
+    return true;
+}
+
+Variable Object_getProperty(Object* object, char* name) {
+    Variable property;
+    int prototypes = 0;
+    while ( !Object_getOwnProperty(object, name, &property) ) {
+        Variable prototype;
+        if ( !Object_getOwnProperty(object, ATOM("prototype"), &prototype) ) {
+            stats_propertyLookup(prototypes);
+            return new_undefined();
         }
-        va_end(varargs);
-        return function(scope, arguments);
+        object = native_objectValue(prototype);
+        prototypes += 1;
     }
+    stats_propertyLookup(prototypes);
+    return native_root(property);
 }
 
-Object* new_Object() {
-    Object* object = (Object*) calloc(1, sizeof(Object));
-    object->properties = ht_create(1);
+Variable Object_setProperty(Object* object, char* name, Variable property) {
+    if ( object->shape != NULL ) {
+        int slot = Shape_slotOf(object->shape, name);
+        if ( slot >= 0 ) {
+            object->slots[slot] = property;
+            return property;
+        }
+        if ( object->shape->slotCount < SHAPE_MAX_SLOTS ) {
+            Shape* shape = Shape_transition(object->shape, name);
+            Object_reserveSlots(object, shape->slotCount);
+            object->slots[shape->slotCount - 1] = property;
+            object->shape = shape;
+            return property;
+        }
+        Object_toDictionary(object);
+    }
+    ht_set(object->properties, name, TO_SLOT(property));
+    return property;
+}
+
+static void PropertyCache_add(PropertyCache* cache, Shape* shape, Shape* newShape, int slot) {
+    if ( cache->count == PROPERTY_CACHE_ENTRIES ) return;
+    for ( int i = 0 ; i < cache->count ; i++ ) {
+        if ( cache->entries[i].shape == shape ) return;
+    }
+    cache->entries[cache->count].shape = shape;
+    cache->entries[cache->count].newShape = newShape;
+    cache->entries[cache->count].slot = slot;
+    cache->count += 1;
+}
+
+Variable native_getPropertyMiss(Object* object, char* name, PropertyCache* cache) {
+    if ( object->shape != NULL ) {
+        int slot = Shape_slotOf(object->shape, name);
+        if ( slot >= 0 ) {
+            PropertyCache_add(cache, object->shape, object->shape, slot);
+            return native_root(object->slots[slot]);
+        }
+    }
+    return object->getProperty(object, name);
+}
+
+Variable native_setPropertyMiss(Object* object, char* name, Variable property, PropertyCache* cache) {
+    Shape* shape = object->shape;
+    object->setProperty(object, name, property);
+    if ( shape != NULL && object->shape != NULL ) {
+        // An array keeps its length outside of the shape, which then has no slot to cache.
+        int slot = Shape_slotOf(object->shape, name);
+        if ( slot >= 0 ) {
+            PropertyCache_add(cache, shape, object->shape, slot);
+        }
+    }
+    return property;
+}
+
+// Whether a property key is an array index (ECMA-262 15.4): the decimal digits of a number below 2^32 - 1, with no
+// leading zeros.
+static bool arrayIndexOf(char* name, uint32_t* index) {
+    if ( *name == 0 || ( *name == '0' && name[1] != 0 ) ) return false;
+    uint64_t value = 0;
+    for ( char* c = name ; *c != 0 ; c++ ) {
+        if ( !isdigit(*c) ) return false;
+        value = value * 10 + ( *c - '0' );
+        if ( value >= 4294967295ULL ) return false;
+    }
+    *index = (uint32_t) value;
+    return true;
+}
+
+static void Array_reserveElements(Object* array, uint32_t count) {
+    if ( count <= array->elementCapacity ) return;
+    uint32_t capacity = array->elementCapacity < 4 ? 4 : array->elementCapacity * 2;
+    while ( capacity < count ) {
+        capacity *= 2;
+    }
+    array->elements = (Variable*) realloc(array->elements, capacity * sizeof(Variable));
+    stats_reallocate(OBJECT_SLOTS_STATS_KIND, array->elementCapacity * sizeof(Variable), capacity * sizeof(Variable));
+    array->elementCapacity = capacity;
+}
+
+static void Array_append(Object* array, Variable element) {
+    Array_reserveElements(array, array->elementCount + 1);
+    array->elements[array->elementCount++] = element;
+    if ( array->elementCount > array->length ) {
+        array->length = array->elementCount;
+    }
+}
+
+// Elements past the dense ones, after a hole, are ordinary properties; those at or beyond the length are not there.
+static Variable Array_getProperty(Object* array, char* name) {
+    uint32_t index;
+    if ( name == ATOM("length") ) {
+        return new_number(array->length);
+    }
+    if ( arrayIndexOf(name, &index) ) {
+        if ( index < array->elementCount ) {
+            return native_root(array->elements[index]);
+        }
+        if ( index >= array->length ) {
+            return new_undefined();
+        }
+    }
+    return Object_getProperty(array, name);
+}
+
+// Deletes the elements from `length` on that are properties rather than dense elements, as setting a shorter length
+// does (ECMA-262 15.4.5.1). A shape cannot lose a property, so the array becomes a dictionary first.
+static void Array_deletePropertiesFrom(Object* array, uint32_t length) {
+    uint32_t index;
+    if ( array->shape != NULL ) {
+        bool found = false;
+        for ( Shape* shape = array->shape ; shape->key != NULL && !found ; shape = shape->parent ) {
+            found = arrayIndexOf(shape->key, &index) && index >= length;
+        }
+        if ( !found ) return;
+        Object_toDictionary(array);
+    }
+    char** names = (char**) malloc(array->properties->count * sizeof(char*));
+    int count = 0;
+    for ( entry_t* pair = ht_first(array->properties) ; pair != NULL ; pair = ht_next(array->properties, pair) ) {
+        if ( arrayIndexOf(pair->key, &index) && index >= length ) {
+            names[count++] = pair->key;
+        }
+    }
+    for ( int i = 0 ; i < count ; i++ ) {
+        ht_delete(array->properties, names[i]);
+    }
+    free(names);
+}
+
+static Variable Array_setProperty(Object* array, char* name, Variable value) {
+    uint32_t index;
+    if ( name == ATOM("length") ) {
+        uint32_t length = native_toUint32(native_toNumber(value));
+        if ( length < array->length && array->length > array->elementCount ) {
+            Array_deletePropertiesFrom(array, length);
+        }
+        array->length = length;
+        if ( array->length < array->elementCount ) {
+            array->elementCount = array->length;
+        }
+        return value;
+    }
+    if ( !arrayIndexOf(name, &index) ) {
+        return Object_setProperty(array, name, value);
+    }
+    if ( index < array->elementCount ) {
+        array->elements[index] = value;
+        return value;
+    }
+    if ( index == array->elementCount ) {
+        Array_append(array, value);
+        return value;
+    }
+    if ( index >= array->length ) {
+        array->length = index + 1;
+    }
+    return Object_setProperty(array, name, value);
+}
+
+// Array.prototype.join(",") (ECMA-262 15.4.4.5), which is the string form of an array.
+static char* Array_toString(Object* array) {
+    size_t length = 0;
+    char* string = (char*) malloc(1);
+    char buffer[NUMBER_STRING_SIZE];
+    for ( uint32_t i = 0 ; i < array->length ; i++ ) {
+        Variable element = i < array->elementCount ? array->elements[i] : Array_getProperty(array, indexAtom(i));
+        char* tmp = native_typeOf(element) == UNDEFINED_VARIABLE_TYPE || native_typeOf(element) == NULL_VARIABLE_TYPE ? "" : native_toString(element, buffer);
+        size_t tmpLength = strlen(tmp);
+        string = (char*) realloc(string, length + tmpLength + 2);
+        if ( i > 0 ) {
+            string[length++] = ',';
+        }
+        memcpy(string + length, tmp, tmpLength);
+        length += tmpLength;
+    }
+    string[length] = 0;
+    String* result = allocateString(length);
+    memcpy(result->data, string, length + 1);
+    free(string);
+    return result->data;
+}
+
+// The atom of the characters of a string, which becomes its characters, so using the same string as a key again costs
+// nothing.
+static char* internString(String* string) {
+    if ( string->interned ) {
+        return string->chars;
+    }
+    char* chars = native_stringChars(string);
+    char* atom = atom_internHashed(chars, native_stringHash(string));
+    if ( chars != string->data ) {
+        stats_free(STRING_CHARS_STATS_KIND, string->length + 1);
+        free(chars);
+    }
+    string->chars = atom;
+    string->interned = true;
+    return atom;
+}
+
+// The key `object[key]` stands for: array indices get the atom of their digits, anything else that of its string.
+char* native_toPropertyKey(Variable key) {
+    if ( native_isNumber(key) ) {
+        double number = native_numberValue(key);
+        if ( number >= 0 && number < 4294967295.0 && number == (uint32_t) number ) {
+            return indexAtom((uint32_t) number);
+        }
+    }
+    if ( native_typeOf(key) == STRING_VARIABLE_TYPE ) {
+        return internString(native_stringValue(key));
+    }
+    char buffer[NUMBER_STRING_SIZE];
+    return atom_intern(native_toString(key, buffer));
+}
+
+Variable native_getElementSlow(Object* object, Variable key) {
+    return object->getProperty(object, native_toPropertyKey(key));
+}
+
+Variable native_setElementSlow(Object* object, Variable key, Variable value) {
+    if ( object->isArray && native_isNumber(key) && native_numberValue(key) == object->elementCount ) {
+        Array_append(object, value);
+        return value;
+    }
+    return object->setProperty(object, native_toPropertyKey(key), value);
+}
+
+static Object* initializeObject(Object* object) {
+    object->shape = &native_emptyShape;
+    object->slots = object->inlineSlots;
+    object->slotCapacity = OBJECT_INLINE_SLOTS;
     object->internalProperties = ht_create(1);
     object->getProperty = Object_getProperty;
     object->setProperty = Object_setProperty;
-    object->call = Object_call;
+    object->call = native_apply;
     return object;
 }
 
-Variable* new_undefined() {
-    return new_Variable();
+Object* new_Object() {
+    return initializeObject((Object*) gc_allocate(OBJECT_GC_CELL_TYPE, sizeof(Object)));
 }
 
-Variable* new_null() {
-    Variable* variable = new_Variable();
-    variable->type = NULL_VARIABLE_TYPE;
-    return variable;
+static Object* initializeArray(Object* object) {
+    object->isArray = true;
+    object->getProperty = Array_getProperty;
+    object->setProperty = Array_setProperty;
+    return object;
 }
 
-Variable* new_boolean(bool value) {
-    Variable* variable = new_Variable();
-    variable->type = BOOLEAN_VARIABLE_TYPE;
-    bool* tmp = variable->value = (bool*) calloc(1, sizeof(bool));
-    *tmp = value;
-    return variable;
+// Creates an array from the values of a literal, which are copied.
+Variable new_array(int count, Variable* values) {
+    Object* array = initializeArray(new_Object());
+    Array_reserveElements(array, count);
+    if ( count > 0 ) {
+        memcpy(array->elements, values, count * sizeof(Variable));
+    }
+    array->elementCount = count;
+    array->length = count;
+    return wrapObject(array);
+}
 
+Variable new_string(char* string) {
+    size_t length = strlen(string);
+    String* tmp = allocateString(length);
+    memcpy(tmp->data, string, length + 1);
+    return wrapString(tmp);
 }
 
-Variable* new_number(double value) {
-    Variable* variable = new_Variable();
-    variable->type = NUMBER_VARIABLE_TYPE;
-    double* tmp = variable->value = (double*) calloc(1, sizeof(double));
-    *tmp = value;
-    return variable;
+// The permanent strings of literals, by their atom.
+static hashtable_t* literalStrings = NULL;
+
+// The string of a literal whose characters are `atom`. Equal literals share it, and its characters, with each other and
+// with the atom.
+Variable new_literal(char* atom) {
+    if ( literalStrings == NULL ) {
+        literalStrings = ht_create(64);
+    }
+    String* string = (String*) ht_get(literalStrings, atom);
+    if ( string == NULL ) {
+        string = (String*) gc_allocate(STRING_GC_CELL_TYPE, sizeof(String));
+        gc_addRoot(string);
+        string->length = strlen(atom);
+        string->interned = true;
+        string->hashed = true;
+        string->hash = atom_hash(atom);
+        string->chars = atom;
+        ht_set(literalStrings, atom, string);
+    }
+    return wrapString(string);
 }
 
-Variable* new_string(char* string) {
-    Variable* variable = new_Variable();
-    variable->type = STRING_VARIABLE_TYPE;
-    char* tmp = variable->value = (char*) calloc(1, strlen(string)+1);
-    strcpy(tmp, string);
-    return variable;
+// Creates the strings of the NULL terminated literals of generated code, which refers to them as `cjs_strings[i]`.
+void native_internLiterals(char** literals, Variable* strings) {
+    for ( int i = 0 ; literals[i] != NULL ; i++ ) {
+        strings[i] = new_literal(atom_intern(literals[i]));
+    }
 }
 
-Variable* new_function(Return (*function)(Scope*, Object*)) {
+// Copies the characters of a rope into a buffer of its own and drops its halves. The buffer is filled from the end with
+// an explicit stack of left halves, which stays shallow for the ropes that appending in a loop builds.
+char* native_flatten(String* rope) {
+    char* chars = (char*) malloc(rope->length + 1);
+    stats_allocate(STRING_CHARS_STATS_KIND, rope->length + 1);
+    String** stack = NULL;
+    size_t size = 0;
+    size_t capacity = 0;
+    size_t end = rope->length;
+    String* string = rope;
+    chars[end] = 0;
+    for ( ; ; ) {
+        if ( string->chars == NULL ) {
+            if ( size == capacity ) {
+                capacity = capacity == 0 ? 16 : capacity * 2;
+                stack = (String**) realloc(stack, capacity * sizeof(String*));
+            }
+            stack[size++] = string->left;
+            string = string->right;
+            continue;
+        }
+        end -= string->length;
+        memcpy(chars + end, string->chars, string->length);
+        if ( size == 0 ) break;
+        string = stack[--size];
+    }
+    free(stack);
+    rope->chars = chars;
+    rope->left = NULL;
+    rope->right = NULL;
+    return chars;
+}
+
+// The ht_hash() of the characters of a string, computed once.
+uint64_t native_stringHash(String* string) {
+    if ( !string->hashed ) {
+        string->hash = ht_hash(native_stringChars(string));
+        string->hashed = true;
+    }
+    return string->hash;
+}
+
+// Concatenations shorter than this are copied right away, as a rope would not be any smaller.
+#define ROPE_MIN_LENGTH 32
+
+static Variable concatStrings(String* left, String* right) {
+    if ( left->length == 0 ) return wrapString(right);
+    if ( right->length == 0 ) return wrapString(left);
+    size_t length = (size_t) left->length + right->length;
+    if ( length > UINT32_MAX ) {
+        fprintf(stderr, "Out of memory: string of %zu characters\n", length);
+        exit(1);
+    }
+    if ( length < ROPE_MIN_LENGTH ) {
+        String* string = allocateString(length);
+        memcpy(string->data, native_stringChars(left), left->length);
+        memcpy(string->data + left->length, native_stringChars(right), right->length + 1);
+        return wrapString(string);
+    }
+    String* rope = (String*) gc_allocate(STRING_GC_CELL_TYPE, sizeof(String));
+    rope->length = length;
+    rope->left = left;
+    rope->right = right;
+    return wrapString(rope);
+}
+
+// Whether two strings have the same characters. Atoms, lengths and hashes that are known decide most of them without
+// comparing characters.
+static bool stringEquals(String* left, String* right) {
+    if ( left == right ) return true;
+    if ( left->length != right->length ) return false;
+    if ( left->interned && right->interned ) return left->chars == right->chars;
+    if ( left->hashed && right->hashed && left->hash != right->hash ) return false;
+    return memcmp(native_stringChars(left), native_stringChars(right), left->length) == 0;
+}
+
+// Whether `left` sorts before `right` by their characters.
+static bool stringLessThan(String* left, String* right) {
+    uint32_t length = left->length < right->length ? left->length : right->length;
+    char* leftChars = native_stringChars(left);
+    int order = memcmp(leftChars, native_stringChars(right), length);
+    return order != 0 ? order < 0 : left->length < right->length;
+}
+
+Variable new_function(Return (*function)(Scope*, int, Variable*)) {
     Object* object = new_Object();
-    ht_set(object->internalProperties, "call", function);
-    Variable* variable = new_Variable();
-    variable->type = OBJECT_VARIABLE_TYPE;
-    variable->value = object;
-    return variable;
+    object->function = function;
+    return wrapObject(object);
 }
 
-char* native_toString(Variable* variable) {
-    switch (variable->type) {
+// Creates an object from a literal whose keys are known at compile time, they have to be distinct atoms. The object
+// takes the shape at the end of their transitions and gets its slots in one go; a literal with more keys than a shape
+// can hold becomes a dictionary right away.
+Variable new_object(int count, char** keys, Variable* values) {
+    Object* object = new_Object();
+    if ( count > SHAPE_MAX_SLOTS ) {
+        object->shape = NULL;
+        object->properties = ht_create_bulk(count, keys, (void**) values);
+        return wrapObject(object);
+    }
+    Shape* shape = object->shape;
+    for ( int i = 0 ; i < count ; i++ ) {
+        shape = Shape_transition(shape, keys[i]);
+    }
+    Object_reserveSlots(object, count);
+    if ( count > 0 ) {
+        memcpy(object->slots, values, count * sizeof(Variable));
+    }
+    object->shape = shape;
+    return wrapObject(object);
+}
+
+// The string form of a value. Numbers are written into `buffer`, of at least NUMBER_STRING_SIZE characters, anything
+// else needs no buffer and may be given NULL for it.
+char* native_toString(Variable variable, char* buffer) {
+    switch (native_typeOf(variable)) {
         case UNDEFINED_VARIABLE_TYPE:
             return "undefined";
         case NULL_VARIABLE_TYPE:
             return "null";
         case BOOLEAN_VARIABLE_TYPE:
-            if (*(bool*)variable->value) {
+            if (variable == VARIABLE_TRUE) {
                 return "true";
             } else {
                 return "false";
             }
-        case NUMBER_VARIABLE_TYPE: {
-            char* tmp = (char*) calloc(30, sizeof(char));
-            sprintf(tmp, "%.18e", *(double*)variable->value);
-            tmp = (char*) realloc(tmp, strlen(tmp)+1);
-            return tmp;
-        }
+        case NUMBER_VARIABLE_TYPE:
+            return number_toString(native_numberValue(variable), buffer);
         case STRING_VARIABLE_TYPE:
-            return (char*) variable->value;
+            return native_stringChars(native_stringValue(variable));
         case OBJECT_VARIABLE_TYPE:
-            // TODO
-            fprintf(stderr, "Unsupported Operation: called native_toString() on an Object\n");
-            return "Unsupported Operation";
+            // TODO call a user defined toString()
+            if ( native_objectValue(variable)->isArray ) {
+                return Array_toString(native_objectValue(variable));
+            }
+            if ( native_objectValue(variable)->function != NULL ) {
+                return "function () { [native code] }";
+            }
+            return "[object Object]";
     }
 };
 
-Object* native_toObject(Variable* variable) {
-    switch (variable->type) {
+Object* native_toObject(Variable variable) {
+    switch (native_typeOf(variable)) {
         case UNDEFINED_VARIABLE_TYPE:
             fprintf(stderr, "Unsupported Operation: called native_toObject on undefined\n");
             return new_Object();
@@ -190,59 +765,295 @@ Object* native_toObject(Variable* variable) {
             fprintf(stderr, "Unsupported Operation: called native_toObject on a string\n");
             return new_Object();
         case OBJECT_VARIABLE_TYPE:
-            return (Object*) variable->value;
+            return native_objectValue(variable);
+    }
+}
+
+// Calls a function with arguments that are already evaluated, this is Object->call() for generated code and what the
+// interpreter does for functions it did not compile itself. `argv` is the caller's, the function binds its parameters
+// from it and only copies it into an `arguments` array if its body refers to `arguments`. The call runs in a region of
+// its own, so its scopes are freed as soon as it returns.
+Return native_apply(Object* object, Scope* scope, int argc, Variable* argv) {
+    if ( object->function == NULL ) {
+        // TODO this object is not a function, throw runtime exception
+        fprintf(stderr, "Unsupported Operation: object is not a function\n");
+        Return ret;
+        ret.error = "object is not a function";
+        ret.value = new_undefined();
+        return ret;
+    }
+    GcRegion region = gc_enterRegion();
+    Return ret = object->function(scope, argc, argv);
+    gc_leaveRegion(region);
+    return ret;
+}
+
+// Writes the string form of a value, numbers are formatted right into the buffer.
+static void writeValue(Output* output, Variable variable) {
+    switch (native_typeOf(variable)) {
+        case NUMBER_VARIABLE_TYPE:
+            output->size += strlen(number_toString(native_numberValue(variable), output_reserve(output, NUMBER_STRING_SIZE)));
+            break;
+        case STRING_VARIABLE_TYPE: {
+            String* string = native_stringValue(variable);
+            output_write(output, native_stringChars(string), string->length);
+        } break;
+        default: {
+            char* string = native_toString(variable, NULL);
+            output_write(output, string, strlen(string));
+        } break;
+    }
+}
+
+/*
+ * Writes a line of `format` to `output`, replacing each "%v" with the string form of the next Variable argument and
+ * each "%%" with a single "%". This is what `console.log()` and `console.error()` calls compile down to when the
+ * transpiler can prove `console` is the builtin, with the separators and any literal arguments already in `format`.
+ */
+Variable native_consoleWrite(Output* output, char* format, ...) {
+    va_list varargs;
+    va_start(varargs, format);
+    char* literal = format;
+    char* c = format;
+    while ( *c != 0 ) {
+        if ( *c != '%' ) {
+            c++;
+            continue;
+        }
+        output_write(output, literal, c - literal);
+        c++;
+        if ( *c == 'v' ) {
+            writeValue(output, va_arg(varargs, Variable));
+            c++;
+            literal = c;
+        } else if ( *c != 0 ) {
+            // "%%", the second "%" starts the next literal run
+            literal = c;
+            c++;
+        } else {
+            literal = c;
+        }
+    }
+    output_write(output, literal, c - literal);
+    output_endLine(output);
+    va_end(varargs);
+    return new_undefined();
+}
+
+static bool isStrWhiteSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+// ToNumber applied to the String type (ECMA-262 9.3.1)
+static double stringToNumber(char* string) {
+    while ( isStrWhiteSpace(*string) ) string++;
+    char* end = string + strlen(string);
+    while ( end > string && isStrWhiteSpace(end[-1]) ) end--;
+    if ( end == string ) return 0;
+    char* c = string;
+    if ( end - c > 2 && c[0] == '0' && ( c[1] == 'x' || c[1] == 'X' ) ) {
+        double number = 0;
+        for ( c += 2 ; c < end ; c++ ) {
+            if ( !isxdigit(*c) ) return NAN;
+            number = number * 16 + ( isdigit(*c) ? *c - '0' : tolower(*c) - 'a' + 10 );
+        }
+        return number;
+    }
+    double sign = 1;
+    if ( *c == '+' || *c == '-' ) {
+        if ( *c == '-' ) sign = -1;
+        c++;
+    }
+    if ( end - c == 8 && strncmp(c, "Infinity", 8) == 0 ) {
+        return sign * INFINITY;
+    }
+    // strtod() accepts more than a StrDecimalLiteral (hex floats, "nan", "inf"...), so validate the syntax first
+    char* digits = c;
+    int count = 0;
+    while ( c < end && isdigit(*c) ) { c++; count++; }
+    if ( c < end && *c == '.' ) {
+        c++;
+        while ( c < end && isdigit(*c) ) { c++; count++; }
+    }
+    if ( count == 0 ) return NAN;
+    if ( c < end && ( *c == 'e' || *c == 'E' ) ) {
+        c++;
+        if ( c < end && ( *c == '+' || *c == '-' ) ) c++;
+        if ( c == end || !isdigit(*c) ) return NAN;
+        while ( c < end && isdigit(*c) ) c++;
+    }
+    if ( c != end ) return NAN;
+    return sign * strtod(digits, NULL);
+}
+
+// ToString (ECMA-262 9.8) of a primitive as a string value
+static Variable toStringValue(Variable variable) {
+    char buffer[NUMBER_STRING_SIZE];
+    return new_string(native_toString(variable, buffer));
+}
+
+// ToPrimitive (ECMA-262 9.1), objects become their string form
+static Variable toPrimitive(Variable variable) {
+    if ( native_typeOf(variable) == OBJECT_VARIABLE_TYPE ) {
+        return new_string(native_toString(variable, NULL));
+    }
+    return variable;
+}
+
+double native_toNumberSlow(Variable variable) {
+    switch (native_typeOf(variable)) {
+        case UNDEFINED_VARIABLE_TYPE:
+            return NAN;
+        case NULL_VARIABLE_TYPE:
+            return 0;
+        case BOOLEAN_VARIABLE_TYPE:
+            return variable == VARIABLE_TRUE ? 1 : 0;
+        case NUMBER_VARIABLE_TYPE:
+            return native_numberValue(variable);
+        case STRING_VARIABLE_TYPE:
+            return stringToNumber(native_stringChars(native_stringValue(variable)));
+        case OBJECT_VARIABLE_TYPE:
+            return stringToNumber(native_toString(variable, NULL));
     }
+    return NAN;
 }
 
-static Return Console_log(Scope* scope, Object* arguments) {
-    double* count = (double*) arguments->getProperty(arguments, "length")->value;
-    for ( int i = 0 ; i < *count ; i++ ) {
+// ToInt32 (ECMA-262 9.5) for numbers outside of the int32 range
+int32_t native_toInt32Slow(double number) {
+    if ( isnan(number) || isinf(number) ) return 0;
+    double int32bit = fmod(trunc(number), 4294967296.0);
+    if ( int32bit < 0 ) int32bit += 4294967296.0;
+    return (int32_t) (uint32_t) int32bit;
+}
+
+// The addition operator (ECMA-262 11.6.1)
+Variable native_addSlow(Variable left, Variable right) {
+    left = toPrimitive(left);
+    right = toPrimitive(right);
+    if ( native_typeOf(left) != STRING_VARIABLE_TYPE && native_typeOf(right) != STRING_VARIABLE_TYPE ) {
+        return new_number(native_toNumber(left) + native_toNumber(right));
+    }
+    if ( native_typeOf(left) != STRING_VARIABLE_TYPE ) {
+        left = toStringValue(left);
+    }
+    if ( native_typeOf(right) != STRING_VARIABLE_TYPE ) {
+        right = toStringValue(right);
+    }
+    return concatStrings(native_stringValue(left), native_stringValue(right));
+}
+
+/*
+ * The abstract relational comparison `left < right` (ECMA-262 11.8.5).
+ * Returns 1 for true, 0 for false and -1 for undefined (a NaN was involved).
+ */
+int native_compareSlow(Variable left, Variable right) {
+    left = toPrimitive(left);
+    right = toPrimitive(right);
+    if ( native_typeOf(left) == STRING_VARIABLE_TYPE && native_typeOf(right) == STRING_VARIABLE_TYPE ) {
+        return stringLessThan(native_stringValue(left), native_stringValue(right));
+    }
+    double leftNumber = native_toNumber(left);
+    double rightNumber = native_toNumber(right);
+    if ( isnan(leftNumber) || isnan(rightNumber) ) return -1;
+    return leftNumber < rightNumber;
+}
+
+// The abstract equality comparison `left == right` (ECMA-262 11.9.3)
+bool native_equalsSlow(Variable left, Variable right) {
+    VariableType leftType = native_typeOf(left);
+    VariableType rightType = native_typeOf(right);
+    if ( leftType == rightType ) {
+        return native_strictEqualsSlow(left, right);
+    }
+    if ( ( leftType == UNDEFINED_VARIABLE_TYPE || leftType == NULL_VARIABLE_TYPE )
+            && ( rightType == UNDEFINED_VARIABLE_TYPE || rightType == NULL_VARIABLE_TYPE ) ) {
+        return true;
+    }
+    if ( leftType == UNDEFINED_VARIABLE_TYPE || leftType == NULL_VARIABLE_TYPE
+            || rightType == UNDEFINED_VARIABLE_TYPE || rightType == NULL_VARIABLE_TYPE ) {
+        return false;
+    }
+    if ( leftType == OBJECT_VARIABLE_TYPE || rightType == OBJECT_VARIABLE_TYPE ) {
+        return native_equalsSlow(toPrimitive(left), toPrimitive(right));
+    }
+    // what is left are mixed booleans, numbers and strings, which all compare as numbers
+    return native_toNumber(left) == native_toNumber(right);
+}
+
+// The strict equality comparison `left === right` (ECMA-262 11.9.6)
+bool native_strictEqualsSlow(Variable left, Variable right) {
+    if ( native_typeOf(left) != native_typeOf(right) ) {
+        return false;
+    }
+    switch (native_typeOf(left)) {
+        case UNDEFINED_VARIABLE_TYPE:
+        case NULL_VARIABLE_TYPE:
+        case BOOLEAN_VARIABLE_TYPE:
+        case OBJECT_VARIABLE_TYPE:
+            return left == right;
+        case NUMBER_VARIABLE_TYPE:
+            return native_numberValue(left) == native_numberValue(right);
+        case STRING_VARIABLE_TYPE:
+            return stringEquals(native_stringValue(left), native_stringValue(right));
+    }
+    return false;
+}
+
+static Return Console_log(Scope* scope, int argc, Variable* argv) {
+    for ( int i = 0 ; i < argc ; i++ ) {
         if ( i > 0 ) {
-            fprintf(stdout, "%s", " ");
+            output_char(&output_stdout, ' ');
         }
-        char* tmp = (char*) calloc(20, sizeof(char));
-        sprintf(tmp, "%i", i);
-        Variable* argument = arguments->getProperty(arguments, tmp);
-        free(tmp);
-        fprintf(stdout, "%s", native_toString(argument)); // TODO memory leak
+        writeValue(&output_stdout, argv[i]);
     }
-    fprintf(stdout, "%s", "\n");
+    output_endLine(&output_stdout);
     Return ret;
     ret.value = new_undefined();
     return ret;
 }
 
-static Return Console_error(Scope* scope, Object* arguments) {
-    double* count = (double*) arguments->getProperty(arguments, "length")->value;
-    for ( int i = 0 ; i < *count ; i++ ) {
+static Return Console_error(Scope* scope, int argc, Variable* argv) {
+    for ( int i = 0 ; i < argc ; i++ ) {
         if ( i > 0 ) {
-            fprintf(stderr, "%s", " ");
+            output_char(&output_stderr, ' ');
         }
-        char* tmp = (char*) calloc(20, sizeof(char));
-        sprintf(tmp, "%i", i);
-        Variable* argument = arguments->getProperty(arguments, tmp);
-        free(tmp);
-        fprintf(stderr, "%s", native_toString(argument)); // TODO memory leak
+        writeValue(&output_stderr, argv[i]);
     }
-    fprintf(stderr, "%s", "\n");
+    output_endLine(&output_stderr);
     Return ret;
     ret.value = new_undefined();
     return ret;
 }
 
-static void define_console(Scope* global) {
-    global->defineVariable(global, "console");
-    Variable* console_var = new_Variable();
-    global->setVariable(global, "console", console_var);
-    console_var->type = OBJECT_VARIABLE_TYPE;
-    Object* console_object = new_Object();
-    console_var->value = console_object;
-    console_object->setProperty(console_object, "log", new_function(Console_log));
-    console_object->setProperty(console_object, "error", new_function(Console_error));
+static StaticObject consoleLog = STATIC_FUNCTION(consoleLog, Console_log);
+static StaticObject consoleError = STATIC_FUNCTION(consoleError, Console_error);
+static StaticObject console = STATIC_OBJECT(console);
+static GlobalCell consoleCell = { STATIC_VARIABLE(console), true, false };
+
+// Binds a builtin global the first time it is looked up, or returns NULL for any other name. Most programs never look
+// up `console`, generated code writes to it with native_consoleWrite() instead.
+static GlobalCell* builtinCell(char* name) {
+    if ( name != ATOM("console") ) return NULL;
+    console.object.setProperty(&console.object, ATOM("log"), STATIC_VARIABLE(consoleLog));
+    console.object.setProperty(&console.object, ATOM("error"), STATIC_VARIABLE(consoleError));
+    native_defineGlobals(1, &name, &consoleCell);
+    return &consoleCell;
+}
+
+// Whether `console` is still the builtin, with its own log and error. Other code linked into the program, such as a
+// module, may have replaced either, so the console.log() calls of modules, and of programs that require them, check
+// this before they write with native_consoleWrite().
+bool native_isBuiltinConsole(Variable value) {
+    Object* object = &console.object;
+    return value == STATIC_VARIABLE(console) && object->shape != NULL && object->shape->slotCount == 2
+        && object->slots[0] == STATIC_VARIABLE(consoleLog) && object->slots[1] == STATIC_VARIABLE(consoleError);
 }
 
 void initialize_runtime(Scope* global) {
-    define_console(global);
+    global->defineVariable = GlobalScope_defineVariable;
+    global->getVariable = GlobalScope_getVariable;
+    global->setVariable = GlobalScope_setVariable;
+    gc_addRoot(global);
 }
 
 
@@ -2,27 +2,69 @@
 #define RUNTIME_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "atom.h"
+#include "gc.h"
 #include "hashtable.h"
+#include "output.h"
+#include "stats.h"
 
 typedef enum VariableType VariableType;
 
+typedef uint64_t Variable;
 typedef struct Scope Scope;
-typedef struct Variable Variable;
 typedef struct Object Object;
+typedef struct String String;
+typedef struct Shape Shape;
+typedef struct PropertyCache PropertyCache;
+typedef struct GlobalCell GlobalCell;
+typedef struct GlobalCache GlobalCache;
+typedef struct StaticObject StaticObject;
 typedef struct Return Return;
 
 void initialize_runtime(Scope*);
 Scope* new_Scope(Scope*);
+Scope* new_PermanentScope(Scope*);
+Scope* native_globalScope(Scope*);
+void native_addRoot(Variable);
 Object* new_Object();
-Variable* new_undefined();
-Variable* new_null();
-Variable* new_boolean(bool);
-Variable* new_number(double);
-Variable* new_string(char*);
-Variable* new_function(Return (*)(Scope*, Object*));
+Variable new_string(char*);
+Variable new_literal(char*);
+void native_internLiterals(char**, Variable*);
+Variable new_function(Return (*)(Scope*, int, Variable*));
+Variable new_object(int, char**, Variable*);
+Variable new_array(int, Variable*);
 
-char* native_toString(Variable*);
-Object* native_toObject(Variable*);
+char* native_toString(Variable, char*);
+char* native_flatten(String*);
+uint64_t native_stringHash(String*);
+char* native_toPropertyKey(Variable);
+Object* native_toObject(Variable);
+Return native_apply(Object*, Scope*, int, Variable*);
+Variable native_getPropertyMiss(Object*, char*, PropertyCache*);
+Variable native_setPropertyMiss(Object*, char*, Variable, PropertyCache*);
+Variable native_getElementSlow(Object*, Variable);
+Variable native_setElementSlow(Object*, Variable, Variable);
+void native_shadowGlobal(char*);
+Variable native_getGlobalMiss(Scope*, char*, GlobalCache*);
+Variable native_setGlobalMiss(Scope*, char*, Variable, GlobalCache*);
+void native_defineGlobals(int, char**, GlobalCell*);
+Variable Object_getProperty(Object*, char*);
+Variable Object_setProperty(Object*, char*, Variable);
+
+extern Shape native_emptyShape;
+extern hashtable_t* native_globalCells;
+extern uint32_t native_globalVersion;
+Variable native_consoleWrite(Output*, char*, ...);
+bool native_isBuiltinConsole(Variable);
+
+double native_toNumberSlow(Variable);
+int32_t native_toInt32Slow(double);
+Variable native_addSlow(Variable, Variable);
+int native_compareSlow(Variable, Variable);
+bool native_equalsSlow(Variable, Variable);
+bool native_strictEqualsSlow(Variable, Variable);
 
 enum VariableType {
     UNDEFINED_VARIABLE_TYPE,
@@ -37,26 +79,438 @@ struct Scope {
     Scope* parent;
     hashtable_t* hashtable;
     void (*defineVariable)(Scope*, char*);
-    Variable* (*getVariable)(Scope*, char*);
-    void (*setVariable)(Scope*, char*, Variable*);
+    Variable (*getVariable)(Scope*, char*);
+    Variable (*setVariable)(Scope*, char*, Variable);
 };
 
-struct Variable {
-    enum VariableType type;
-    void* value;
+#define OBJECT_INLINE_SLOTS     4
+#define SHAPE_MAX_SLOTS         32 // an object that gets more properties switches to a hashtable of its own
+#define PROPERTY_CACHE_ENTRIES  4
+
+// Objects that got the same properties in the same order share a shape, which maps each of their names to a slot. The
+// shapes form a tree of transitions from the empty shape, one property at a time, and live as long as the program.
+struct Shape {
+    Shape* parent;
+    char* key;                 // of the last slot, NULL for the empty shape
+    int slotCount;
+    hashtable_t* transitions;  // the shapes with one more property, by its name
 };
 
 struct Object {
-    hashtable_t* properties;
+    Shape* shape;              // NULL once the object is a dictionary
+    Variable* slots;           // the values of the properties of the shape, inlineSlots at first
+    int slotCapacity;
+    hashtable_t* properties;   // of a dictionary
     hashtable_t* internalProperties;
-    Variable* (*getProperty)(Object*, char*);
-    void (*setProperty)(Object*, char*, Variable*);
-    Return (*call)(Object*, Scope*, int, ...);
+    bool isArray;
+    uint32_t length;           // of an array
+    Variable* elements;        // the dense elements 0 to elementCount - 1 of an array, the others are properties
+    uint32_t elementCount;
+    uint32_t elementCapacity;
+    Variable (*getProperty)(Object*, char*);
+    Variable (*setProperty)(Object*, char*, Variable);
+    Return (*call)(Object*, Scope*, int, Variable*);
+    Return (*function)(Scope*, int, Variable*); // that a function object runs, NULL for any other object
+    Variable inlineSlots[OBJECT_INLINE_SLOTS];
+};
+
+// An object in static data, see STATIC_OBJECT below.
+struct StaticObject {
+    GcCell cell;
+    Object object;
+};
+
+// The inline cache of a property access in generated code: the slots of the property in the shapes seen there. For an
+// assignment that adds the property, newShape is the shape the object transitions to, otherwise it equals shape.
+struct PropertyCache {
+    int count;
+    struct {
+        Shape* shape;
+        Shape* newShape;
+        int slot;
+    } entries[PROPERTY_CACHE_ENTRIES];
+};
+
+/*
+ * Strings are immutable and know their length. `a + b` of strings that are not short makes a rope, a String that only
+ * points to its two halves, so building a long string piece by piece copies every piece once rather than the whole
+ * string every time. A rope is flattened into one buffer the first time its characters are needed, and then drops its
+ * halves.
+ *
+ * String literals are interned: all equal literals share one permanent String whose characters are the atom of the
+ * literal, see new_literal(). Any other string is interned the first time it is used as a property key.
+ */
+struct String {
+    uint32_t length;
+    bool interned;             // chars is an atom
+    bool hashed;               // hash is computed, see native_stringHash()
+    uint64_t hash;
+    char* chars;               // NULL while the string is a rope, allocated on its own once a rope is flattened
+    String* left;              // the halves of a rope
+    String* right;
+    char data[];               // the characters of a string that was created flat
+};
+
+struct GlobalCell {
+    Variable value;
+    bool declared;             // by the global scope
+    bool shadowed;             // some other scope declares the name as well
+};
+
+// Where generated code found a global, valid while version is native_globalVersion. A NULL cell means the name is not
+// a global that can be cached, and is looked up through the scope chain.
+struct GlobalCache {
+    GlobalCell* cell;
+    uint32_t version;
 };
 
 struct Return {
     char* error;
-    Variable* value;
+    Variable value;
 };
 
+/*
+ * Values.
+ *
+ * A Variable is a single 64 bit word that is passed by value. Numbers are the bits of their double (with every NaN
+ * canonicalized to one) plus 2^49, which lifts all of them above 2^49 and leaves the words below for everything else:
+ * the constants undefined, null, false and true, and pointers to the heap, which user space addresses never exceed. A
+ * string points to its String with the lowest bit set, an object is a plain pointer to its Object. So only strings
+ * and objects allocate, and as no value is 0, hashtables can still use NULL for a missing entry.
+ */
+
+#define VARIABLE_NUMBER_OFFSET 0x0002000000000000ULL
+#define VARIABLE_CANONICAL_NAN 0x7FF8000000000000ULL
+#define VARIABLE_NULL          0x02ULL
+#define VARIABLE_FALSE         0x06ULL
+#define VARIABLE_TRUE          0x07ULL
+#define VARIABLE_UNDEFINED     0x0AULL
+#define VARIABLE_STRING_TAG    0x01ULL
+
+static inline Variable new_undefined() {
+    return VARIABLE_UNDEFINED;
+}
+
+static inline Variable new_null() {
+    return VARIABLE_NULL;
+}
+
+static inline Variable new_boolean(bool value) {
+    return value ? VARIABLE_TRUE : VARIABLE_FALSE;
+}
+
+static inline Variable new_number(double value) {
+    uint64_t bits = VARIABLE_CANONICAL_NAN;
+    if ( value == value ) {
+        __builtin_memcpy(&bits, &value, sizeof(double));
+    }
+    return bits + VARIABLE_NUMBER_OFFSET;
+}
+
+static inline bool native_isNumber(Variable variable) {
+    return variable >= VARIABLE_NUMBER_OFFSET;
+}
+
+static inline double native_numberValue(Variable variable) {
+    uint64_t bits = variable - VARIABLE_NUMBER_OFFSET;
+    double value;
+    __builtin_memcpy(&value, &bits, sizeof(double));
+    return value;
+}
+
+static inline String* native_stringValue(Variable variable) {
+    return (String*) (uintptr_t) ( variable & ~VARIABLE_STRING_TAG );
+}
+
+// The characters of a string, NUL terminated, flattening it first if it is a rope.
+static inline char* native_stringChars(String* string) {
+    return string->chars != NULL ? string->chars : native_flatten(string);
+}
+
+static inline Object* native_objectValue(Variable variable) {
+    return (Object*) (uintptr_t) variable;
+}
+
+static inline VariableType native_typeOf(Variable variable) {
+    if ( native_isNumber(variable) ) {
+        return NUMBER_VARIABLE_TYPE;
+    }
+    switch (variable) {
+        case VARIABLE_UNDEFINED:
+            return UNDEFINED_VARIABLE_TYPE;
+        case VARIABLE_NULL:
+            return NULL_VARIABLE_TYPE;
+        case VARIABLE_FALSE:
+        case VARIABLE_TRUE:
+            return BOOLEAN_VARIABLE_TYPE;
+        default:
+            return variable & VARIABLE_STRING_TAG ? STRING_VARIABLE_TYPE : OBJECT_VARIABLE_TYPE;
+    }
+}
+
+// Values handed to generated code are kept on the shadow stack until its next safepoint, see gc.h.
+static inline Variable native_root(Variable variable) {
+    switch (native_typeOf(variable)) {
+        case STRING_VARIABLE_TYPE:
+            gc_push(native_stringValue(variable));
+            break;
+        case OBJECT_VARIABLE_TYPE:
+            gc_push(native_objectValue(variable));
+            break;
+        default:
+            break;
+    }
+    return variable;
+}
+
+/*
+ * Property access.
+ *
+ * Generated code gives every `object.name` a static PropertyCache. When the object has a shape the cache has seen, the
+ * access is a compare and a load or store; otherwise the *Miss functions do the full lookup and add the shape to the
+ * cache, up to PROPERTY_CACHE_ENTRIES of them. Properties found on a prototype, and objects that are dictionaries, are
+ * never cached.
+ */
+
+static inline Variable native_getCachedProperty(Object* object, char* name, PropertyCache* cache) {
+    for ( int i = 0 ; i < cache->count ; i++ ) {
+        if ( cache->entries[i].shape == object->shape ) {
+            return native_root(object->slots[cache->entries[i].slot]);
+        }
+    }
+    return native_getPropertyMiss(object, name, cache);
+}
+
+static inline Variable native_setCachedProperty(Object* object, char* name, Variable property, PropertyCache* cache) {
+    for ( int i = 0 ; i < cache->count ; i++ ) {
+        if ( cache->entries[i].shape == object->shape && cache->entries[i].slot < object->slotCapacity ) {
+            object->shape = cache->entries[i].newShape;
+            object->slots[cache->entries[i].slot] = property;
+            return property;
+        }
+    }
+    return native_setPropertyMiss(object, name, property, cache);
+}
+
+/*
+ * Elements.
+ *
+ * `object[key]` in generated code goes through these. For an array and a number that is the index of one of its dense
+ * elements, that is a bounds check and a load or store, with no property key built at all. Anything else, like
+ * appending to an array, a hole, or any other object, converts the key with native_toPropertyKey() in the *Slow
+ * functions.
+ */
+
+static inline bool native_isElement(Object* object, Variable key) {
+    if ( !object->isArray || !native_isNumber(key) ) return false;
+    double index = native_numberValue(key);
+    return index >= 0 && index < object->elementCount && index == (uint32_t) index;
+}
+
+static inline Variable native_getElement(Object* object, Variable key) {
+    if ( native_isElement(object, key) ) {
+        return native_root(object->elements[(uint32_t) native_numberValue(key)]);
+    }
+    return native_getElementSlow(object, key);
+}
+
+static inline Variable native_setElement(Object* object, Variable key, Variable value) {
+    if ( native_isElement(object, key) ) {
+        object->elements[(uint32_t) native_numberValue(key)] = value;
+        return value;
+    }
+    return native_setElementSlow(object, key, value);
+}
+
+// The argument at `index` of a call, functions bind their parameters straight from the `argv` they were called with.
+static inline Variable native_argument(int argc, Variable* argv, uint32_t index) {
+    return index < (uint32_t) argc ? native_root(argv[index]) : new_undefined();
+}
+
+/*
+ * Global variables.
+ *
+ * Generated code reads and assigns names that may be globals through a static GlobalCache per site, so a global like
+ * `console` or a top level function costs a version compare and a load, however deep the scope chain is.
+ */
+
+static inline Variable native_getGlobal(Scope* scope, char* name, GlobalCache* cache) {
+    if ( cache->version != native_globalVersion ) {
+        return native_getGlobalMiss(scope, name, cache);
+    }
+    if ( cache->cell == NULL ) {
+        return scope->getVariable(scope, name);
+    }
+    return native_root(cache->cell->value);
+}
+
+// Declares a variable in a scope other than the global one. `shadowing` is a static of the declaring site, so that the
+// name is only announced with native_shadowGlobal() the first time the site runs.
+static inline void native_defineLocal(Scope* scope, char* name, bool* shadowing) {
+    if ( !*shadowing ) {
+        *shadowing = true;
+        native_shadowGlobal(name);
+    }
+    scope->defineVariable(scope, name);
+}
+
+static inline Variable native_setGlobal(Scope* scope, char* name, Variable variable, GlobalCache* cache) {
+    if ( cache->version != native_globalVersion ) {
+        return native_setGlobalMiss(scope, name, variable, cache);
+    }
+    if ( cache->cell == NULL ) {
+        return scope->setVariable(scope, name, variable);
+    }
+    cache->cell->value = variable;
+    return variable;
+}
+
+/*
+ * Access sites.
+ *
+ * With `transpiler --profile-sites`, generated code evaluates the operands of an access first, then marks its site as
+ * the one whose lookups the stats count, see StatsSite in stats.h, and passes the result through native_leaveSite().
+ */
+
+static inline void native_enterSite(StatsSite* site) {
+    if ( site->hits == 0 ) {
+        stats_registerSite(site);
+    }
+    site->hits += 1;
+    stats_site = site;
+}
+
+static inline Variable native_leaveSite(Variable variable) {
+    if ( variable == VARIABLE_UNDEFINED && !stats_site->write ) {
+        stats_site->undefinedReads += 1;
+    }
+    stats_site = NULL;
+    return variable;
+}
+
+/*
+ * Static data.
+ *
+ * Top level functions and the builtins are objects in static data, ready when the process starts, rather than allocated
+ * by the code that runs first. They are ordinary writable objects otherwise: a property assigned to one is stored in
+ * its slots in place, and the collector traces them while they are reachable but never frees them. A program binds its
+ * top level functions to global cells that are static data as well, with native_defineGlobals(), and the builtins are
+ * only bound the first time a program looks one of them up.
+ */
+
+#define STATIC_FUNCTION(name, cFunction) { GC_STATIC_CELL(OBJECT_GC_CELL_TYPE), { \
+    .shape = &native_emptyShape, \
+    .slots = (name).object.inlineSlots, \
+    .slotCapacity = OBJECT_INLINE_SLOTS, \
+    .getProperty = Object_getProperty, \
+    .setProperty = Object_setProperty, \
+    .call = native_apply, \
+    .function = (cFunction) } }
+
+#define STATIC_OBJECT(name) STATIC_FUNCTION(name, NULL)
+
+#define STATIC_VARIABLE(staticObject) ( (Variable) (uintptr_t) &(staticObject).object )
+
+/*
+ * Operator fast paths.
+ *
+ * Generated code calls these for JS operators whose operand types are not known at compile time. The common case of
+ * two numbers is handled inline without allocating; everything else (string concatenation, coercions, comparisons of
+ * mixed types) goes through the out-of-line `*Slow` functions in runtime.c, which implement the full ECMAScript
+ * semantics. Comparisons produce a C `bool`, which generated code boxes with new_boolean() (a shared constant) only
+ * when the result is used as a value.
+ */
+
+static inline bool native_isNumbers(Variable left, Variable right) {
+    return native_isNumber(left) && native_isNumber(right);
+}
+
+static inline double native_toNumber(Variable variable) {
+    if ( native_isNumber(variable) ) {
+        return native_numberValue(variable);
+    }
+    return native_toNumberSlow(variable);
+}
+
+static inline bool native_numberToBoolean(double number) {
+    return number == number && number != 0; // NaN is the only value not equal to itself
+}
+
+static inline bool native_toBoolean(Variable variable) {
+    switch (native_typeOf(variable)) {
+        case UNDEFINED_VARIABLE_TYPE:
+        case NULL_VARIABLE_TYPE:
+            return false;
+        case BOOLEAN_VARIABLE_TYPE:
+            return variable == VARIABLE_TRUE;
+        case NUMBER_VARIABLE_TYPE:
+            return native_numberToBoolean(native_numberValue(variable));
+        case STRING_VARIABLE_TYPE:
+            return native_stringValue(variable)->length != 0;
+        case OBJECT_VARIABLE_TYPE:
+            return true;
+    }
+    return false;
+}
+
+static inline int32_t native_toInt32(double number) {
+    if ( number >= -2147483648.0 && number <= 2147483647.0 ) {
+        return (int32_t) number;
+    }
+    return native_toInt32Slow(number);
+}
+
+static inline uint32_t native_toUint32(double number) {
+    return (uint32_t) native_toInt32(number);
+}
+
+static inline Variable native_add(Variable left, Variable right) {
+    if ( native_isNumbers(left, right) ) {
+        return new_number(native_numberValue(left) + native_numberValue(right));
+    }
+    return native_addSlow(left, right);
+}
+
+static inline bool native_lessThan(Variable left, Variable right) {
+    if ( native_isNumbers(left, right) ) {
+        return native_numberValue(left) < native_numberValue(right);
+    }
+    return native_compareSlow(left, right) == 1;
+}
+
+static inline bool native_greaterThan(Variable left, Variable right) {
+    if ( native_isNumbers(left, right) ) {
+        return native_numberValue(left) > native_numberValue(right);
+    }
+    return native_compareSlow(right, left) == 1;
+}
+
+static inline bool native_lessThanOrEqual(Variable left, Variable right) {
+    if ( native_isNumbers(left, right) ) {
+        return native_numberValue(left) <= native_numberValue(right);
+    }
+    return native_compareSlow(right, left) == 0;
+}
+
+static inline bool native_greaterThanOrEqual(Variable left, Variable right) {
+    if ( native_isNumbers(left, right) ) {
+        return native_numberValue(left) >= native_numberValue(right);
+    }
+    return native_compareSlow(left, right) == 0;
+}
+
+static inline bool native_equals(Variable left, Variable right) {
+    if ( native_isNumbers(left, right) ) {
+        return native_numberValue(left) == native_numberValue(right);
+    }
+    return native_equalsSlow(left, right);
+}
+
+static inline bool native_strictEquals(Variable left, Variable right) {
+    if ( native_isNumbers(left, right) ) {
+        return native_numberValue(left) == native_numberValue(right);
+    }
+    return native_strictEqualsSlow(left, right);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static SlabAllocator* allocators = NULL;
+
+// Cells are rounded up to a multiple of this, so every cell of a slab stays aligned for any struct.
+#define SLAB_CELL_ALIGNMENT 16
+
+static size_t cellSize(SlabAllocator* allocator) {
+    return ( allocator->cellSize + SLAB_CELL_ALIGNMENT - 1 ) & ~( (size_t) SLAB_CELL_ALIGNMENT - 1 );
+}
+
+static void grow(SlabAllocator* allocator) {
+    size_t size = cellSize(allocator);
+    size_t count = SLAB_BYTES / size > 0 ? SLAB_BYTES / size : 1;
+    size_t bytes = ( count * size + SLAB_ALIGNMENT - 1 ) & ~( (size_t) SLAB_ALIGNMENT - 1 );
+    char* slab = (char*) aligned_alloc(SLAB_ALIGNMENT, bytes);
+    if ( slab == NULL ) {
+        fprintf(stderr, "Out of memory: slab of %zu bytes for %s cells\n", bytes, allocator->name);
+        exit(1);
+    }
+    // thread the cells in address order, so consecutive allocations are adjacent
+    for ( size_t i = count ; i > 0 ; i-- ) {
+        void** cell = (void**) ( slab + ( i - 1 ) * size );
+        *cell = allocator->freeList;
+        allocator->freeList = cell;
+    }
+    if ( allocator->slabCount == 0 ) {
+        allocator->next = allocators;
+        allocators = allocator;
+    }
+    allocator->totalCells += count;
+    allocator->slabCount += 1;
+}
+
+// Returns a zeroed cell, like calloc().
+void* slab_allocate(SlabAllocator* allocator) {
+    if ( allocator->freeList == NULL ) {
+        grow(allocator);
+    }
+    void** cell = (void**) allocator->freeList;
+    allocator->freeList = *cell;
+    allocator->liveCells += 1;
+    memset(cell, 0, cellSize(allocator));
+    return cell;
+}
+
+void slab_free(SlabAllocator* allocator, void* cell) {
+    *(void**) cell = allocator->freeList;
+    allocator->freeList = cell;
+    allocator->liveCells -= 1;
+}
+
+// The first of `count` allocators, ordered by growing cell size, whose cells hold `size` bytes, or NULL if even the
+// cells of the last one are too small.
+SlabAllocator* slab_sizeClass(SlabAllocator* classes, int count, size_t size) {
+    for ( int i = 0 ; i < count ; i++ ) {
+        if ( size <= classes[i].cellSize ) {
+            return &classes[i];
+        }
+    }
+    return NULL;
+}
+
+// Every allocator that got a slab so far, most recent first, linked through `next`.
+SlabAllocator* slab_allocators() {
+    return allocators;
+}
+
+void slab_printStats(FILE* file) {
+    for ( SlabAllocator* allocator = allocators ; allocator != NULL ; allocator = allocator->next ) {
+        fprintf(file, "slab: %zu live of %zu %s cells of %zu bytes in %zu slabs\n",
+            allocator->liveCells,
+            allocator->totalCells,
+            allocator->name,
+            cellSize(allocator),
+            allocator->slabCount);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * Fixed-size cells carved out of cache-line-aligned slabs, for the small structs the runtime allocates by the million.
+ * Every type of cell gets an allocator of its own, so cells of one size share slabs and a freed cell is reused by the
+ * next allocation of its type without going through malloc:
+ *
+ *     static SlabAllocator pairs = SLAB_ALLOCATOR("pair", sizeof(entry_t));
+ *     entry_t* pair = slab_allocate(&pairs);
+ *     slab_free(&pairs, pair);
+ *
+ * When its free list runs empty, an allocator gets a whole slab at once and threads all of its cells onto the list.
+ * Slabs are kept for the rest of the program. Variably sized data like strings is spread over several allocators, one
+ * per size class, see slab_sizeClass().
+ */
+
+#define SLAB_BYTES      (16 << 10)
+#define SLAB_ALIGNMENT  64 // a cache line
+#define SLAB_ALLOCATOR(name, cellSize) { name, cellSize, NULL, 0, 0, 0, NULL }
+
+typedef struct SlabAllocator SlabAllocator;
+
+struct SlabAllocator {
+    char* name;
+    size_t cellSize;
+    void* freeList;
+    size_t liveCells;        // allocated and not freed yet
+    size_t totalCells;       // in all slabs of this allocator, live or free
+    size_t slabCount;
+    SlabAllocator* next;     // in the list of every allocator that got a slab, see slab_allocators()
+};
+
+void* slab_allocate(SlabAllocator*);
+void slab_free(SlabAllocator*, void*);
+SlabAllocator* slab_sizeClass(SlabAllocator*, int, size_t);
+SlabAllocator* slab_allocators();
+void slab_printStats(FILE*);
+
+#endif
@@ -0,0 +1,235 @@
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "gc.h"
+#include "hashtable.h"
+#include "runtime.h"
+
+#define LABEL_CHARS 40
+
+// The cells written so far, an open addressing set of pointers that is kept at most half full.
+static void** visited = NULL;
+static size_t visitedCapacity = 0;
+static size_t visitedCount = 0;
+
+// The cells whose references are still to be written.
+static void** pending = NULL;
+static size_t pendingCount = 0;
+static size_t pendingCapacity = 0;
+
+static size_t slotOf(void* cell, size_t capacity) {
+    uint64_t hash = (uint64_t) (uintptr_t) cell * 0x9E3779B97F4A7C15ULL;
+    return ( hash >> 32 ) & ( capacity - 1 );
+}
+
+static bool insertVisited(void* cell) {
+    size_t i = slotOf(cell, visitedCapacity);
+    for ( ; visited[i] != NULL ; i = ( i + 1 ) & ( visitedCapacity - 1 ) ) {
+        if ( visited[i] == cell ) return false;
+    }
+    visited[i] = cell;
+    visitedCount += 1;
+    return true;
+}
+
+// Whether the cell is new, it is remembered as visited either way.
+static bool visit(void* cell) {
+    if ( ( visitedCount + 1 ) * 2 > visitedCapacity ) {
+        void** old = visited;
+        size_t oldCapacity = visitedCapacity;
+        visitedCapacity = visitedCapacity == 0 ? 1024 : visitedCapacity * 2;
+        visited = (void**) calloc(visitedCapacity, sizeof(void*));
+        visitedCount = 0;
+        for ( size_t i = 0 ; i < oldCapacity ; i++ ) {
+            if ( old[i] != NULL ) {
+                insertVisited(old[i]);
+            }
+        }
+        free(old);
+    }
+    return insertVisited(cell);
+}
+
+// Writes the cell later, unless it was already.
+static void push(void* cell) {
+    if ( !visit(cell) ) return;
+    if ( pendingCount == pendingCapacity ) {
+        pendingCapacity = pendingCapacity == 0 ? 1024 : pendingCapacity * 2;
+        pending = (void**) realloc(pending, pendingCapacity * sizeof(void*));
+    }
+    pending[pendingCount++] = cell;
+}
+
+static void writeEscaped(FILE* file, char* chars, size_t length) {
+    for ( size_t i = 0 ; i < length ; i++ ) {
+        unsigned char c = (unsigned char) chars[i];
+        if ( c <= ' ' || c >= 0x7F || c == '%' ) {
+            fprintf(file, "%%%02X", c);
+        } else {
+            fputc(c, file);
+        }
+    }
+}
+
+static void writeEdge(FILE* file, void* from, void* to, char* kind, char* name) {
+    fprintf(file, "edge %lx %lx %s", (unsigned long) (uintptr_t) from, (unsigned long) (uintptr_t) to, kind);
+    writeEscaped(file, name, strlen(name));
+    fputc('\n', file);
+}
+
+// A reference to a value: an edge to the string or object, or the type of any other value.
+static void writeReference(FILE* file, void* from, Variable value, char* kind, char* name) {
+    void* cell;
+    switch (native_typeOf(value)) {
+        case STRING_VARIABLE_TYPE:
+            cell = native_stringValue(value);
+            break;
+        case OBJECT_VARIABLE_TYPE:
+            cell = native_objectValue(value);
+            break;
+        default: {
+            static char* types[] = { "undefined", "null", "boolean", "number" };
+            fprintf(file, "value %lx %s %s", (unsigned long) (uintptr_t) from, types[native_typeOf(value)], kind);
+            writeEscaped(file, name, strlen(name));
+            fputc('\n', file);
+            return;
+        }
+    }
+    writeEdge(file, from, cell, kind, name);
+    push(cell);
+}
+
+static size_t hashtableBytes(hashtable_t* hashtable) {
+    return hashtable == NULL ? 0 : sizeof(hashtable_t) + hashtable->capacity * sizeof(entry_t);
+}
+
+static void writeHashtableReferences(FILE* file, void* from, hashtable_t* hashtable, char* kind) {
+    for ( entry_t* pair = ht_first(hashtable) ; pair != NULL ; pair = ht_next(hashtable, pair) ) {
+        if ( pair->value != NULL ) {
+            writeReference(file, from, (Variable) (uintptr_t) pair->value, kind, pair->key);
+        }
+    }
+}
+
+static void writeObject(FILE* file, Object* object, size_t bytes) {
+    char* kind = object->isArray ? "array" : object->function != NULL ? "function" : "object";
+    if ( object->slots != object->inlineSlots ) {
+        bytes += object->slotCapacity * sizeof(Variable);
+    }
+    bytes += object->elementCapacity * sizeof(Variable) + hashtableBytes(object->properties) + hashtableBytes(object->internalProperties);
+    fprintf(file, "node %lx %s %zu -\n", (unsigned long) (uintptr_t) object, kind, bytes);
+    if ( object->shape != NULL ) {
+        for ( Shape* shape = object->shape ; shape->key != NULL ; shape = shape->parent ) {
+            writeReference(file, object, object->slots[shape->slotCount - 1], "p:", shape->key);
+        }
+    } else {
+        writeHashtableReferences(file, object, object->properties, "p:");
+    }
+    for ( uint32_t i = 0 ; i < object->elementCount ; i++ ) {
+        char index[12];
+        sprintf(index, "%u", i);
+        writeReference(file, object, object->elements[i], "e:", index);
+    }
+}
+
+static void writeString(FILE* file, String* string, size_t bytes) {
+    if ( string->chars == NULL ) {
+        fprintf(file, "node %lx rope %zu -\n", (unsigned long) (uintptr_t) string, bytes);
+        writeReference(file, string, (Variable) (uintptr_t) string->left | VARIABLE_STRING_TAG, "i:", "left");
+        writeReference(file, string, (Variable) (uintptr_t) string->right | VARIABLE_STRING_TAG, "i:", "right");
+        return;
+    }
+    if ( string->chars != string->data && !string->interned ) {
+        bytes += string->length + 1;
+    }
+    uint64_t hash = string->hashed ? string->hash : ht_hash(string->chars);
+    fprintf(file, "node %lx string %zu %u:%llx:", (unsigned long) (uintptr_t) string, bytes, string->length, (unsigned long long) hash);
+    writeEscaped(file, string->chars, string->length < LABEL_CHARS ? string->length : LABEL_CHARS);
+    fputc('\n', file);
+}
+
+static void writeScope(FILE* file, Scope* scope, size_t bytes) {
+    fprintf(file, "node %lx scope %zu -\n", (unsigned long) (uintptr_t) scope, bytes + hashtableBytes(scope->hashtable));
+    if ( scope->parent != NULL ) {
+        writeEdge(file, scope, scope->parent, "i:", "parent");
+        push(scope->parent);
+    }
+    writeHashtableReferences(file, scope, scope->hashtable, "v:");
+}
+
+static void writeCell(FILE* file, void* pointer) {
+    GcCell* cell = (GcCell*) pointer - 1;
+    size_t bytes = cell->isStatic ? sizeof(GcCell) + sizeof(Object) : cell->size;
+    switch ((GcCellType) cell->type) {
+        case OBJECT_GC_CELL_TYPE:
+            writeObject(file, (Object*) pointer, bytes);
+            break;
+        case STRING_GC_CELL_TYPE:
+            writeString(file, (String*) pointer, bytes);
+            break;
+        case SCOPE_GC_CELL_TYPE:
+            writeScope(file, (Scope*) pointer, bytes);
+            break;
+    }
+}
+
+// The name of the next snapshot, $CJS_HEAP_SNAPSHOT or one numbered after the process and the snapshots before it.
+static char* defaultPath() {
+    static char path[64];
+    static int count = 0;
+    char* configured = getenv("CJS_HEAP_SNAPSHOT");
+    if ( configured != NULL && *configured != 0 ) {
+        return configured;
+    }
+    snprintf(path, sizeof(path), "cjs-%d-%d.heapsnapshot", (int) getpid(), ++count);
+    return path;
+}
+
+// Writes a snapshot of everything reachable to `path`, or to the default one if it is NULL.
+bool snapshot_write(char* path) {
+    if ( path == NULL ) {
+        path = defaultPath();
+    }
+    FILE* file = fopen(path, "w");
+    if ( file == NULL ) {
+        fprintf(stderr, "could not write heap snapshot: %s\n", path);
+        return false;
+    }
+    void* root = (void*) 0;
+    void* globals = (void*) 1;
+    fprintf(file, "%s\nnode 0 root 0 -\nnode 1 globals 0 -\nedge 0 1 i:globals\n", SNAPSHOT_HEADER);
+    if ( native_globalCells != NULL ) {
+        for ( entry_t* pair = ht_first(native_globalCells) ; pair != NULL ; pair = ht_next(native_globalCells, pair) ) {
+            GlobalCell* cell = (GlobalCell*) pair->value;
+            if ( cell->declared ) {
+                writeReference(file, globals, cell->value, "v:", pair->key);
+            }
+        }
+    }
+    size_t rootCount;
+    void** roots = gc_roots(&rootCount);
+    for ( size_t i = 0 ; i < rootCount ; i++ ) {
+        writeEdge(file, root, roots[i], "i:", "root");
+        push(roots[i]);
+    }
+    for ( size_t i = 0 ; i < gcHeap.shadowStackSize ; i++ ) {
+        writeEdge(file, root, gcHeap.shadowStack[i], "i:", "stack");
+        push(gcHeap.shadowStack[i]);
+    }
+    while ( pendingCount > 0 ) {
+        writeCell(file, pending[--pendingCount]);
+    }
+    bool written = ferror(file) == 0;
+    written = fclose(file) == 0 && written;
+    free(visited);
+    visited = NULL;
+    visitedCapacity = 0;
+    visitedCount = 0;
+    if ( written ) {
+        fprintf(stderr, "heap snapshot written to %s\n", path);
+    }
+    return written;
+}
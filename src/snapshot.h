@@ -0,0 +1,30 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdbool.h>
+
+/*
+ * Heap snapshots: every string, object and scope reachable from the roots of the collector, with its size and its
+ * references, written as text, one record per line:
+ *
+ *     CJSHEAP 1
+ *     node <id> <kind> <bytes> <label>    kind is root, globals, object, array, function, string, rope or scope
+ *     edge <from> <to> <name>             a reference to another node
+ *     value <from> <type> <name>          a property or variable that holds a number, boolean, null or undefined
+ *
+ * Ids are hexadecimal, 0 is the root, which refers to the globals, 1, to the permanent roots and to whatever is on the
+ * shadow stack. The bytes of a node are its own, its cell and what it allocated apart from it, like the slots and
+ * hashtables of an object. A name is `p:` and a property key, `e:` and an element index, `v:` and a variable, or `i:`
+ * and one of parent, left, right, root and stack. The label of a string is its length, its hash and the start of its
+ * characters, of anything else `-`. Names and labels escape spaces, `%` and anything outside of printable ASCII as %XX.
+ *
+ * A program writes a snapshot when it gets SIGUSR2, at its next safepoint, and with CJS_HEAP_SNAPSHOT_ON_EXIT=1 when it
+ * exits, to $CJS_HEAP_SNAPSHOT or to cjs-<pid>-<n>.heapsnapshot. `transpiler --analyze-snapshot <file>` reports what retains the most memory and which
+ * strings are duplicated, see analyzer.c.
+ */
+
+#define SNAPSHOT_HEADER "CJSHEAP 1"
+
+bool snapshot_write(char*);
+
+#endif
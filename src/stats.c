@@ -0,0 +1,210 @@
+#include "stats.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+bool stats_enabled = false;
+
+static Stats counters;
+Stats* stats_counters = &counters;
+
+StatsSite* stats_site = NULL;
+static StatsSite* sites = NULL;
+
+static bool configured = false;
+
+static char* kindNames[STATS_KIND_COUNT] = {
+    "string",
+    "string chars",
+    "object",
+    "object slots",
+    "scope",
+    "hashtable",
+    "hashtable entries"
+};
+
+static void printAtExit() {
+    stats_print(stderr, stats_counters);
+}
+
+// Moves the counters into a file of their own that stays mapped for as long as the program runs.
+static void mapFile(char* path) {
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if ( fd < 0 || ftruncate(fd, sizeof(Stats)) != 0 ) {
+        fprintf(stderr, "could not create stats file: %s\n", path);
+        if ( fd >= 0 ) {
+            close(fd);
+        }
+        return;
+    }
+    Stats* mapped = (Stats*) mmap(NULL, sizeof(Stats), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if ( mapped == MAP_FAILED ) {
+        fprintf(stderr, "could not map stats file: %s\n", path);
+        return;
+    }
+    memcpy(mapped, stats_counters, sizeof(Stats));
+    stats_counters = mapped;
+}
+
+void stats_configure() {
+    if ( configured ) return;
+    configured = true;
+    memcpy(counters.magic, STATS_MAGIC, sizeof(counters.magic));
+    counters.pid = getpid();
+    char* path = getenv("CJS_STATS_FILE");
+    char* print = getenv("CJS_STATS");
+    if ( path != NULL && *path != 0 ) {
+        mapFile(path);
+        stats_enabled = true;
+    }
+    if ( print != NULL && strcmp(print, "1") == 0 ) {
+        atexit(printAtExit);
+        stats_enabled = true;
+    }
+}
+
+static void printHistogram(FILE* file, uint64_t* histogram) {
+    static char* buckets[STATS_HISTOGRAM_SIZE] = { "0", "1", "2", "3", "4-7", "8-15", "16-31", "32+" };
+    for ( int i = 0 ; i < STATS_HISTOGRAM_SIZE ; i++ ) {
+        fprintf(file, "%s %s: %llu", i == 0 ? "" : ",", buckets[i], (unsigned long long) histogram[i]);
+    }
+    fprintf(file, "\n");
+}
+
+void stats_print(FILE* file, Stats* stats) {
+    fprintf(file, "stats of process %llu:\n", (unsigned long long) stats->pid);
+    fprintf(file, "  %-18s %14s %16s %14s %16s %14s\n", "kind", "allocations", "bytes", "frees", "bytes freed", "live bytes");
+    for ( int i = 0 ; i < STATS_KIND_COUNT ; i++ ) {
+        fprintf(file, "  %-18s %14llu %16llu %14llu %16llu %14lld\n",
+            kindNames[i],
+            (unsigned long long) stats->allocations[i],
+            (unsigned long long) stats->allocatedBytes[i],
+            (unsigned long long) stats->frees[i],
+            (unsigned long long) stats->freedBytes[i],
+            (long long) ( stats->allocatedBytes[i] - stats->freedBytes[i] ));
+    }
+    fprintf(file, "  %llu hashtable lookups, %.2f probes on average, by probes:",
+        (unsigned long long) stats->hashtableLookups,
+        stats->hashtableLookups == 0 ? 0.0 : (double) stats->hashtableProbes / stats->hashtableLookups);
+    printHistogram(file, stats->hashtableProbeHistogram);
+    fprintf(file, "  %llu property lookups, %.2f prototypes walked on average, by prototypes:",
+        (unsigned long long) stats->propertyLookups,
+        stats->propertyLookups == 0 ? 0.0 : (double) stats->prototypeWalks / stats->propertyLookups);
+    printHistogram(file, stats->prototypeWalkHistogram);
+}
+
+// Reads the stats file of a program, which may still be running and updating it.
+bool stats_read(char* path, Stats* stats) {
+    int fd = open(path, O_RDONLY);
+    if ( fd < 0 ) return false;
+    bool read = pread(fd, stats, sizeof(Stats), 0) == sizeof(Stats);
+    close(fd);
+    return read && memcmp(stats->magic, STATS_MAGIC, sizeof(stats->magic)) == 0;
+}
+
+static uint64_t costOf(StatsSite* site) {
+    return site->hits + site->lookups + site->probes + site->prototypes;
+}
+
+static int compareSites(const void* left, const void* right) {
+    uint64_t a = costOf(*(StatsSite**) left);
+    uint64_t b = costOf(*(StatsSite**) right);
+    return a > b ? -1 : a < b;
+}
+
+// The lines of a source file, read once for all of its sites.
+typedef struct SourceLines SourceLines;
+
+struct SourceLines {
+    char* source;
+    char** lines;
+    int count;
+    SourceLines* next;
+};
+
+static SourceLines* sourceLines = NULL;
+
+static SourceLines* linesOf(char* source) {
+    for ( SourceLines* tmp = sourceLines ; tmp != NULL ; tmp = tmp->next ) {
+        if ( strcmp(tmp->source, source) == 0 ) return tmp;
+    }
+    SourceLines* lines = (SourceLines*) calloc(1, sizeof(SourceLines));
+    lines->source = source;
+    lines->next = sourceLines;
+    sourceLines = lines;
+    FILE* file = fopen(source, "r");
+    if ( file == NULL ) return lines;
+    char* text = NULL;
+    size_t size = 0;
+    while ( getline(&text, &size, file) >= 0 ) {
+        lines->lines = (char**) realloc(lines->lines, ( lines->count + 1 ) * sizeof(char*));
+        char* start = text + strspn(text, " \t");
+        lines->lines[lines->count++] = strndup(start, strcspn(start, "\r\n"));
+    }
+    free(text);
+    fclose(file);
+    return lines;
+}
+
+// Prints the line of the source file, without its indentation, if the file can still be read from here.
+static void printSourceLine(FILE* file, char* source, int line) {
+    SourceLines* lines = linesOf(source);
+    if ( line >= 1 && line <= lines->count ) {
+        fprintf(file, "  %s", lines->lines[line - 1]);
+    }
+}
+
+static void writeSites() {
+    size_t count = 0;
+    for ( StatsSite* site = sites ; site != NULL ; site = site->next ) {
+        count += 1;
+    }
+    StatsSite** sorted = (StatsSite**) malloc(( count + 1 ) * sizeof(StatsSite*));
+    count = 0;
+    for ( StatsSite* site = sites ; site != NULL ; site = site->next ) {
+        sorted[count++] = site;
+    }
+    qsort(sorted, count, sizeof(StatsSite*), compareSites);
+    char path[64];
+    char* configured = getenv("CJS_SITE_PROFILE");
+    if ( configured == NULL || *configured == 0 ) {
+        snprintf(path, sizeof(path), "cjs-%d.sites", (int) getpid());
+        configured = path;
+    }
+    FILE* file = fopen(configured, "w");
+    if ( file == NULL ) {
+        fprintf(stderr, "could not write site profile: %s\n", configured);
+        free(sorted);
+        return;
+    }
+    fprintf(file, "%14s %14s %12s %12s %12s %12s  %-5s %-16s site\n", "cost", "hits", "lookups", "probes", "prototypes", "undefined", "kind", "name");
+    for ( size_t i = 0 ; i < count ; i++ ) {
+        StatsSite* site = sorted[i];
+        fprintf(file, "%14llu %14llu %12llu %12llu %12llu %12llu  %-5s %-16s %s:%d",
+            (unsigned long long) costOf(site),
+            (unsigned long long) site->hits,
+            (unsigned long long) site->lookups,
+            (unsigned long long) site->probes,
+            (unsigned long long) site->prototypes,
+            (unsigned long long) site->undefinedReads,
+            site->write ? "write" : "read", site->name, site->source, site->line);
+        printSourceLine(file, site->source, site->line);
+        fprintf(file, "\n");
+    }
+    fclose(file);
+    free(sorted);
+}
+
+// Called on the first hit of a site, which turns counting on for good.
+void stats_registerSite(StatsSite* site) {
+    if ( sites == NULL ) {
+        atexit(writeSites);
+    }
+    site->next = sites;
+    sites = site;
+    stats_enabled = true;
+}
@@ -0,0 +1,139 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Counters of what the runtime allocates, by kind, and of how far its lookups go: the slots a hashtable lookup probes
+ * and the prototypes a property lookup walks. They are off unless the environment turns them on:
+ *
+ *     CJS_STATS=1             print them to stderr on exit
+ *     CJS_STATS_FILE=<path>   keep them in that file, mapped into memory, so another process can read them while the
+ *                             program runs, with `transpiler --stats <path>` or anything that knows struct Stats
+ *
+ * While they are off, counting costs a branch on stats_enabled.
+ *
+ * Code generated with `transpiler --profile-sites` counts the same lookups by site as well: every read and assignment of
+ * a variable or property has a static StatsSite, see native_enterSite() in runtime.h. On exit the sites are ranked by
+ * cost, their hits plus the hashtables, slots and prototypes their lookups went through, and written with their place in
+ * the source to $CJS_SITE_PROFILE or to cjs-<pid>.sites.
+ *
+ * Only strings and objects allocate among the values, numbers, booleans, null and undefined live in their Variable, see
+ * runtime.h. A String or Object counts as allocated when its cell is, whether or not it is freed with the region of a
+ * call; what is allocated apart from the cell is a kind of its own.
+ */
+
+#define STATS_MAGIC          "CJSSTAT1"
+#define STATS_HISTOGRAM_SIZE 8 // 0, 1, 2, 3, 4 to 7, 8 to 15, 16 to 31, 32 and more
+
+typedef enum StatsKind StatsKind;
+typedef struct Stats Stats;
+typedef struct StatsSite StatsSite;
+
+enum StatsKind {
+    STRING_STATS_KIND,            // cells of strings, with the characters of the ones created flat
+    STRING_CHARS_STATS_KIND,      // the characters a rope is flattened into
+    OBJECT_STATS_KIND,            // cells of objects and arrays
+    OBJECT_SLOTS_STATS_KIND,      // slots and elements that outgrew their object
+    SCOPE_STATS_KIND,
+    HASHTABLE_STATS_KIND,
+    HASHTABLE_ENTRIES_STATS_KIND,
+    STATS_KIND_COUNT
+};
+
+// The layout of the stats file as well, in the byte order of the machine.
+struct Stats {
+    char magic[8];
+    uint64_t pid;
+    uint64_t allocations[STATS_KIND_COUNT];
+    uint64_t allocatedBytes[STATS_KIND_COUNT];
+    uint64_t frees[STATS_KIND_COUNT];
+    uint64_t freedBytes[STATS_KIND_COUNT];
+    uint64_t hashtableLookups;
+    uint64_t hashtableProbes;     // slots looked at past the first one
+    uint64_t hashtableProbeHistogram[STATS_HISTOGRAM_SIZE];
+    uint64_t propertyLookups;     // of properties that are not in a cache
+    uint64_t prototypeWalks;      // prototypes looked at
+    uint64_t prototypeWalkHistogram[STATS_HISTOGRAM_SIZE];
+};
+
+// A site of generated code that looks up a variable or property, in its static data.
+struct StatsSite {
+    char* source;
+    int line;
+    bool write;                   // an assignment rather than a read
+    char* name;                   // `x` for a variable, `.x` for a property, `[]` for an element
+    uint64_t hits;
+    uint64_t lookups;             // hashtables looked in, one for each scope a variable is looked up in
+    uint64_t probes;
+    uint64_t prototypes;
+    uint64_t undefinedReads;      // reads that found nothing, or undefined
+    StatsSite* next;              // in the list of the sites that ran, NULL before their first hit
+};
+
+#define STATS_SITE(source, line, write, name) { (source), (line), (write), (name), 0, 0, 0, 0, 0, NULL }
+
+extern bool stats_enabled;
+extern Stats* stats_counters;
+extern StatsSite* stats_site;     // the site whose lookup is running, if any
+
+void stats_configure();
+void stats_print(FILE*, Stats*);
+bool stats_read(char*, Stats*);
+void stats_registerSite(StatsSite*);
+
+static inline int stats_bucket(uint64_t count) {
+    if ( count < 4 ) return (int) count;
+    int bucket = 65 - __builtin_clzll(count);
+    return bucket < STATS_HISTOGRAM_SIZE ? bucket : STATS_HISTOGRAM_SIZE - 1;
+}
+
+static inline void stats_allocate(StatsKind kind, size_t bytes) {
+    if ( stats_enabled ) {
+        stats_counters->allocations[kind] += 1;
+        stats_counters->allocatedBytes[kind] += bytes;
+    }
+}
+
+static inline void stats_free(StatsKind kind, size_t bytes) {
+    if ( stats_enabled ) {
+        stats_counters->frees[kind] += 1;
+        stats_counters->freedBytes[kind] += bytes;
+    }
+}
+
+// A buffer that grew from `oldBytes` to `bytes`, as if it was freed and allocated again.
+static inline void stats_reallocate(StatsKind kind, size_t oldBytes, size_t bytes) {
+    if ( oldBytes > 0 ) {
+        stats_free(kind, oldBytes);
+    }
+    stats_allocate(kind, bytes);
+}
+
+static inline void stats_hashtableLookup(int probes) {
+    if ( stats_enabled ) {
+        stats_counters->hashtableLookups += 1;
+        stats_counters->hashtableProbes += probes;
+        stats_counters->hashtableProbeHistogram[stats_bucket(probes)] += 1;
+        if ( stats_site != NULL ) {
+            stats_site->lookups += 1;
+            stats_site->probes += probes;
+        }
+    }
+}
+
+static inline void stats_propertyLookup(int prototypes) {
+    if ( stats_enabled ) {
+        stats_counters->propertyLookups += 1;
+        stats_counters->prototypeWalks += prototypes;
+        stats_counters->prototypeWalkHistogram[stats_bucket(prototypes)] += 1;
+        if ( stats_site != NULL ) {
+            stats_site->prototypes += prototypes;
+        }
+    }
+}
+
+#endif
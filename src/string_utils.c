@@ -2,11 +2,6 @@
 #include <string.h>
 #include "string_utils.h"
 
-char* new_string(char* str) {
-    char* string = (char*) calloc(1, sizeof(char));
-    return concat(string, str);
-}
-
 char* concat(char* dest, char* src) {
     int length = strlen(dest) + strlen(src) + 1;
     dest = (char*) realloc(dest, length);
@@ -45,3 +40,19 @@ char* concat_comment(char* dest, char* src) {
     }
     return dest;
 }
+
+char* concat_escaped(char* dest, char* src) {
+    for ( int i = 0 ; i < strlen(src) ; i++ ) {
+        switch (src[i]) {
+            case '\b': dest = concat(dest, "\\b");  break; // \b backspace
+            case '\f': dest = concat(dest, "\\f");  break; // \f form feed
+            case '\n': dest = concat(dest, "\\n");  break; // \n line feed (new line)
+            case '\r': dest = concat(dest, "\\r");  break; // \r carriage return
+            case '\t': dest = concat(dest, "\\t");  break; // \t horizontal tab
+            case '"':  dest = concat(dest, "\\\""); break; // \" double quotation mark
+            case '\\': dest = concat(dest, "\\\\"); break; // \\ backslash
+            default:   dest = concat_char(dest, src[i]);
+        }
+    }
+    return dest;
+}
@@ -1,10 +1,18 @@
 #ifndef STRING_UTILS_H
 #define STRING_UTILS_H
 
-char* new_string(char*);
+#include <stdlib.h>
+
 char* concat(char*, char*);
 char* concat_char(char*, char);
 char* concat_indent(char*, char*);
 char* concat_comment(char*, char*);
+char* concat_escaped(char*, char*);
+
+// Static, so that it does not clash with the runtime's new_string() when the runtime is linked into the transpiler.
+static inline char* new_string(char* str) {
+    char* string = (char*) calloc(1, sizeof(char));
+    return concat(string, str);
+}
 
 #endif
\ No newline at end of file
@@ -299,3 +299,71 @@ test.cb('Return Statement', runner(function () {
 test.cb('Return Statement, with Expression', runner(function () {
     return buhler;
 }));
+
+test.cb('Binary Expression, Arithmetic', runner(function () {
+    var buhler = 1 + 2 * 3 - 4 / 5 % 6;
+}));
+
+test.cb('Binary Expression, Bitwise and Shift', runner(function () {
+    var buhler = michael << 1 | other >> 2 & another >>> 3 ^ 4;
+}));
+
+test.cb('Binary Expression, Comparison', runner(function () {
+    var buhler = michael < other == other >= another != michael <= another === other > michael !== another;
+}));
+
+test.cb('Binary Expression, Logical', runner(function () {
+    var buhler = michael && other || another;
+}));
+
+test.cb('Unary Expression', runner(function () {
+    var buhler = -michael + +other - ~another + !buhler;
+}));
+
+test.cb('Iteration Statement, While', runner(function () {
+    while (buhler < 10) {
+        buhler = buhler + 1;
+    }
+}));
+
+test.cb('Iteration Statement, Do While', runner(function () {
+    do buhler = buhler + 1; while (buhler < 10);
+}));
+
+test.cb('Iteration Statement, For', runner(function () {
+    for (buhler = 0; buhler < 10; buhler = buhler + 1) {
+        michael = buhler;
+    }
+}));
+
+test.cb('Iteration Statement, For, with Variable Statement', runner(function () {
+    for (var buhler = 0, michael = 10; buhler < michael; buhler = buhler + 1) {
+        var other = buhler;
+    }
+}));
+
+test.cb('Iteration Statement, For, Empty', runner(function () {
+    for (;;) {
+        return;
+    }
+}));
+
+test.cb('Object Literal', runner(function () {
+    var buhler = {michael: 1, 'other': 'another', 2: true};
+}));
+
+test.cb('Object Literal, Empty', runner(function () {
+    var buhler = {};
+    buhler = {};
+    buhler.michael({}, {});
+}));
+
+test.cb('Object Literal, Nested', runner(function () {
+    var buhler = {michael: {other: {}}, another: {}};
+}));
+
+test.cb('Array Literal', runner(function () {
+    var buhler = [];
+    buhler = [1, 'michael', {}, [true, {other: null}]];
+    buhler[0] = buhler[3][1];
+}));
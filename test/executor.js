@@ -5,13 +5,38 @@ const chalk = require('chalk');
 
 if (!fs.existsSync('out/test')) fs.mkdirSync('out/test');
 
-module.exports = function (wrappedCode, expectedOutput) {
+// EXECUTOR=interpreter runs each program with `out/transpiler --run` instead of compiling it with gcc.
+const interpreter = process.env.EXECUTOR === 'interpreter';
+
+function body(wrappedCode) {
     wrappedCode = wrappedCode.toString();
-    const code = wrappedCode.substring(wrappedCode.indexOf('{')+1, wrappedCode.lastIndexOf('}'));
+    return wrappedCode.substring(wrappedCode.indexOf('{')+1, wrappedCode.lastIndexOf('}'));
+}
+
+// `modules` maps module names to functions whose bodies are compiled with `--module` and linked into the program.
+// `options` may hold
+//
+//     transpilerArguments  given to the transpiler before a file the program is written to, instead of `--stdin`
+//     env                  a function of the path prefix for the files of the test, out/test/<name>, that returns
+//                          variables to add to the environment of the program
+//     check                a function called with the prefix and the program's stderr once its stdout matched, that
+//                          returns a message if something else is wrong
+//
+// The profiles the program writes go to the prefix with .collapsed and .sites.
+module.exports = function (wrappedCode, expectedOutput, modules, options) {
+    const code = body(wrappedCode);
     const filename = 'test' + Math.floor(Math.random()*100000000);
-
-    function execute(t) {
-        const child = child_process.spawn('out/test/'+filename);
+    const prefix = 'out/test/'+filename;
+    const transpilerArguments = options && options.transpilerArguments;
+    const moduleFiles = Object.keys(modules || {}).map(function (name) {
+        return 'out/test/'+filename+'_'+name.replace(/\W/g, '_')+'.c';
+    });
+
+    function execute(t, command, args) {
+        const child = child_process.spawn(command, args || [], { env: Object.assign({}, process.env, {
+            CJS_PROFILE: prefix+'.collapsed',
+            CJS_SITE_PROFILE: prefix+'.sites'
+        }, options && options.env ? options.env(prefix) : {}) });
         child.stdin.end(code);
 
         let stdout = '';
@@ -26,8 +51,12 @@ module.exports = function (wrappedCode, expectedOutput) {
 
         child.on('close', function (code) {
             if ( code === 0 ) {
-                if ( stdout === expectedOutput) {
+                const problem = stdout === expectedOutput && options && options.check ? options.check(prefix, stderr) : undefined;
+                if ( stdout === expectedOutput && !problem ) {
                     t.pass();
+                } else if ( problem ) {
+                    console.error(chalk.red(problem));
+                    t.fail(chalk.red.bold(problem));
                 } else {
                     console.error(chalk.red('expected: '+JSON.stringify(expectedOutput)));
                     console.error(chalk.red('actual:   '+JSON.stringify(stdout)));
@@ -48,8 +77,18 @@ module.exports = function (wrappedCode, expectedOutput) {
             '-I', 'src',
             '-o', 'out/test/'+filename,
             'out/test/'+filename+'.c',
+            ...moduleFiles,
             'src/runtime.c',
-            'src/hashtable.c'
+            'src/gc.c',
+            'src/slab.c',
+            'src/hashtable.c',
+            'src/atom.c',
+            'src/number.c',
+            'src/output.c',
+            'src/stats.c',
+            'src/snapshot.c',
+            'src/profile.c',
+            '-lm'
         ]);
         child.stdin.end(code);
 
@@ -65,7 +104,7 @@ module.exports = function (wrappedCode, expectedOutput) {
 
         child.on('close', function (code) {
             if ( code === 0 ) {
-                execute(t);
+                execute(t, 'out/test/'+filename);
             } else {
                 const message = chalk.red.bold(stderr);
                 console.error(chalk.red(stdout));
@@ -79,8 +118,30 @@ module.exports = function (wrappedCode, expectedOutput) {
     return function (t) {
         t.plan(1);
 
-        const child = child_process.spawn('out/transpiler', ['--stdin']);
-        child.stdin.end(code);
+        if (interpreter) {
+            return execute(t, 'out/transpiler', ['--stdin', '--run']);
+        }
+
+        try {
+            Object.keys(modules || {}).forEach(function (name, i) {
+                const moduleCode = child_process.execFileSync('out/transpiler', ['--stdin', '--module', name], { input: body(modules[name]) });
+                fs.writeFileSync(moduleFiles[i], moduleCode);
+            });
+        } catch (error) {
+            const message = chalk.red.bold(String(error.stderr || error));
+            console.error(message);
+            t.fail(message);
+            return t.end();
+        }
+
+        let child;
+        if (transpilerArguments) {
+            fs.writeFileSync('out/test/'+filename+'.js', code);
+            child = child_process.spawn('out/transpiler', [...transpilerArguments, 'out/test/'+filename+'.js']);
+        } else {
+            child = child_process.spawn('out/transpiler', ['--stdin']);
+            child.stdin.end(code);
+        }
 
         let stdout = '';
         child.stdout.on('data', function (data) {
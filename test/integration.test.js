@@ -1,3 +1,6 @@
+import child_process from 'child_process';
+import fs from 'fs';
+
 import test from 'ava';
 import executor from './executor';
 
@@ -11,3 +14,575 @@ test.cb('Empty Block', executor(function () {
 test.cb('Hello World', executor(function () {
     console.log('Hello, World!');
 }, 'Hello, World!\n'));
+
+test.cb('Console Log, Multiple Arguments', executor(function () {
+    var name = 'World';
+    console.log('Hello,', name, true, null, '100%');
+}, 'Hello, World true null 100%\n'));
+
+test.cb('Console Log, Zero Arguments', executor(function () {
+    console.log();
+}, '\n'));
+
+test.cb('Console Error', executor(function () {
+    console.error('this goes to stderr');
+}, ''));
+
+test.cb('Console Log, Shadowed Console', executor(function () {
+    function print(console) {
+        console.log('shadowed');
+    }
+    print(console);
+}, 'shadowed\n'));
+
+test.cb('Arithmetic Operators', executor(function () {
+    var a = 7, b = 2;
+    console.log(a * b === 14, a / b === 3.5, a % b === 1, a - b === 5, a + b === 9, -a === 0 - 7);
+}, 'true true true true true true\n'));
+
+test.cb('String Concatenation', executor(function () {
+    var name = 'World';
+    console.log('Hello, ' + name + '!', 'a' + true + null);
+}, 'Hello, World! atruenull\n'));
+
+test.cb('Comparison Operators', executor(function () {
+    console.log(1 < 2, 2 <= 1, 'abc' < 'abd', '10' == 10, '10' === 10, null == undefined, 0 / 0 == 0 / 0);
+}, 'true false true true false true false\n'));
+
+test.cb('Bitwise Operators', executor(function () {
+    console.log((5 & 3) === 1, (5 | 3) === 7, (5 ^ 3) === 6, ~5 === -6, (1 << 4) === 16, (-16 >> 2) === -4, (-1 >>> 28) === 15);
+}, 'true true true true true true true\n'));
+
+test.cb('Logical Operators', executor(function () {
+    console.log('a' && 'b', '' || 'c', null && 'unreachable', !'', !!'x');
+}, 'b c null true true\n'));
+
+test.cb('Operands Are Evaluated Left To Right', executor(function () {
+    function f(x) {
+        console.log(x);
+        return x;
+    }
+    var buhler = f('left') + f('right');
+}, 'left\nright\n'));
+
+test.cb('Operands Are Evaluated Left To Right, Side Effects On The Left', executor(function () {
+    var x = 1;
+    var s = 'a';
+    function f() {
+        x = 10;
+        s = 'b';
+        return 1;
+    }
+    console.log(f() + x, f() < x, f() + s, (x = 2) * x, x);
+}, '11 true 1b 4 2\n'));
+
+test.cb('Arguments And Literal Values Are Evaluated Left To Right, Side Effects First', executor(function () {
+    var x = 1;
+    function f() {
+        x = x + 1;
+        return 'f';
+    }
+    function pair(a, b) {
+        return a + b;
+    }
+    var called = pair(f(), x);
+    var array = [f(), x];
+    var object = {a: f(), b: x};
+    console.log(called, array, object.b);
+}, 'f2 f,3 4\n'));
+
+test.cb('While Loop', executor(function () {
+    var i = 0, log = '';
+    while (i < 5) {
+        log = log + 'x';
+        i = i + 1;
+    }
+    console.log(log, i === 5);
+}, 'xxxxx true\n'));
+
+test.cb('Do While Loop', executor(function () {
+    var i = 10;
+    do i = i + 1; while (i < 5);
+    console.log(i === 11);
+}, 'true\n'));
+
+test.cb('For Loop, with Declarations in the Body', executor(function () {
+    var log = '';
+    for (var i = 0; i < 3; i = i + 1) {
+        var square;
+        log = log + square + ',';
+        square = i * i;
+        for (var j = 0; j < 2; j = j + 1) {
+            var sum = square + j;
+            log = log + (sum === i * i + j) + ',';
+        }
+    }
+    console.log(log);
+}, 'undefined,true,true,0,true,true,1,true,true,\n'));
+
+test.cb('For Loop, with Function Calls', executor(function () {
+    var total = 0;
+    function add(value) {
+        total = total + value;
+    }
+    for (var i = 0; i < 100000; i = i + 1) {
+        add(2);
+    }
+    console.log(total === 200000);
+}, 'true\n'));
+
+test.cb('Assignment Expression, to Variable of Enclosing Scope', executor(function () {
+    var buhler = 'before';
+    function assign() {
+        var michael = buhler = 'after';
+        return michael;
+    }
+    console.log(assign());
+    console.log(buhler);
+}, 'after\nafter\n'));
+
+test.cb('Object Literal', executor(function () {
+    var name = 'World';
+    var greeting = {hello: name, 'with space': true, nested: {empty: {}}};
+    console.log(greeting.hello, greeting['with space'], greeting.nested.empty, greeting.missing);
+}, 'World true [object Object] undefined\n'));
+
+test.cb('Object Literal, Duplicate and Number Keys', executor(function () {
+    var buhler = {michael: 'first', michael: 'second', 1: 'one'};
+    console.log(buhler.michael, buhler[1]);
+}, 'second one\n'));
+
+test.cb('Object Literal, Values Are Evaluated In Order', executor(function () {
+    function f(x) {
+        console.log(x);
+        return x;
+    }
+    var buhler = {a: f('first'), b: f('second'), c: f('third')};
+    console.log(buhler.c);
+}, 'first\nsecond\nthird\nthird\n'));
+
+test.cb('Object Properties, Shared Shapes, Prototypes and Dictionaries', executor(function () {
+    function x(o) {
+        return o.x;
+    }
+    var a = {x: 'a'};
+    var b = {y: 'unused', x: 'b'};
+    var c = {prototype: {x: 'inherited'}};
+    var d = {};
+    var i = 0;
+    while (i < 40) {
+        d['key' + i] = i;
+        i = i + 1;
+    }
+    d.x = 'dictionary';
+    var e = {z: 1};
+    e.x = 'added';
+    var log = '';
+    i = 0;
+    while (i < 2) {
+        log = log + x(a) + x(b) + x(c) + x(d) + x(e) + x({}) + ',';
+        i = i + 1;
+    }
+    e.x = 'changed';
+    console.log(log, x(e), d['key' + 39] === 39);
+}, 'abinheriteddictionaryaddedundefined,abinheriteddictionaryaddedundefined, changed true\n'));
+
+test.cb('Global Variables, Shadowed and Declared Later', executor(function () {
+    var name = 'global';
+    function read() {
+        return name;
+    }
+    function deep(n) {
+        return n < 1 && read() || deep(n - 1);
+    }
+    function shadow(name) {
+        return name;
+    }
+    function local() {
+        var name = 'local';
+        name = name + '!';
+        return name;
+    }
+    function declare() {
+        later = 'assigned';
+    }
+    var log = deep(50) + ',' + shadow('parameter') + ',' + local() + ',' + read();
+    var i = 0;
+    while (i < 3) {
+        name = name + 'x';
+        log = log + ',' + read();
+        i = i + 1;
+    }
+    var later;
+    declare();
+    console.log(log, later);
+}, 'global,parameter,local!,global,globalx,globalxx,globalxxx assigned\n'));
+
+test.cb('Arrays, Dense Elements, Holes and Length', executor(function () {
+    var letters = [];
+    var i = 0;
+    var letter = 'a';
+    while (i < 5) {
+        letters[i] = letter;
+        letter = letter + 'a';
+        i = i + 1;
+    }
+    var mixed = ['x', {name: 'object'}, [true, null], letters];
+    mixed[6] = 'hole';
+    var log = '';
+    i = 0;
+    while (i < mixed.length) {
+        log = log + mixed[i] + ';';
+        i = i + 1;
+    }
+    letters.length = 2;
+    var numbered = {1: 'one'};
+    console.log(log, letters, letters[3], mixed[1].name, mixed['2'][0], numbered[1], numbered['1'], []);
+}, 'x;[object Object];true,;a,aa,aaa,aaaa,aaaaa;undefined;undefined;hole; a,aa undefined object true one one \n'));
+
+test.cb('Arrays, A Shorter Length Deletes The Elements Past It', executor(function () {
+    var a = [1, 2];
+    a[5] = 'five';
+    a.name = 'a';
+    a.length = 1;
+    a.length = 10;
+    var b = [];
+    var i = 0;
+    while (i < 40) {
+        b[i * 2] = i;
+        i = i + 1;
+    }
+    b.length = 11;
+    b.length = 80;
+    console.log(a[5], a[0], a.name, a.length, b[10], b[12], b[78], b.length);
+}, 'undefined 1 a 10 5 undefined undefined 80\n'));
+
+test.cb('Arrays, Length Assigned From The Same Site', executor(function () {
+    var a = [1, 2, 3];
+    var i = 0;
+    while (i < 3) {
+        a.length = 3 - i;
+        i = i + 1;
+    }
+    console.log(a.length, a);
+}, '1 1\n'));
+
+test.cb('Stats, Printed To Stderr On Exit', executor(function () {
+    var objects = [{a: 1}, {b: 2}, {c: 3}];
+    console.log(objects.length);
+}, '3\n', null, {
+    env: function () {
+        return {CJS_STATS: '1'};
+    },
+    check: function (prefix, stderr) {
+        const objects = /^ +object +(\d+) /m.exec(stderr);
+        if (!/^stats of process \d+:$/m.test(stderr) || !objects || Number(objects[1]) < 4) {
+            return 'no allocation counts on stderr: ' + stderr;
+        }
+    }
+}));
+
+test.cb('Stats, Kept In A File And Read Back With --stats', executor(function () {
+    var objects = [{a: 1}, {b: 2}, {c: 3}];
+    console.log(objects[1].b);
+}, '2\n', null, {
+    env: function (prefix) {
+        return {CJS_STATS_FILE: prefix + '.stats'};
+    },
+    check: function (prefix, stderr) {
+        const printed = String(child_process.execFileSync('out/transpiler', ['--stats', prefix + '.stats']));
+        const objects = /^ +object +(\d+) /m.exec(printed);
+        if (stderr !== '' || !objects || Number(objects[1]) < 4 || !/^ +\d+ property lookups/m.test(printed)) {
+            return 'unexpected stats: ' + stderr + printed;
+        }
+    }
+}));
+
+test.cb('Heap Snapshot, Written On Exit And Analyzed', executor(function () {
+    var cache = [];
+    var i = 0;
+    while (i < 200) {
+        cache[i] = {name: 'item ' + 'duplicate', index: i};
+        i = i + 1;
+    }
+    console.log(cache.length);
+}, '200\n', null, {
+    env: function (prefix) {
+        return {CJS_HEAP_SNAPSHOT_ON_EXIT: '1', CJS_HEAP_SNAPSHOT: prefix + '.heapsnapshot'};
+    },
+    check: function (prefix) {
+        const report = String(child_process.execFileSync('out/transpiler', ['--analyze-snapshot', prefix + '.heapsnapshot']));
+        const top = /^top retainers:\n.*\n(.*)$/m.exec(report);
+        if (!top || !/^ +\d+ +\d+ +array +\(globals\)\.cache$/.test(top[1])) {
+            return 'the array is not the top retainer: ' + report;
+        }
+        if (!/^ +200 +\d+ +length 14 "item duplicate"$/m.test(report)) {
+            return 'the duplicate string is not reported: ' + report;
+        }
+    }
+}));
+
+// `--run` does not instrument the program or profile its sites.
+const testCompiled = process.env.EXECUTOR === 'interpreter' ? test.cb.skip : test.cb;
+
+testCompiled('Instrumented Functions, Flag Before The Input File', executor(function () {
+    function square(x) {
+        var i = 0;
+        while (i < 1000) {
+            i = i + 1;
+        }
+        return x * x;
+    }
+    console.log(square(3), square(4));
+}, '9 16\n', null, {
+    transpilerArguments: ['--instrument'],
+    check: function (prefix) {
+        const collapsed = String(fs.readFileSync(prefix + '.collapsed'));
+        if (!/^\(top level\);square \d+$/m.test(collapsed)) {
+            return 'no collapsed stack for square: ' + collapsed;
+        }
+    }
+}));
+
+testCompiled('Profiled Sites, Flag Before The Input File', executor(function () {
+    var point = {x: 1};
+    point.y = point.x + 1;
+    console.log(point.x, point.y, point.z);
+}, '1 2 undefined\n', null, {
+    transpilerArguments: ['--profile-sites'],
+    check: function (prefix) {
+        const report = String(fs.readFileSync(prefix + '.sites'));
+        const sites = report.split('\n').slice(1).filter(function (line) {
+            return line !== '';
+        }).map(function (line) {
+            const columns = line.trim().split(/ +/);
+            return {cost: Number(columns[0]), undefinedReads: Number(columns[5]), kind: columns[6], name: columns[7]};
+        });
+        const ranked = sites.every(function (site, i) {
+            return i === 0 || sites[i - 1].cost >= site.cost;
+        });
+        const z = sites.filter(function (site) {
+            return site.kind === 'read' && site.name === '.z';
+        });
+        if (sites.length === 0 || !ranked || sites[0].name !== 'point' || z.length !== 1 || z[0].undefinedReads !== 1) {
+            return 'unexpected site profile: ' + report;
+        }
+    }
+}));
+
+// `--run` interprets a single program and does not link modules.
+const testModules = process.env.EXECUTOR === 'interpreter' ? test.cb.skip : test.cb;
+
+testModules('Require Module', executor(function () {
+    var greeter = require('./lib/greeter');
+    console.log(greeter.greet('World'), greeter === require('lib/greeter.js'));
+}, 'Hello, World true\n', {
+    'lib/greeter': function () {
+        var greeting = 'Hello, ';
+        function greet(name) {
+            return greeting + name;
+        }
+        exports.greet = greet;
+    }
+}));
+
+testModules('Require Module, Same File Name In Different Directories', executor(function () {
+    console.log(require('./lib/a/util').name, require('lib/b/util.js').name, require('./lib/a/../b/./util') === require('lib/b/util'));
+}, 'a b after a true\n', {
+    'lib/a/util': function () {
+        exports.name = 'a';
+    },
+    'lib/b/util': function () {
+        exports = {name: 'b after ' + require('../a/util').name};
+    }
+}));
+
+testModules('Require Module, Replaced console.log', executor(function () {
+    console.log('before');
+    require('lib/quiet');
+    console.log('should be silenced', 1 + 1);
+}, 'before\nquiet: should be silenced\n', {
+    'lib/quiet': function () {
+        var log = console.log;
+        function quiet(text) {
+            log('quiet: ' + text);
+        }
+        console.log = quiet;
+    }
+}));
+
+testModules('Require Module, Replaced Exports and Nested Require', executor(function () {
+    console.log(require('outer').inner.name);
+}, 'inner\n', {
+    outer: function () {
+        exports = {inner: require('inner')};
+    },
+    inner: function () {
+        exports.name = 'inner';
+    }
+}));
+
+test.cb('Garbage Collection, Reachable Values Survive', executor(function () {
+    function wrap(name, inner) {
+        return {name: name + '!', inner: inner};
+    }
+    var kept = wrap('kept', {name: 'inner'});
+    var i = 0;
+    while (i < 50000) {
+        var garbage = wrap('garbage' + i, wrap('more', null));
+        kept = {name: kept.name, inner: kept.inner};
+        i = i + 1;
+    }
+    console.log(kept.name, kept.inner.name);
+}, 'kept! inner\n'));
+
+test.cb('Garbage Collection, Values Returned From Calls Survive Their Scopes', executor(function () {
+    function node(name, next) {
+        var prefix = 'node ';
+        return {name: prefix + name, next: next};
+    }
+    function list(n) {
+        var head = null;
+        var name = '';
+        var i = 0;
+        while (i < n) {
+            name = name + 'x';
+            head = node(name, head);
+            i = i + 1;
+        }
+        return head;
+    }
+    function last(n) {
+        return n < 1 && list(3) || last(n - 1);
+    }
+    var i = 0;
+    var kept = null;
+    while (i < 20000) {
+        kept = last(2);
+        i = i + 1;
+    }
+    console.log(kept.name, kept.next.next.name);
+}, 'node xxx node x\n'));
+
+test.cb('Calls, Missing Arguments and the Arguments Object', executor(function () {
+    function pair(first, second) {
+        return first + ',' + second;
+    }
+    function rest(first) {
+        return arguments[1] + ',' + arguments[2] + ',' + (arguments.length === 3);
+    }
+    function keep() {
+        return arguments;
+    }
+    function order(name) {
+        log = log + name;
+        return name;
+    }
+    var log = '';
+    var kept = keep('kept', 'too');
+    console.log(pair('a'), pair('a', 'b', 'c'), rest('x', 'y', 'z'), rest('x'), kept[0], kept[1]);
+    var ordered = pair(order('1'), order('2'));
+    console.log(ordered, log);
+}, 'a,undefined a,b y,z,true undefined,undefined,false kept too\n1,2 12\n'));
+
+test.cb('Strings, Long Concatenations Compare and Index by Their Characters', executor(function () {
+    var forward = '';
+    var backward = '';
+    var i = 0;
+    while (i < 20000) {
+        forward = forward + 'ab';
+        backward = 'b' + backward;
+        backward = 'a' + backward;
+        i = i + 1;
+    }
+    var table = {};
+    table[forward] = 'found';
+    var longer = forward + 'a';
+    console.log(forward === backward, forward == longer, forward < longer, longer < forward, table[backward]);
+    var literal = 'shared';
+    var built = 'sha' + 'red';
+    console.log(literal === built, 'x' + 'y' + forward + 'z' === 'xy' + backward + 'z');
+}, 'true false true false found\ntrue true\n'));
+
+test.cb('Numbers, Shortest Round Trip String Form', executor(function () {
+    var billion = 1000000000;
+    console.log(1, -2, 0.1, 0.1 + 0.2, 1 / 3, 100.125, 123456789012);
+    console.log(billion * billion * 1000, billion * billion * 100, 1 / 1000000, 1 / 10000000, 1.5 / billion / 10);
+    console.log(0 / 0, 1 / 0, -1 / 0, -0, 9007199254740993, billion * billion * billion * billion);
+    var values = [2.5, 'x' + 7, -1 / 3];
+    var keyed = {};
+    keyed[0.5] = 'half';
+    console.log(values, values[0] + '', keyed['0.5']);
+}, '1 -2 0.1 0.30000000000000004 0.3333333333333333 100.125 123456789012\n' +
+    '1e+21 100000000000000000000 0.000001 1e-7 1.5e-10\n' +
+    'NaN Infinity -Infinity 0 9007199254740992 1e+36\n' +
+    '2.5,x7,-0.3333333333333333 2.5 half\n'));
+
+test.cb('Console, Output Larger Than the Buffer Keeps Its Order', executor(function () {
+    var i = 0;
+    var wide = 'wide';
+    while (i < 14) {
+        wide = wide + wide;
+        i = i + 1;
+    }
+    i = 0;
+    while (i < 20000) {
+        console.log('line', i, i / 4);
+        i = i + 1;
+    }
+    console.log(wide);
+    var log = console.log;
+    log('last', [1, 2], null);
+}, Array.from({length: 20000}, function (_, i) { return 'line ' + i + ' ' + i / 4 + '\n'; }).join('') +
+    'wide'.repeat(16384) + '\nlast 1,2 null\n'));
+
+test.cb('Globals, Top Level Functions Are Bound Before the Code That Calls Them', executor(function () {
+    var before = hoisted();
+    function count() {
+        count.calls = count.calls + 1;
+        count.last = 'call ' + count.calls;
+        return count.calls;
+    }
+    function hoisted() {
+        return 'hoisted';
+    }
+    count.calls = 0;
+    var i = 0;
+    while (i < 100000) {
+        count();
+        i = i + 1;
+    }
+    var out = console;
+    out.log(before, count.calls, count.last);
+    out.extra = 'extra';
+    hoisted = 'replaced';
+    console.log(hoisted, console.extra, console === out);
+}, 'hoisted 100000 call 100000\nreplaced extra true\n'));
+
+test.cb('Console, Arguments With Side Effects Are Evaluated In Order', executor(function () {
+    var order = '';
+    function f(n) {
+        order = order + n;
+        return n;
+    }
+    console.log(f(1), 'and', f(2), f(3));
+    console.log(order);
+}, '1 and 2 3\n123\n'));
+
+test.cb('Loops, A Var In The Body Keeps Its Value From One Iteration To The Next', executor(function () {
+    var i = 0;
+    var seen = '';
+    while (i < 3) {
+        var acc;
+        acc = acc + 'x';
+        var n = i * 2;
+        seen = seen + n + acc + ' ';
+        i = i + 1;
+    }
+    for (var j = 0; j < 2; j = j + 1) {
+        var total;
+        total = total + j;
+        console.log(total);
+    }
+    console.log(seen);
+}, 'NaN\nNaN\n0undefinedx 2undefinedxx 4undefinedxxx \n'));